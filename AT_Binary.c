@@ -0,0 +1,233 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Binary.c
+ * Purpose: Binary framed command protocol (COBS + CRC16)
+ *----------------------------------------------------------------------------*/
+/*
+ * Frames are COBS encoded and delimited by a 0x00 byte. A decoded request
+ * frame is
+ *
+ *   seq(1) { op(1) len(1) payload(len) }* crc16(2)
+ *
+ * and its reply frame is
+ *
+ *   seq(1) { op(1) status(1) len(1) payload(len) }* crc16(2)
+ *
+ * with one reply record per request record, so several operations can be
+ * batched into one frame. The CRC is CRC-16/CCITT-FALSE (poly 0x1021,
+ * init 0xFFFF) over all preceding bytes, sent LSB first. Multi-byte
+ * payload fields are little endian.
+ *
+ * The opcode of a record selects an entry of the AT command table and the
+ * command form: op = AT_Cmd.opcode + AT_FORM_EXEC/QUERY/SET. The forms
+ * accepted are the same as for the text protocol.
+ *
+ * A frame with a bad CRC, bad COBS coding or a truncated record gets a
+ * reply record with op 0 and AT_BIN_ERR_FRAME. Records whose reply no
+ * longer fits into AT_BIN_FRAME_MAX are not executed.
+ */
+
+#include <stddef.h>
+
+#include "AT_Binary.h"
+
+// Reset decoder state
+void AT_BinFramerReset (AT_BinFramer *fr) {
+  fr->cnt      = 0U;
+  fr->overflow = 0U;
+}
+
+// Feed received bytes into the decoder, calling cb for every frame.
+void AT_BinFramerFeed (AT_BinFramer *fr, const uint8_t *data, uint32_t len, AT_FrameCallback cb, void *ctx) {
+  uint32_t i;
+  int32_t  n;
+
+  for (i = 0U; i < len; i++) {
+    if (data[i] == 0x00U) {
+      if (fr->overflow != 0U) {
+        cb(NULL, 0U, 1U, ctx);
+      } else if (fr->cnt != 0U) {
+        n = AT_CobsDecode(fr->buf, fr->cnt);
+        if (n > 0) {
+          cb(fr->buf, (uint32_t)n, 0U, ctx);
+        } else {
+          cb(NULL, 0U, 1U, ctx);
+        }
+      }
+      AT_BinFramerReset(fr);
+    } else if (fr->cnt < sizeof(fr->buf)) {
+      fr->buf[fr->cnt++] = data[i];
+    } else {
+      fr->overflow = 1U;
+    }
+  }
+}
+
+// CRC-16/CCITT-FALSE
+uint16_t AT_Crc16 (const uint8_t *data, uint32_t len) {
+  uint32_t crc = 0xFFFFU;
+  uint32_t i, bit;
+
+  for (i = 0U; i < len; i++) {
+    crc ^= (uint32_t)data[i] << 8;
+    for (bit = 0U; bit < 8U; bit++) {
+      crc = ((crc & 0x8000U) != 0U) ? ((crc << 1) ^ 0x1021U) : (crc << 1);
+    }
+  }
+  return (uint16_t)crc;
+}
+
+// COBS encode len bytes of src into dst (without delimiter), returns encoded length.
+uint32_t AT_CobsEncode (const uint8_t *src, uint32_t len, uint8_t *dst) {
+  uint32_t i, code_idx, w;
+  uint8_t  code;
+
+  code_idx = 0U;
+  w        = 1U;
+  code     = 1U;
+  for (i = 0U; i < len; i++) {
+    if (src[i] == 0x00U) {
+      dst[code_idx] = code;
+      code_idx = w++;
+      code     = 1U;
+    } else {
+      dst[w++] = src[i];
+      code++;
+      if (code == 0xFFU) {
+        dst[code_idx] = code;
+        code_idx = w++;
+        code     = 1U;
+      }
+    }
+  }
+  dst[code_idx] = code;
+  return w;
+}
+
+// COBS decode in place, returns decoded length or -1 on a coding error.
+int32_t AT_CobsDecode (uint8_t *buf, uint32_t len) {
+  uint32_t r, w, i;
+  uint8_t  code;
+
+  r = 0U;
+  w = 0U;
+  while (r < len) {
+    code = buf[r++];
+    if (code == 0x00U) {
+      return -1;
+    }
+    for (i = 1U; i < code; i++) {
+      if ((r >= len) || (buf[r] == 0x00U)) {
+        return -1;
+      }
+      buf[w++] = buf[r++];
+    }
+    if ((code != 0xFFU) && (r < len)) {
+      buf[w++] = 0x00U;
+    }
+  }
+  return (int32_t)w;
+}
+
+// Find the table entry and form for a binary opcode.
+static const AT_Cmd *_FindOp (const AT_Cmd *table, uint32_t num, uint8_t op, AT_Form *form) {
+  uint32_t i;
+  uint32_t f;
+
+  for (i = 0U; i < num; i++) {
+    if ((table[i].bin == NULL) || (table[i].opcode == 0U) || (op < table[i].opcode)) {
+      continue;
+    }
+    f = (uint32_t)op - table[i].opcode;
+    if ((f <= (uint32_t)AT_FORM_SET) && ((table[i].forms & (1U << f)) != 0U)) {
+      *form = (AT_Form)f;
+      return &table[i];
+    }
+  }
+  return NULL;
+}
+
+// Append a reply record without payload.
+static void _PutStatus (AT_Resp *out, uint8_t op, uint8_t status) {
+  uint8_t rec[3];
+
+  rec[0] = op;
+  rec[1] = status;
+  rec[2] = 0U;
+  (void)AT_Write(out, rec, sizeof(rec));
+}
+
+// Execute a decoded frame and append the encoded reply frame to resp.
+int AT_BinDispatch (const AT_Cmd *table, uint32_t num, const uint8_t *frame, uint32_t len, AT_Resp *resp) {
+  uint8_t       raw[AT_BIN_FRAME_MAX];
+  AT_Resp       out, sub;
+  const AT_Cmd *cmd;
+  AT_Form       form;
+  uint32_t      pos, end, plen, hdr;
+  uint16_t      crc;
+  uint8_t       status;
+  int           rc = 0;
+
+  if ((resp->len > resp->size) || ((resp->size - resp->len) < AT_BIN_ENCODED_MAX)) {
+    return -1;
+  }
+  out.buf     = (char *)raw;
+  out.size    = sizeof(raw) - 2U;       // Room for the CRC
+  out.len     = 1U;
+  out.channel = resp->channel;
+  raw[0]      = (len != 0U) ? frame[0] : 0U;
+
+  if ((len < 3U) ||
+      (AT_Crc16(frame, len - 2U) != (uint16_t)(frame[len - 2U] | ((uint32_t)frame[len - 1U] << 8)))) {
+    _PutStatus(&out, 0U, AT_BIN_ERR_FRAME);
+    rc = -1;
+  } else {
+    end = len - 2U;
+    for (pos = 1U; pos < end; pos += 2U + plen) {
+      plen = 0U;
+      if (((end - pos) < 2U) || (frame[pos + 1U] > (end - pos - 2U))) {
+        _PutStatus(&out, 0U, AT_BIN_ERR_FRAME);
+        rc = -1;
+        break;
+      }
+      plen = frame[pos + 1U];
+      if ((out.size - out.len) < 3U) {
+        rc = -1;                        // Reply full, skip remaining records
+        break;
+      }
+      hdr      = out.len;
+      out.len += 3U;
+
+      sub.buf     = &out.buf[out.len];
+      sub.size    = out.size - out.len;
+      sub.len     = 0U;
+      sub.channel = out.channel;
+      if (sub.size > 255U) {
+        sub.size = 255U;
+      }
+      cmd = _FindOp(table, num, frame[pos], &form);
+      if (cmd == NULL) {
+        status = AT_BIN_ERR_OP;
+      } else if (cmd->bin(form, &frame[pos + 2U], plen, &sub) != 0) {
+        status  = AT_BIN_ERR_ARG;
+        sub.len = 0U;
+      } else {
+        status = AT_BIN_OK;
+      }
+      if (status != AT_BIN_OK) {
+        rc = -1;
+      }
+      raw[hdr]      = frame[pos];
+      raw[hdr + 1U] = status;
+      raw[hdr + 2U] = (uint8_t)sub.len;
+      out.len      += sub.len;
+    }
+  }
+
+  crc = AT_Crc16(raw, out.len);
+  raw[out.len++] = (uint8_t)crc;
+  raw[out.len++] = (uint8_t)(crc >> 8);
+
+  resp->len += AT_CobsEncode(raw, out.len, (uint8_t *)&resp->buf[resp->len]);
+  resp->buf[resp->len++] = 0x00;
+  return rc;
+}
@@ -0,0 +1,51 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Binary.h
+ * Purpose: Binary framed command protocol (COBS + CRC16)
+ *----------------------------------------------------------------------------*/
+
+#ifndef AT_BINARY_H_
+#define AT_BINARY_H_
+
+#include <stdint.h>
+
+#include "AT_Parser.h"
+
+// Maximum decoded frame size (sequence, records and CRC)
+#define AT_BIN_FRAME_MAX        (128)
+
+// Maximum COBS encoded frame size including the 0x00 delimiter
+#define AT_BIN_ENCODED_MAX      (AT_BIN_FRAME_MAX + (AT_BIN_FRAME_MAX / 254) + 2)
+
+// Reply record status
+#define AT_BIN_OK               (0x00U) // Operation executed
+#define AT_BIN_ERR_OP           (0x01U) // Unknown opcode
+#define AT_BIN_ERR_ARG          (0x02U) // Bad payload length or value
+#define AT_BIN_ERR_FRAME        (0x03U) // Bad CRC, COBS or record layout
+
+// Frame decoder state (one per input channel)
+typedef struct {
+  uint8_t      buf[AT_BIN_ENCODED_MAX];
+  uint32_t     cnt;
+  uint8_t      overflow;
+} AT_BinFramer;
+
+// Called by AT_BinFramerFeed for each received frame.
+// \param[in]   frame         decoded frame (NULL if error)
+// \param[in]   len           decoded frame length
+// \param[in]   error         1 if the frame was too long or not valid COBS
+// \param[in]   ctx           context passed to AT_BinFramerFeed
+typedef void (*AT_FrameCallback) (const uint8_t *frame, uint32_t len, uint32_t error, void *ctx);
+
+extern void     AT_BinFramerReset (AT_BinFramer *fr);
+extern void     AT_BinFramerFeed  (AT_BinFramer *fr, const uint8_t *data, uint32_t len, AT_FrameCallback cb, void *ctx);
+
+// Execute all records of a decoded frame (len == 0: report a frame error)
+// and write the COBS encoded, 0x00 terminated reply frame to resp.
+// \return      0 on success, -1 if any record failed
+extern int      AT_BinDispatch    (const AT_Cmd *table, uint32_t num, const uint8_t *frame, uint32_t len, AT_Resp *resp);
+
+extern uint16_t AT_Crc16          (const uint8_t *data, uint32_t len);
+extern uint32_t AT_CobsEncode     (const uint8_t *src, uint32_t len, uint8_t *dst);
+extern int32_t  AT_CobsDecode     (uint8_t *buf, uint32_t len);
+
+#endif /* AT_BINARY_H_ */
@@ -0,0 +1,937 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Commands.c
+ * Purpose: Board AT command set
+ *----------------------------------------------------------------------------*/
+/*
+ * Supported commands:
+ *   AT+ACQ=<hz>, AT+ACQ?       set ADC sample rate / read rate,samples,last,filtered
+ *   AT+BENCH                   start a benchmark run (Benchmark target only,
+ *                              Bench.c); results follow as "+BENCH:" lines
+ *   AT+BUTTON                  report pressed buttons as text
+ *   AT+BUTTON?                 pressed button mask in hex, bit n = SWn+1
+ *   AT+BUTTON=SUB|UNSUB        (un)subscribe this channel to button events:
+ *                              "+BUTTON: <n>,PRESS|RELEASE,0x<mask>,<ms>"
+ *   AT+CMDQ?                   command queue depth/high-water/posted/dropped
+ *   AT+LCD=<text>, AT+LCD?     set/read the LCD string
+ *   AT+LED=<n>, AT+LED?        set/read the LED mask 0..255, bit n = LEDn+1
+ *                              (legacy: AT+LED<n>), stops AT+LEDSEQ
+ *   AT+LEDPWM=<led>,<level>    set LED brightness 0..15 (led 1..8, 0 = all)
+ *   AT+LEDPWM?                 read all LED brightness levels
+ *   AT+LEDSEQ=CLR              stop and clear the LED pattern table
+ *   AT+LEDSEQ=ADD,<mask>,<ms>[,<mask>,<ms>...]  append pattern steps
+ *   AT+LEDSEQ=RUN[,<repeat>]   play the table repeat times (0/none = loop)
+ *   AT+LEDSEQ=STOP, AT+LEDSEQ? stop playback / read steps,running,step,loops
+ *   AT+MODE=AT|BIN, AT+MODE?   select text or binary protocol on the channel
+ *   AT+POT, AT+POT?            read the filtered potentiometer value
+ *   AT+POTSTREAM=<hz>[,<dec>]  stream every dec-th raw sample as binary
+ *                              blocks on USB (AdcStream.h); =0 stops
+ *   AT+POTSTREAM?              read running,rate,dec,blocks,dropped
+ *   AT+PROF, AT+PROF?          profiler sites (Prof.h) with samples:
+ *                              "+PROF: <site>,<count>,<min>,<avg>,<max>" [us]
+ *   AT+PROF=<site>             histogram of a site: "+PROF: <site>,<n0>,...",
+ *                              bucket b >= 1 counts 2^(b-1)..2^b-1 units of
+ *                              2^PROF_HIST_SHIFT cycles
+ *   AT+PROF=RESET              clear all sites
+ *   AT+SENSORS, AT+SENSORS?    latest scan: pot raw, die temperature [degC],
+ *                              VDDA [mV]
+ *   AT+STATS, AT+STATS?        runtime statistics (Stats.h), one line each:
+ *                              CPU,<load %>,<peak %>,<uptime s>
+ *                              STACK,<threads>,<least free stack>
+ *                              HEAP,<emWin used>,<free>,<peak>
+ *                              CMDQ,<depth>,<max>,<dropped>
+ *                              DROP,<usb>,<uart>,<uart overruns>,<adc>,
+ *                                   <stream>,<tcp>
+ *                              NET,<tcp clients>,<telemetry errors>
+ *                              VNC,<viewers>,<fps>,<bytes/s>,<stalls>
+ *   AT+STATS=THREADS           per thread: THREAD,<name>,<stack used>,
+ *                              <stack size>,<priority>
+ *   AT+STATS=BOOT              per boot milestone reached: BOOT,<name>,<ms>
+ *   AT+TELEM=<ip>,<port>[,<ms>] publish UDP telemetry (Telem.h) to a
+ *                              unicast/multicast address every ms
+ *   AT+TELEM=OFF, AT+TELEM?    stop / read ip,port,ms,sent,errors
+ *
+ * Binary protocol (AT_Binary.c), op = opcode base + form, payloads LE:
+ *   0x31/0x32  ACQ query/set       <-> u32 rate; query adds u32 samples,
+ *                                      u16 last, u16 filtered
+ *   0x10/0x11  BUTTON exec/query   -> u8 pressed button mask (bit n = SWn+1)
+ *   0x15       CMDQ query          -> u32 depth, max, posted, dropped
+ *   0x19/0x1A  LCD query/set       <-> text, 1..LCD_STRING_SIZE-1 bytes
+ *   0x1D/0x1E  LED query/set       <-> u8 LED mask
+ *   0x29/0x2A  LEDPWM query/set    <-> u8 level[8]
+ *   0x2D       LEDSEQ query        -> u8 steps, running, step, u32 loops
+ *   0x2E       LEDSEQ set          <- u8 0 = CLR, 1 = ADD {u8 mask, u16 ms}*,
+ *                                     2 = RUN u8 repeat, 3 = STOP
+ *   0x21/0x22  MODE query/set      <-> u8 mode (0 = AT, 1 = BIN)
+ *   0x24/0x25  POT exec/query      -> u16 ADC value
+ *   0x34/0x35  SENSORS exec/query  -> u16 pot, i16 temperature [0.1 degC],
+ *                                     u16 VDDA [mV]
+ *   0x3C/0x3D  STATS exec/query    -> u32 Stats_Counters fields in order
+ *   0x3E       STATS set           <- u8 thread index -> u8 threads,
+ *                                     u8 priority, u32 stack used, u32 stack
+ *                                     size, name (up to 16 bytes)
+ *   0x39/0x3A  TELEM query/set     <-> u8 ip[4], u16 port, u16 ms (ip 0 = off);
+ *                                     query adds u32 sent, errors
+ *
+ * AT+POTSTREAM is text mode and USB only: the sample blocks are raw bytes
+ * outside the COBS framing. They follow the "OK" and are never inserted
+ * into a reply; the host finds them by the STREAM_SYNC header.
+ *
+ * AT+MODE=BIN switches the channel to binary frames once "OK" has been
+ * sent; the host must wait for it before sending the first frame. To fall
+ * back to AT mode send MODE set with payload 0. The USB transport also
+ * returns to AT mode on bus reset and when the host drops DTR (closes the
+ * port), so a tool that did not leave binary mode cannot lock out a
+ * terminal.
+ *
+ * To add a command, add an entry to at_cmd_table. The table must stay
+ * sorted by verb (strcmp order) for the lookup in AT_Dispatch; binary
+ * opcode bases must be unique. Both protocols call the same operations
+ * (LedDrv_Write, BtnDrv_Read, ...), only the argument and reply encoding
+ * differs.
+ */
+
+#include <string.h>
+
+#include "AT_Port.h"
+#include "Temp.h"
+#include "LedDriver.h"
+#include "ButtonDriver.h"
+#include "AdcAcq.h"
+#include "AdcStream.h"
+#include "Telem.h"
+#include "LedSeq.h"
+#include "Stats.h"
+#include "Prof.h"
+#include "Bench.h"
+#include "AT_Commands.h"
+#include "AT_Executor.h"
+#include "GUI_Thread.h"
+
+static char              storedLCDString[LCD_STRING_SIZE] = "";
+static volatile uint32_t lcd_version;   // Incremented by host updates
+
+static volatile uint32_t btn_sub;       // Channels subscribed to button events
+
+static Stats_Thread      stats_thr[STATS_THREADS_MAX];  // AT+STATS=THREADS (executor only)
+
+// Copy src into dst, truncated to size - 1 characters and terminated.
+static void _CopyText (char *dst, const char *src, uint32_t size) {
+    uint32_t len;
+
+    for (len = 0U; (len < (size - 1U)) && (src[len] != '\0'); len++) {
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+void storeLCDString(const char* lcdString) {
+    uint32_t lock;
+
+    lock = AT_PortLock();
+    _CopyText(storedLCDString, lcdString, sizeof(storedLCDString));
+    lcd_version++;
+    AT_PortUnlock(lock);
+    GUI_Signal(GUI_EVT_STATE);
+}
+
+void editLCDString(const char* lcdString) {
+    uint32_t lock;
+
+    lock = AT_PortLock();
+    _CopyText(storedLCDString, lcdString, sizeof(storedLCDString));
+    AT_PortUnlock(lock);
+}
+
+// Copy the current text (size > 0), returns the host update version.
+uint32_t readLCDString(char* buf, uint32_t size) {
+    uint32_t version, lock;
+
+    lock = AT_PortLock();
+    _CopyText(buf, storedLCDString, size);
+    version = lcd_version;
+    AT_PortUnlock(lock);
+    return version;
+}
+
+uint32_t getLCDVersion(void) {
+    return lcd_version;
+}
+
+// Append a little endian value to a binary reply.
+static int _PutLE (AT_Resp *resp, uint32_t val, uint32_t size) {
+  uint8_t  b[4];
+  uint32_t i;
+
+  for (i = 0U; i < size; i++) {
+    b[i] = (uint8_t)(val >> (8U * i));
+  }
+  return AT_Write(resp, b, size);
+}
+
+// AT+LED=<n>, AT+LED?
+static int _Cmd_LED (const AT_Arg *arg, AT_Resp *resp) {
+  if (arg->form == AT_FORM_QUERY) {
+    AT_Printf(resp, "+LED: %u\r\n", LedDrv_Read());
+    return 0;
+  }
+  if ((arg->num < 0) || (arg->num > (int32_t)LED_MASK_ALL)) {
+    return -1;
+  }
+  LedSeq_Stop();
+  LedDrv_Write((uint32_t)arg->num);
+  GUI_Signal(GUI_EVT_STATE);
+  AT_Printf(resp, "LED value set to: %u\r\n", LedDrv_Read());
+  return 0;
+}
+
+// Binary LED query/set: u8 mask
+static int _Bin_LED (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  if (form == AT_FORM_QUERY) {
+    return (len == 0U) ? _PutLE(resp, LedDrv_Read(), 1U) : -1;
+  }
+  if (len != 1U) {
+    return -1;
+  }
+  LedSeq_Stop();
+  LedDrv_Write(in[0]);
+  GUI_Signal(GUI_EVT_STATE);
+  return 0;
+}
+
+// AT+LEDPWM=<led>,<level>, AT+LEDPWM?
+static int _Cmd_LEDPWM (const AT_Arg *arg, AT_Resp *resp) {
+  int32_t  val[2];
+  uint32_t i;
+
+  if (arg->form == AT_FORM_QUERY) {
+    AT_Puts(resp, "+LEDPWM: ");
+    for (i = 0U; i < LED_NUM; i++) {
+      AT_Printf(resp, (i == 0U) ? "%u" : ",%u", LedDrv_GetLevel(i));
+    }
+    AT_Puts(resp, "\r\n");
+    return 0;
+  }
+  if ((AT_ParseInts(arg->str, arg->len, val, 2U) != 2) ||
+      (val[0] < 0) || (val[0] > (int32_t)LED_NUM) ||
+      (val[1] < 0) || (val[1] > (int32_t)LED_LEVEL_MAX)) {
+    return -1;
+  }
+  for (i = 0U; i < LED_NUM; i++) {
+    if ((val[0] == 0) || ((uint32_t)val[0] == (i + 1U))) {
+      (void)LedDrv_SetLevel(i, (uint32_t)val[1]);
+    }
+  }
+  AT_Puts(resp, "OK\r\n");
+  return 0;
+}
+
+// Binary LEDPWM query/set: u8 level[LED_NUM]
+static int _Bin_LEDPWM (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  uint32_t i;
+
+  if (form == AT_FORM_QUERY) {
+    if (len != 0U) {
+      return -1;
+    }
+    for (i = 0U; i < LED_NUM; i++) {
+      if (_PutLE(resp, LedDrv_GetLevel(i), 1U) != 0) {
+        return -1;
+      }
+    }
+    return 0;
+  }
+  if (len != LED_NUM) {
+    return -1;
+  }
+  for (i = 0U; i < LED_NUM; i++) {
+    if (in[i] > LED_LEVEL_MAX) {
+      return -1;
+    }
+  }
+  for (i = 0U; i < LED_NUM; i++) {
+    (void)LedDrv_SetLevel(i, in[i]);
+  }
+  return 0;
+}
+
+// Check that steps more steps fit the stopped table. ADD validates its
+// whole payload before the first LedSeq_Add, so it is stored completely
+// or not at all.
+static int _LedSeqFits (uint32_t steps) {
+  LedSeq_Status st;
+
+  LedSeq_GetStatus(&st);
+  if ((st.running != 0U) || (steps > (LEDSEQ_MAX_STEPS - st.steps))) {
+    return -1;
+  }
+  return 0;
+}
+
+// AT+LEDSEQ=CLR|ADD,<mask>,<ms>...|RUN[,<repeat>]|STOP, AT+LEDSEQ?
+static int _Cmd_LEDSEQ (const AT_Arg *arg, AT_Resp *resp) {
+  LedSeq_Status st;
+  int32_t       val[(AT_LINE_MAX / 4U) * 2U];
+  const char   *p;
+  uint32_t      kw, rest, i;
+  int           n;
+
+  if (arg->form == AT_FORM_QUERY) {
+    LedSeq_GetStatus(&st);
+    AT_Printf(resp, "+LEDSEQ: %u,%u,%u,%u\r\n", st.steps, st.running, st.step, st.loops);
+    return 0;
+  }
+  for (kw = 0U; (kw < arg->len) && (arg->str[kw] != ','); kw++) {
+  }
+  p    = &arg->str[kw];
+  rest = arg->len - kw;
+  if (rest != 0U) {
+    p++;                                // Skip ','
+    rest--;
+  }
+  n = AT_ParseInts(p, rest, val, sizeof(val) / sizeof(val[0]));
+  if (n < 0) {
+    return -1;
+  }
+
+  if ((kw == 3U) && (strncmp(arg->str, "CLR", 3U) == 0) && (n == 0)) {
+    LedSeq_Clear();
+  } else if ((kw == 3U) && (strncmp(arg->str, "ADD", 3U) == 0) && (n != 0) && ((n % 2) == 0)) {
+    if (_LedSeqFits((uint32_t)n / 2U) != 0) {
+      return -1;
+    }
+    for (i = 0U; i < (uint32_t)n; i += 2U) {
+      if ((val[i] < 0) || (val[i] > (int32_t)LED_MASK_ALL) ||
+          (val[i + 1U] <= 0) || (val[i + 1U] > (int32_t)LEDSEQ_MAX_MS)) {
+        return -1;
+      }
+    }
+    for (i = 0U; i < (uint32_t)n; i += 2U) {
+      (void)LedSeq_Add((uint32_t)val[i], (uint32_t)val[i + 1U]);
+    }
+  } else if ((kw == 3U) && (strncmp(arg->str, "RUN", 3U) == 0) && (n <= 1)) {
+    if (((n == 1) && (val[0] < 0)) || (LedSeq_Start((n == 1) ? (uint32_t)val[0] : 0U) != 0)) {
+      return -1;
+    }
+  } else if ((kw == 4U) && (strncmp(arg->str, "STOP", 4U) == 0) && (n == 0)) {
+    LedSeq_Stop();
+  } else {
+    return -1;
+  }
+  AT_Puts(resp, "OK\r\n");
+  return 0;
+}
+
+// Binary LEDSEQ query/set, see the op list at the top of the file
+static int _Bin_LEDSEQ (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  LedSeq_Status st;
+  uint32_t      i, ms;
+
+  if (form == AT_FORM_QUERY) {
+    if (len != 0U) {
+      return -1;
+    }
+    LedSeq_GetStatus(&st);
+    if ((_PutLE(resp, st.steps,   1U) != 0) ||
+        (_PutLE(resp, st.running, 1U) != 0) ||
+        (_PutLE(resp, st.step,    1U) != 0) ||
+        (_PutLE(resp, st.loops,   4U) != 0)) {
+      return -1;
+    }
+    return 0;
+  }
+  if (len == 0U) {
+    return -1;
+  }
+  switch (in[0]) {
+    case 0U:                            // CLR
+      if (len != 1U) { return -1; }
+      LedSeq_Clear();
+      break;
+    case 1U:                            // ADD {u8 mask, u16 ms}*
+      if ((len < 4U) || (((len - 1U) % 3U) != 0U) || (_LedSeqFits((len - 1U) / 3U) != 0)) {
+        return -1;
+      }
+      for (i = 1U; i < len; i += 3U) {
+        ms = (uint32_t)in[i + 1U] | ((uint32_t)in[i + 2U] << 8);
+        if ((ms == 0U) || (ms > LEDSEQ_MAX_MS)) {
+          return -1;
+        }
+      }
+      for (i = 1U; i < len; i += 3U) {
+        (void)LedSeq_Add(in[i], (uint32_t)in[i + 1U] | ((uint32_t)in[i + 2U] << 8));
+      }
+      break;
+    case 2U:                            // RUN u8 repeat
+      if (len != 2U) { return -1; }
+      return LedSeq_Start(in[1]);
+    case 3U:                            // STOP
+      if (len != 1U) { return -1; }
+      LedSeq_Stop();
+      break;
+    default:
+      return -1;
+  }
+  return 0;
+}
+
+// AT+LCD=<text>, AT+LCD?
+static int _Cmd_LCD (const AT_Arg *arg, AT_Resp *resp) {
+  char text[LCD_STRING_SIZE];
+
+  if (arg->form == AT_FORM_QUERY) {
+    (void)readLCDString(text, sizeof(text));
+    AT_Printf(resp, "+LCD: %s\r\n", text);
+    return 0;
+  }
+  storeLCDString(arg->str);
+  (void)readLCDString(text, sizeof(text));
+  AT_Printf(resp, "LCD string set to: %s\r\n", text);
+  return 0;
+}
+
+// Binary LCD query/set: text without terminator
+static int _Bin_LCD (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  char text[LCD_STRING_SIZE];
+
+  if (form == AT_FORM_QUERY) {
+    if (len != 0U) {
+      return -1;
+    }
+    (void)readLCDString(text, sizeof(text));
+    return AT_Write(resp, text, (uint32_t)strlen(text));
+  }
+  if ((len == 0U) || (len >= LCD_STRING_SIZE) || (memchr(in, 0, len) != NULL)) {
+    return -1;
+  }
+  memcpy(text, in, len);
+  text[len] = '\0';
+  storeLCDString(text);
+  return 0;
+}
+
+// AT+ACQ=<hz>, AT+ACQ?
+static int _Cmd_ACQ (const AT_Arg *arg, AT_Resp *resp) {
+  AdcAcq_Stats st;
+
+  if (arg->form == AT_FORM_QUERY) {
+    AdcAcq_GetStats(&st);
+    AT_Printf(resp, "+ACQ: %u,%u,%u,%u\r\n", st.rate, st.samples, st.last, st.filtered);
+    return 0;
+  }
+  if ((arg->num <= 0) || (AdcAcq_SetRate((uint32_t)arg->num) != 0)) {
+    return -1;
+  }
+  AT_Puts(resp, "OK\r\n");
+  return 0;
+}
+
+// Binary ACQ query/set
+static int _Bin_ACQ (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  AdcAcq_Stats st;
+
+  if (form == AT_FORM_QUERY) {
+    if (len != 0U) {
+      return -1;
+    }
+    AdcAcq_GetStats(&st);
+    if ((_PutLE(resp, st.rate,     4U) != 0) ||
+        (_PutLE(resp, st.samples,  4U) != 0) ||
+        (_PutLE(resp, st.last,     2U) != 0) ||
+        (_PutLE(resp, st.filtered, 2U) != 0)) {
+      return -1;
+    }
+    return 0;
+  }
+  if (len != 4U) {
+    return -1;
+  }
+  return AdcAcq_SetRate((uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24));
+}
+
+// Executor thread: format queued button events as unsolicited messages.
+static void _Btn_Notify (AT_Resp *resp) {
+  BtnDrv_Event ev;
+
+  while ((resp->len + 40U < resp->size) && (BtnDrv_GetEvent(&ev) == 0)) {
+    AT_Printf(resp, "+BUTTON: %u,%s,0x%X,%u\r\n", ev.button + 1U,
+              (ev.pressed != 0U) ? "PRESS" : "RELEASE", ev.mask, ev.time);
+  }
+}
+
+// Interrupt context: button events were queued.
+static void _Btn_Event (void) {
+  (void)AT_Exec_Notify(btn_sub, _Btn_Notify);
+}
+
+#ifdef BENCH
+// AT+BENCH
+static int _Cmd_BENCH (const AT_Arg *arg, AT_Resp *resp) {
+  (void)arg;
+  Bench_Start(resp->channel);
+  AT_Puts(resp, "OK\r\n");
+  return 0;
+}
+#endif
+
+// AT+BUTTON, AT+BUTTON?, AT+BUTTON=SUB|UNSUB
+static int _Cmd_BUTTON (const AT_Arg *arg, AT_Resp *resp) {
+  BtnDrv_Event ev;
+  uint32_t     mask, left, i, lock;
+
+  if (arg->form == AT_FORM_SET) {
+    if (strcmp(arg->str, "SUB") == 0) {
+      if (btn_sub == 0U) {
+        while (BtnDrv_GetEvent(&ev) == 0) {
+          // Drop events from before the subscription
+        }
+      }
+      lock = AT_PortLock();
+      btn_sub |= 1U << resp->channel;
+      AT_PortUnlock(lock);
+      BtnDrv_SetNotify(_Btn_Event);
+    } else if (strcmp(arg->str, "UNSUB") == 0) {
+      AT_ChannelReset(resp->channel);
+    } else {
+      return -1;
+    }
+    AT_Puts(resp, "OK\r\n");
+    return 0;
+  }
+
+  mask = BtnDrv_Read();
+  if (arg->form == AT_FORM_QUERY) {
+    AT_Printf(resp, "+BUTTON: 0x%X\r\n", mask);
+    return 0;
+  }
+  if (mask == 0U) {
+    AT_Puts(resp, "No button is pressed\r\n");
+  } else if (mask == BTN_MASK_ALL) {
+    AT_Puts(resp, "All buttons are pressed\r\n");
+  } else {
+    // "Button 1, Button 2 and Button 4 are pressed"
+    left = mask;
+    for (i = 0U; i < BTN_NUM; i++) {
+      if ((left & (1U << i)) == 0U) {
+        continue;
+      }
+      left &= ~(1U << i);
+      AT_Printf(resp, "Button %u", i + 1U);
+      if (left != 0U) {
+        AT_Puts(resp, ((left & (left - 1U)) == 0U) ? " and " : ", ");
+      }
+    }
+    AT_Puts(resp, ((mask & (mask - 1U)) == 0U) ? " is pressed\r\n" : " are pressed\r\n");
+  }
+  return 0;
+}
+
+// Binary BUTTON exec/query: u8 mask
+static int _Bin_BUTTON (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  (void)in;
+
+  if ((form == AT_FORM_SET) || (len != 0U)) {
+    return -1;                          // Subscriptions are text only
+  }
+  return _PutLE(resp, BtnDrv_Read(), 1U);
+}
+
+// AT+CMDQ?
+static int _Cmd_CMDQ (const AT_Arg *arg, AT_Resp *resp) {
+  AT_Exec_Stats st;
+
+  (void)arg;
+
+  AT_Exec_GetStats(&st);
+  AT_Printf(resp, "+CMDQ: %u,%u,%u,%u\r\n", st.depth, st.depth_max, st.posted, st.dropped);
+  return 0;
+}
+
+// Binary CMDQ query: u32 depth, max, posted, dropped
+static int _Bin_CMDQ (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  AT_Exec_Stats st;
+
+  (void)form;
+  (void)in;
+
+  if (len != 0U) {
+    return -1;
+  }
+  AT_Exec_GetStats(&st);
+  if ((_PutLE(resp, st.depth,     4U) != 0) ||
+      (_PutLE(resp, st.depth_max, 4U) != 0) ||
+      (_PutLE(resp, st.posted,    4U) != 0) ||
+      (_PutLE(resp, st.dropped,   4U) != 0)) {
+    return -1;
+  }
+  return 0;
+}
+
+// AT+MODE=AT|BIN argument
+static int _Parse_MODE (AT_Arg *arg) {
+  if (strcmp(arg->str, "AT") == 0) {
+    arg->num = AT_MODE_TEXT;
+  } else if (strcmp(arg->str, "BIN") == 0) {
+    arg->num = AT_MODE_BIN;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+// AT+MODE=AT|BIN, AT+MODE?
+static int _Cmd_MODE (const AT_Arg *arg, AT_Resp *resp) {
+  if (arg->form == AT_FORM_QUERY) {
+    AT_Printf(resp, "+MODE: %s\r\n", (AT_Exec_GetMode(resp->channel) == AT_MODE_BIN) ? "BIN" : "AT");
+    return 0;
+  }
+  AT_Exec_SetMode(resp->channel, (uint32_t)arg->num);
+  AT_Puts(resp, "OK\r\n");
+  return 0;
+}
+
+// Binary MODE query/set: u8 mode
+static int _Bin_MODE (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  if (form == AT_FORM_QUERY) {
+    return (len == 0U) ? _PutLE(resp, AT_Exec_GetMode(resp->channel), 1U) : -1;
+  }
+  if ((len != 1U) || (in[0] > AT_MODE_BIN)) {
+    return -1;
+  }
+  AT_Exec_SetMode(resp->channel, in[0]);
+  return 0;
+}
+
+// AT+POT, AT+POT?
+static int _Cmd_POT (const AT_Arg *arg, AT_Resp *resp) {
+  int32_t potValue;
+
+  (void)arg;
+
+  ReadPot(&potValue);
+  AT_Printf(resp, "Potentiometer value: %d\r\n", potValue);
+  return 0;
+}
+
+// Binary POT exec/query: u16 value
+static int _Bin_POT (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  int32_t potValue;
+
+  (void)form;
+  (void)in;
+
+  if (len != 0U) {
+    return -1;
+  }
+  ReadPot(&potValue);
+  return _PutLE(resp, (uint32_t)potValue, 2U);
+}
+
+// AT+POTSTREAM=<hz>[,<dec>], AT+POTSTREAM?
+static int _Cmd_POTSTREAM (const AT_Arg *arg, AT_Resp *resp) {
+  AdcStream_Stats st;
+  int32_t         val[2];
+  int             n;
+
+  if (arg->form == AT_FORM_QUERY) {
+    AdcStream_GetStats(&st);
+    AT_Printf(resp, "+POTSTREAM: %u,%u,%u,%u,%u\r\n", st.running, st.rate, st.dec, st.blocks, st.dropped);
+    return 0;
+  }
+  n = AT_ParseInts(arg->str, arg->len, val, 2U);
+  if ((n < 1) || (val[0] < 0)) {
+    return -1;
+  }
+  if (val[0] == 0) {
+    AdcStream_Stop();
+  } else {
+    if (n == 1) {
+      val[1] = 1;
+    }
+    if ((resp->channel != AT_CHANNEL_USB) || (val[1] < 1) ||
+        (AdcStream_Start((uint32_t)val[0], (uint32_t)val[1]) != 0)) {
+      return -1;
+    }
+  }
+  AT_Puts(resp, "OK\r\n");
+  return 0;
+}
+
+// AT+PROF, AT+PROF?, AT+PROF=<site>|RESET
+static int _Cmd_PROF (const AT_Arg *arg, AT_Resp *resp) {
+  Prof_Entry e;
+  uint32_t   i, b;
+
+  if (arg->form == AT_FORM_SET) {
+    if (strcmp(arg->str, "RESET") == 0) {
+      Prof_Reset();
+      AT_Puts(resp, "OK\r\n");
+      return 0;
+    }
+    for (i = 0U; i < PROF_SITES; i++) {
+      if (strcmp(arg->str, Prof_SiteName((Prof_Site)i)) == 0) {
+        break;
+      }
+    }
+    if (i == PROF_SITES) {
+      return -1;
+    }
+    Prof_Get((Prof_Site)i, &e);
+    AT_Printf(resp, "+PROF: %s", Prof_SiteName((Prof_Site)i));
+    for (b = 0U; b < PROF_BUCKETS; b++) {
+      AT_Printf(resp, ",%u", e.hist[b]);
+    }
+    AT_Puts(resp, "\r\n");
+    return 0;
+  }
+  for (i = 0U; i < PROF_SITES; i++) {
+    Prof_Get((Prof_Site)i, &e);
+    if (e.count != 0U) {
+      AT_Printf(resp, "+PROF: %s,%u,%u,%u,%u\r\n", Prof_SiteName((Prof_Site)i), e.count,
+                Prof_CyclesToUs(e.min), Prof_CyclesToUs(e.sum / e.count), Prof_CyclesToUs(e.max));
+    }
+  }
+  return 0;
+}
+
+// AT+SENSORS, AT+SENSORS?
+static int _Cmd_SENSORS (const AT_Arg *arg, AT_Resp *resp) {
+  AdcAcq_Sensors s;
+  uint32_t       t;
+
+  (void)arg;
+
+  AdcAcq_GetSensors(&s);
+  t = (s.temp < 0) ? (uint32_t)-s.temp : (uint32_t)s.temp;
+  AT_Printf(resp, "+SENSORS: %u,%s%u.%u,%u\r\n", s.pot, (s.temp < 0) ? "-" : "", t / 10U, t % 10U, s.vdda);
+  return 0;
+}
+
+// Binary SENSORS exec/query: u16 pot, i16 temperature, u16 VDDA
+static int _Bin_SENSORS (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  AdcAcq_Sensors s;
+
+  (void)form;
+  (void)in;
+
+  if (len != 0U) {
+    return -1;
+  }
+  AdcAcq_GetSensors(&s);
+  if ((_PutLE(resp, s.pot, 2U) != 0) ||
+      (_PutLE(resp, (uint32_t)s.temp, 2U) != 0)) {
+    return -1;
+  }
+  return _PutLE(resp, s.vdda, 2U);
+}
+
+// AT+STATS, AT+STATS?, AT+STATS=THREADS, AT+STATS=BOOT
+static int _Cmd_STATS (const AT_Arg *arg, AT_Resp *resp) {
+  Stats_Counters c;
+  uint32_t       boot_ms[STATS_BOOT_NUM];
+  uint32_t       i, num, mask;
+
+  if (arg->form == AT_FORM_SET) {
+    if (strcmp(arg->str, "BOOT") == 0) {
+      mask = Stats_GetBoot(boot_ms);
+      for (i = 0U; i < STATS_BOOT_NUM; i++) {
+        if ((mask & (1U << i)) != 0U) {
+          AT_Printf(resp, "+STATS: BOOT,%s,%u\r\n", Stats_BootName((Stats_Boot)i), boot_ms[i]);
+        }
+      }
+      return 0;
+    }
+    if (strcmp(arg->str, "THREADS") != 0) {
+      return -1;
+    }
+    num = Stats_GetThreads(stats_thr, STATS_THREADS_MAX);
+    for (i = 0U; i < num; i++) {
+      AT_Printf(resp, "+STATS: THREAD,%s,%u,%u,%u\r\n", stats_thr[i].name,
+                stats_thr[i].stack_used, stats_thr[i].stack_size, stats_thr[i].priority);
+    }
+    return 0;
+  }
+  Stats_GetCounters(&c);
+  AT_Printf(resp, "+STATS: CPU,%u.%u,%u.%u,%u\r\n",
+            c.cpu_load / 10U, c.cpu_load % 10U, c.cpu_peak / 10U, c.cpu_peak % 10U, c.uptime);
+  AT_Printf(resp, "+STATS: STACK,%u,%u\r\n", c.threads, c.stack_free);
+  AT_Printf(resp, "+STATS: HEAP,%u,%u,%u\r\n", c.heap_used, c.heap_free, c.heap_peak);
+  AT_Printf(resp, "+STATS: CMDQ,%u,%u,%u\r\n", c.cmdq_depth, c.cmdq_max, c.cmdq_dropped);
+  AT_Printf(resp, "+STATS: DROP,%u,%u,%u,%u,%u,%u\r\n", c.usb_dropped, c.uart_dropped,
+            c.uart_overruns, c.adc_errors, c.stream_dropped, c.tcp_dropped);
+  AT_Printf(resp, "+STATS: NET,%u,%u\r\n", c.tcp_active, c.telem_errors);
+  AT_Printf(resp, "+STATS: VNC,%u,%u,%u,%u\r\n", c.vnc_viewers, c.vnc_fps, c.vnc_bytes_per_s, c.vnc_stalls);
+  return 0;
+}
+
+// Binary STATS exec/query: u32 counters; set: u8 thread index
+static int _Bin_STATS (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  Stats_Counters      c;
+  const uint32_t     *val;
+  const Stats_Thread *t;
+  uint32_t            i, num, name_len;
+
+  if (form != AT_FORM_SET) {
+    if (len != 0U) {
+      return -1;
+    }
+    Stats_GetCounters(&c);
+    val = (const uint32_t *)&c;         // All fields are u32
+    for (i = 0U; i < (sizeof(c) / sizeof(uint32_t)); i++) {
+      if (_PutLE(resp, val[i], 4U) != 0) {
+        return -1;
+      }
+    }
+    return 0;
+  }
+  if (len != 1U) {
+    return -1;
+  }
+  num = Stats_GetThreads(stats_thr, STATS_THREADS_MAX);
+  if (in[0] >= num) {
+    return -1;
+  }
+  t        = &stats_thr[in[0]];
+  name_len = 0U;
+  while ((name_len < 16U) && (t->name[name_len] != '\0')) {
+    name_len++;
+  }
+  if ((_PutLE(resp, num,           1U) != 0) ||
+      (_PutLE(resp, t->priority,   1U) != 0) ||
+      (_PutLE(resp, t->stack_used, 4U) != 0) ||
+      (_PutLE(resp, t->stack_size, 4U) != 0)) {
+    return -1;
+  }
+  return AT_Write(resp, t->name, name_len);
+}
+
+// Parse a dotted IPv4 address, returns the characters used or 0 on error.
+// The address is returned in network byte order.
+static uint32_t _ParseIp (const char *str, uint32_t len, uint32_t *addr) {
+  uint32_t i, n, octet, val;
+
+  i   = 0U;
+  val = 0U;
+  for (n = 0U; n < 4U; n++) {
+    if ((n != 0U) && ((i >= len) || (str[i++] != '.'))) {
+      return 0U;
+    }
+    if ((i >= len) || (str[i] < '0') || (str[i] > '9')) {
+      return 0U;
+    }
+    for (octet = 0U; (i < len) && (str[i] >= '0') && (str[i] <= '9'); i++) {
+      octet = (octet * 10U) + (uint32_t)(str[i] - '0');
+      if (octet > 255U) {
+        return 0U;
+      }
+    }
+    val |= octet << (8U * n);
+  }
+  *addr = val;
+  return i;
+}
+
+// AT+TELEM=<ip>,<port>[,<ms>], AT+TELEM=OFF, AT+TELEM?
+static int _Cmd_TELEM (const AT_Arg *arg, AT_Resp *resp) {
+  Telem_Status st;
+  uint32_t     addr, used;
+  int32_t      val[2];
+  int          n;
+
+  if (arg->form == AT_FORM_QUERY) {
+    Telem_GetStatus(&st);
+    AT_Printf(resp, "+TELEM: %u.%u.%u.%u,%u,%u,%u,%u\r\n",
+              st.addr & 0xFFU, (st.addr >> 8) & 0xFFU, (st.addr >> 16) & 0xFFU, st.addr >> 24,
+              st.port, st.interval, st.sent, st.errors);
+    return 0;
+  }
+  if (strcmp(arg->str, "OFF") == 0) {
+    Telem_GetStatus(&st);
+    if (Telem_Configure(0U, 0U, st.interval) != 0) {
+      return -1;
+    }
+  } else {
+    used = _ParseIp(arg->str, arg->len, &addr);
+    if ((used == 0U) || (used >= arg->len) || (arg->str[used] != ',')) {
+      return -1;
+    }
+    used++;
+    n = AT_ParseInts(&arg->str[used], arg->len - used, val, 2U);
+    if (n == 1) {
+      val[1] = TELEM_INTERVAL_DEFAULT;
+    }
+    if ((n < 1) || (val[0] <= 0) || (val[0] > 65535) || (val[1] <= 0) ||
+        (Telem_Configure(addr, (uint16_t)val[0], (uint32_t)val[1]) != 0)) {
+      return -1;
+    }
+  }
+  AT_Puts(resp, "OK\r\n");
+  return 0;
+}
+
+// Binary TELEM query/set: u8 ip[4], u16 port, u16 ms
+static int _Bin_TELEM (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp) {
+  Telem_Status st;
+  uint32_t     addr;
+
+  if (form == AT_FORM_QUERY) {
+    if (len != 0U) {
+      return -1;
+    }
+    Telem_GetStatus(&st);
+    if ((AT_Write(resp, &st.addr, 4U) != 0) ||
+        (_PutLE(resp, st.port,     2U) != 0) ||
+        (_PutLE(resp, st.interval, 2U) != 0) ||
+        (_PutLE(resp, st.sent,     4U) != 0) ||
+        (_PutLE(resp, st.errors,   4U) != 0)) {
+      return -1;
+    }
+    return 0;
+  }
+  if (len != 8U) {
+    return -1;
+  }
+  memcpy(&addr, in, 4U);                // Network byte order as sent
+  return Telem_Configure(addr, (uint16_t)(in[4] | ((uint32_t)in[5] << 8)),
+                         (uint32_t)in[6] | ((uint32_t)in[7] << 8));
+}
+
+// Called by transports when a session ends.
+void AT_ChannelReset (uint32_t channel) {
+  uint32_t lock;
+
+  lock = AT_PortLock();
+  btn_sub &= ~(1U << channel);
+  AT_PortUnlock(lock);
+}
+
+// Command table, sorted by verb
+static const AT_Cmd at_cmd_table[] = {
+//  verb       forms                 max_arg              parse          handler       opcode  bin
+  { "ACQ",     AT_SET  | AT_QUERY,   6U,                  AT_ParseInt,   _Cmd_ACQ,     0x30U,  _Bin_ACQ    },
+#ifdef BENCH
+  { "BENCH",   AT_EXEC,              0U,                  NULL,          _Cmd_BENCH,   0U,     NULL        },
+#endif
+  { "BUTTON",  AT_EXEC | AT_QUERY | AT_SET, 5U,          AT_ParseText,  _Cmd_BUTTON,  0x10U,  _Bin_BUTTON },
+  { "CMDQ",    AT_QUERY,             0U,                  NULL,          _Cmd_CMDQ,    0x14U,  _Bin_CMDQ   },
+  { "LCD",     AT_SET  | AT_QUERY,   LCD_STRING_SIZE - 1, AT_ParseText,  _Cmd_LCD,     0x18U,  _Bin_LCD    },
+  { "LED",     AT_SET  | AT_QUERY,   4U,                  AT_ParseInt,   _Cmd_LED,     0x1CU,  _Bin_LED    },
+  { "LEDPWM",  AT_SET  | AT_QUERY,   5U,                  AT_ParseText,  _Cmd_LEDPWM,  0x28U,  _Bin_LEDPWM },
+  { "LEDSEQ",  AT_SET  | AT_QUERY,   AT_LINE_MAX - 1,     AT_ParseText,  _Cmd_LEDSEQ,  0x2CU,  _Bin_LEDSEQ },
+  { "MODE",    AT_SET  | AT_QUERY,   3U,                  _Parse_MODE,   _Cmd_MODE,    0x20U,  _Bin_MODE   },
+  { "POT",     AT_EXEC | AT_QUERY,   0U,                  NULL,          _Cmd_POT,     0x24U,  _Bin_POT    },
+  { "POTSTREAM", AT_SET | AT_QUERY,  12U,                 AT_ParseText,  _Cmd_POTSTREAM, 0U,   NULL        },
+  { "PROF",    AT_EXEC | AT_QUERY | AT_SET, 15U,         AT_ParseText,  _Cmd_PROF,    0U,     NULL        },
+  { "SENSORS", AT_EXEC | AT_QUERY,   0U,                  NULL,          _Cmd_SENSORS, 0x34U,  _Bin_SENSORS },
+  { "STATS",   AT_EXEC | AT_QUERY | AT_SET, 7U,          AT_ParseText,  _Cmd_STATS,   0x3CU,  _Bin_STATS  },
+  { "TELEM",   AT_SET  | AT_QUERY,   32U,                 AT_ParseText,  _Cmd_TELEM,   0x38U,  _Bin_TELEM  },
+};
+
+#define AT_CMD_NUM              (sizeof(at_cmd_table) / sizeof(at_cmd_table[0]))
+
+int process_AT_command (const char *line, uint32_t len, AT_Resp *resp) {
+  return AT_Dispatch(at_cmd_table, AT_CMD_NUM, line, len, resp);
+}
+
+int process_BIN_frame (const uint8_t *frame, uint32_t len, AT_Resp *resp) {
+  return AT_BinDispatch(at_cmd_table, AT_CMD_NUM, frame, len, resp);
+}
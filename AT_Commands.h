@@ -0,0 +1,37 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Commands.h
+ * Purpose: Board AT command set
+ *----------------------------------------------------------------------------*/
+
+#ifndef AT_COMMANDS_H_
+#define AT_COMMANDS_H_
+
+#include <stdint.h>
+
+#include "AT_Parser.h"
+#include "AT_Binary.h"
+
+#define LCD_STRING_SIZE         (50)
+
+// LCD text mailbox between the command executor and the GUI thread.
+// storeLCDString sets the host text and wakes the GUI, which picks it up
+// when getLCDVersion changes; editLCDString stores text typed on the GUI
+// without posting it back.
+extern void     storeLCDString (const char *lcdString);
+extern void     editLCDString  (const char *lcdString);
+extern uint32_t readLCDString  (char *buf, uint32_t size);
+extern uint32_t getLCDVersion  (void);
+
+// Drop per-channel command state (event subscriptions) when a transport
+// session on the channel ends.
+extern void AT_ChannelReset    (uint32_t channel);
+
+// Execute one framed command line, appending the reply to resp.
+// \return      0 on success, -1 if an ERROR reply was generated
+extern int  process_AT_command (const char *line, uint32_t len, AT_Resp *resp);
+
+// Execute one decoded binary frame, appending the encoded reply frame to resp.
+// \return      0 on success, -1 if any record failed
+extern int  process_BIN_frame  (const uint8_t *frame, uint32_t len, AT_Resp *resp);
+
+#endif /* AT_COMMANDS_H_ */
@@ -0,0 +1,287 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Executor.c
+ * Purpose: AT command executor thread
+ *----------------------------------------------------------------------------*/
+/*
+ * Transport callbacks only frame lines and hand them to AT_Exec_Post,
+ * which copies each line into a block of a fixed memory pool and posts
+ * the block pointer to a message queue. The executor thread takes lines
+ * from the queue, runs them through process_AT_command and passes the
+ * reply to the output function registered for the source channel
+ * (USB CDC or one of the TCP clients of AT_TcpServer.c).
+ * Binary protocol frames (AT_Binary.c) take the same path and run the
+ * same command handlers.
+ *
+ * Unsolicited messages (e.g. +BUTTON: events) are queued as a notifier
+ * with AT_Exec_Notify, usually from an interrupt. The executor thread
+ * calls it to format the text and sends it to the subscribed channels,
+ * so the executor stays the only producer of every channel's TX path.
+ *
+ * Slow commands (for example an ADC conversion) therefore only delay
+ * the executor thread, never the USB or network stack threads.
+ */
+
+#include <string.h>
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+#include "cmsis_os2.h"
+#include "rtx_os.h"
+
+#include "AT_Commands.h"
+#include "AT_Executor.h"
+#include "Prof.h"
+#include "AppEvr.h"
+
+// Message data size: a text line or a decoded binary frame
+#define AT_MSG_DATA_SIZE        ((AT_BIN_FRAME_MAX > AT_LINE_MAX) ? AT_BIN_FRAME_MAX : AT_LINE_MAX)
+
+#define AT_MSG_OVERFLOW         (1U << 0)       // Text line overflowed
+#define AT_MSG_BINARY           (1U << 1)       // Binary frame
+#define AT_MSG_NOTIFY           (1U << 2)       // Notifier, channel = mask
+
+typedef struct {
+  uint8_t  channel;
+  uint8_t  flags;
+  uint16_t len;
+  char     data[AT_MSG_DATA_SIZE + 1U];
+} AT_Msg;
+
+static uint32_t          at_pool_mem[osRtxMemoryPoolMemSize(AT_EXEC_QUEUE_DEPTH, sizeof(AT_Msg)) / 4U] __attribute__((section(".bss.dtcm")));
+static uint32_t          at_queue_mem[osRtxMessageQueueMemSize(AT_EXEC_QUEUE_DEPTH, sizeof(AT_Msg *)) / 4U] __attribute__((section(".bss.dtcm")));
+static uint64_t          at_exec_stk[AT_EXEC_STACK_SIZE / 8U] __attribute__((section(".bss.dtcm")));
+
+static const osMemoryPoolAttr_t at_pool_attr = {
+  .name    = "AT_Pool",
+  .mp_mem  = at_pool_mem,
+  .mp_size = sizeof(at_pool_mem)
+};
+
+static const osMessageQueueAttr_t at_queue_attr = {
+  .name    = "AT_Queue",
+  .mq_mem  = at_queue_mem,
+  .mq_size = sizeof(at_queue_mem)
+};
+
+static const osThreadAttr_t at_exec_attr = {
+  .name       = "AT_Executor",
+  .stack_mem  = &at_exec_stk[0],
+  .stack_size = sizeof(at_exec_stk),
+  .priority   = AT_EXEC_PRIORITY
+};
+
+static osMemoryPoolId_t  at_pool;
+static osMessageQueueId_t at_queue;
+static osThreadId_t      at_exec_tid;
+
+static AT_Output         at_output[AT_CHANNEL_NUM];
+static volatile uint8_t  at_mode[AT_CHANNEL_NUM];
+static char              at_resp_buf[AT_EXEC_RESP_SIZE] __attribute__((section(".bss.dtcm")));
+
+static volatile uint32_t at_posted;
+static volatile uint32_t at_executed;
+static volatile uint32_t at_dropped;
+static volatile uint32_t at_depth_max;
+
+// Increment a counter shared between producer contexts.
+static void _AtomicInc (volatile uint32_t *cnt) {
+  uint32_t val;
+
+  do {
+    val = __LDREXW(cnt) + 1U;
+  } while (__STREXW(val, cnt) != 0U);
+}
+
+// Raise the queue depth high-water mark.
+static void _UpdateDepthMax (uint32_t depth) {
+  uint32_t val;
+
+  do {
+    val = __LDREXW(&at_depth_max);
+    if (depth <= val) {
+      __CLREX();
+      return;
+    }
+  } while (__STREXW(depth, &at_depth_max) != 0U);
+}
+
+// Tell all outputs that the queue is drained so buffered replies can go out.
+static void _FlushOutputs (void) {
+  uint32_t ch;
+
+  for (ch = 0U; ch < AT_CHANNEL_NUM; ch++) {
+    if (at_output[ch] != NULL) {
+      at_output[ch](ch, NULL, 0U);
+    }
+  }
+}
+
+// Run a notifier and send its text to the subscribed text mode channels.
+static void _Notify (AT_Msg *msg, AT_Resp *resp) {
+  AT_Notifier notify;
+  uint32_t    mask, ch;
+
+  memcpy(&notify, msg->data, sizeof(notify));
+  mask = msg->channel;
+  (void)osMemoryPoolFree(at_pool, msg);
+
+  notify(resp);
+  if (resp->len == 0U) {
+    return;
+  }
+  for (ch = 0U; ch < AT_CHANNEL_NUM; ch++) {
+    if (((mask & (1U << ch)) != 0U) && (at_output[ch] != NULL) && (at_mode[ch] == AT_MODE_TEXT)) {
+      at_output[ch](ch, resp->buf, resp->len);
+    }
+  }
+}
+
+// Thread: Executes queued command lines
+__NO_RETURN static void AT_Exec_Thread (void *arg) {
+  AT_Msg   *msg;
+  AT_Resp   resp;
+  AT_Output output;
+  uint32_t  msg_channel, start;
+
+  (void)arg;
+
+  for (;;) {
+    if (osMessageQueueGet(at_queue, &msg, NULL, osWaitForever) != osOK) {
+      continue;
+    }
+    resp.buf     = at_resp_buf;
+    resp.size    = sizeof(at_resp_buf);
+    resp.len     = 0U;
+    resp.channel = msg->channel;
+    if ((msg->flags & AT_MSG_NOTIFY) != 0U) {
+      _Notify(msg, &resp);
+      if (osMessageQueueGetCount(at_queue) == 0U) {
+        _FlushOutputs();
+      }
+      continue;
+    }
+    AppEvr_Record(EVR_AT_DISPATCH, msg->channel, msg->flags);
+    start = Prof_Begin();
+    if ((msg->flags & AT_MSG_BINARY) != 0U) {
+      (void)process_BIN_frame((const uint8_t *)msg->data, msg->len, &resp);
+    } else if ((msg->flags & AT_MSG_OVERFLOW) != 0U) {
+      AT_Puts(&resp, "ERROR\r\n");
+    } else {
+      (void)process_AT_command(msg->data, msg->len, &resp);
+    }
+    Prof_End(PROF_AT_COMMAND, start);
+    msg_channel = msg->channel;
+    AppEvr_Record(EVR_AT_COMPLETE, msg_channel, resp.len);
+    output = (msg_channel < AT_CHANNEL_NUM) ? at_output[msg_channel] : NULL;
+    (void)osMemoryPoolFree(at_pool, msg);
+    at_executed++;
+
+    if ((output != NULL) && (resp.len != 0U)) {
+      output(msg_channel, resp.buf, resp.len);
+    }
+    if (osMessageQueueGetCount(at_queue) == 0U) {
+      _FlushOutputs();
+    }
+  }
+}
+
+// Create pool, queue and executor thread.
+int AT_Exec_Initialize (void) {
+
+  at_pool  = osMemoryPoolNew(AT_EXEC_QUEUE_DEPTH, sizeof(AT_Msg), &at_pool_attr);
+  at_queue = osMessageQueueNew(AT_EXEC_QUEUE_DEPTH, sizeof(AT_Msg *), &at_queue_attr);
+  if ((at_pool == NULL) || (at_queue == NULL)) {
+    return -1;
+  }
+  at_exec_tid = osThreadNew(AT_Exec_Thread, NULL, &at_exec_attr);
+  if (at_exec_tid == NULL) {
+    return -1;
+  }
+  return 0;
+}
+
+// Register the reply output for a channel.
+void AT_Exec_SetOutput (uint32_t channel, AT_Output output) {
+  if (channel < AT_CHANNEL_NUM) {
+    at_output[channel] = output;
+  }
+}
+
+// Copy data into a pool block and queue it.
+static int _Post (uint32_t channel, const void *data, uint32_t len, uint32_t flags) {
+  AT_Msg *msg;
+
+  if ((at_pool == NULL) || (len > AT_MSG_DATA_SIZE)) {
+    _AtomicInc(&at_dropped);
+    AppEvr_Record(EVR_AT_DROP, channel, len);
+    return -1;
+  }
+  msg = osMemoryPoolAlloc(at_pool, 0U);
+  if (msg == NULL) {
+    _AtomicInc(&at_dropped);
+    AppEvr_Record(EVR_AT_DROP, channel, len);
+    return -1;
+  }
+  msg->channel = (uint8_t)channel;
+  msg->flags   = (uint8_t)flags;
+  msg->len     = (uint16_t)len;
+  memcpy(msg->data, data, len);
+  msg->data[len] = '\0';
+
+  if (osMessageQueuePut(at_queue, &msg, 0U, 0U) != osOK) {
+    (void)osMemoryPoolFree(at_pool, msg);
+    _AtomicInc(&at_dropped);
+    AppEvr_Record(EVR_AT_DROP, channel, len);
+    return -1;
+  }
+  _AtomicInc(&at_posted);
+  AppEvr_Record(EVR_AT_RECEIVE, channel, len);
+  _UpdateDepthMax(osMessageQueueGetCount(at_queue));
+  return 0;
+}
+
+// Queue a framed line for execution.
+int AT_Exec_Post (uint32_t channel, const char *line, uint32_t len, uint32_t overflow) {
+  if (len >= AT_LINE_MAX) {
+    _AtomicInc(&at_dropped);
+    return -1;
+  }
+  return _Post(channel, line, len, (overflow != 0U) ? AT_MSG_OVERFLOW : 0U);
+}
+
+// Queue a decoded binary frame for execution.
+int AT_Exec_PostFrame (uint32_t channel, const uint8_t *frame, uint32_t len) {
+  if (len > AT_BIN_FRAME_MAX) {
+    len = 0U;                           // Too long: reply with a frame error
+  }
+  return _Post(channel, frame, len, AT_MSG_BINARY);
+}
+
+// Queue a notifier for the channels in channel_mask.
+int AT_Exec_Notify (uint32_t channel_mask, AT_Notifier notify) {
+  if ((channel_mask & ((1U << AT_CHANNEL_NUM) - 1U)) == 0U) {
+    return 0;
+  }
+  return _Post(channel_mask, &notify, sizeof(notify), AT_MSG_NOTIFY);
+}
+
+// Set the protocol mode of a channel.
+void AT_Exec_SetMode (uint32_t channel, uint32_t mode) {
+  if (channel < AT_CHANNEL_NUM) {
+    at_mode[channel] = (uint8_t)mode;
+  }
+}
+
+// Get the protocol mode of a channel.
+uint32_t AT_Exec_GetMode (uint32_t channel) {
+  return (channel < AT_CHANNEL_NUM) ? at_mode[channel] : AT_MODE_TEXT;
+}
+
+// Read executor statistics.
+void AT_Exec_GetStats (AT_Exec_Stats *stats) {
+  stats->posted    = at_posted;
+  stats->executed  = at_executed;
+  stats->dropped   = at_dropped;
+  stats->depth     = (at_queue != NULL) ? osMessageQueueGetCount(at_queue) : 0U;
+  stats->depth_max = at_depth_max;
+}
@@ -0,0 +1,78 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Executor.h
+ * Purpose: AT command executor thread
+ *----------------------------------------------------------------------------*/
+
+#ifndef AT_EXECUTOR_H_
+#define AT_EXECUTOR_H_
+
+#include <stdint.h>
+
+#include "AT_Parser.h"
+#include "AT_Binary.h"
+
+// Executor Configuration ------------------------------------------------------
+
+#define AT_EXEC_QUEUE_DEPTH     (16)    // Number of pooled command lines
+#define AT_EXEC_RESP_SIZE       (1024)  // Response buffer size per command (AT+STATS=THREADS)
+#define AT_EXEC_STACK_SIZE      (2048)  // Executor thread stack size
+#define AT_EXEC_PRIORITY        osPriorityNormal
+
+//------------------------------------------------------------------------------
+
+// Command source channels
+#define AT_CHANNEL_USB          (0U)
+#define AT_CHANNEL_TCP          (1U)    // First TCP client (AT_TcpServer.h)
+#define AT_CHANNEL_TCP_NUM      (4U)    // TCP clients
+#ifdef BENCH
+#define AT_CHANNEL_BENCH        (5U)    // Benchmark runner (Bench.c)
+#define AT_CHANNEL_NUM          (6U)    // USB + 4 TCP clients + benchmark
+#else
+#define AT_CHANNEL_NUM          (5U)    // USB + 4 TCP clients
+#endif
+
+// Channel protocol modes (AT+MODE)
+#define AT_MODE_TEXT            (0U)    // AT text lines (default)
+#define AT_MODE_BIN             (1U)    // COBS framed binary protocol
+
+// Called in the executor thread with the reply of one command on channel.
+// len == 0 (buf == NULL): command queue drained, flush buffered replies.
+typedef void (*AT_Output) (uint32_t channel, const char *buf, uint32_t len);
+
+// Called in the executor thread to write pending unsolicited messages to resp.
+typedef void (*AT_Notifier) (AT_Resp *resp);
+
+typedef struct {
+  uint32_t posted;              // Lines accepted into the queue
+  uint32_t executed;            // Lines executed
+  uint32_t dropped;             // Lines dropped because pool or queue was full
+  uint32_t depth;               // Current queue depth
+  uint32_t depth_max;           // Queue depth high-water mark
+} AT_Exec_Stats;
+
+extern int  AT_Exec_Initialize (void);
+extern void AT_Exec_SetOutput  (uint32_t channel, AT_Output output);
+
+// Copy a framed line into a pool buffer and queue it for execution.
+// Never blocks; may be called from USB/network callbacks.
+// \return      0 on success, -1 if the line was dropped
+extern int  AT_Exec_Post       (uint32_t channel, const char *line, uint32_t len, uint32_t overflow);
+
+// Copy a decoded binary frame into a pool buffer and queue it for execution.
+// len == 0 or len > AT_BIN_FRAME_MAX queues a frame error reply. Never blocks.
+// \return      0 on success, -1 if the frame was dropped
+extern int  AT_Exec_PostFrame  (uint32_t channel, const uint8_t *frame, uint32_t len);
+
+// Queue a notifier whose text is sent to every text mode channel in
+// channel_mask (bit n = channel n). Never blocks; may be called from ISRs.
+// \return      0 on success, -1 if it was dropped
+extern int  AT_Exec_Notify     (uint32_t channel_mask, AT_Notifier notify);
+
+// Protocol mode of a channel. The mode is switched by the AT+MODE command
+// in the executor thread; the transport reads it to select its decoder.
+extern void     AT_Exec_SetMode (uint32_t channel, uint32_t mode);
+extern uint32_t AT_Exec_GetMode (uint32_t channel);
+
+extern void AT_Exec_GetStats   (AT_Exec_Stats *stats);
+
+#endif /* AT_EXECUTOR_H_ */
@@ -0,0 +1,276 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Parser.c
+ * Purpose: AT command line framing and table-driven dispatcher
+ *----------------------------------------------------------------------------*/
+/*
+ * Lines are terminated by '\r', a '\n' is ignored. Bytes beyond
+ * AT_LINE_MAX - 1 are dropped and the line is reported as overflowed once
+ * the terminator arrives, so the line buffer can never be overrun.
+ *
+ * A line has the form "AT+<VERB>", "AT+<VERB>?" or "AT+<VERB>=<arg>".
+ * The legacy form "AT+<VERB><digits>" (e.g. AT+LED5) is treated as SET.
+ * The verb is looked up in a const table sorted by verb. The lookup walks
+ * the table like a trie: each verb character narrows the range of
+ * candidate entries, so no string compares are needed and the cost only
+ * depends on the verb length.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "AT_Parser.h"
+
+// Reset framer state
+void AT_FramerReset (AT_Framer *fr) {
+  fr->cnt      = 0U;
+  fr->overflow = 0U;
+}
+
+// Feed received bytes into the framer, calling cb for every complete line.
+void AT_FramerFeed (AT_Framer *fr, const uint8_t *data, uint32_t len, AT_LineCallback cb, void *ctx) {
+  uint32_t i;
+  uint8_t  ch;
+
+  for (i = 0U; i < len; i++) {
+    ch = data[i];
+    if (ch == '\r') {
+      if (fr->overflow != 0U) {
+        fr->buf[0] = '\0';
+        cb(fr->buf, 0U, 1U, ctx);
+      } else if (fr->cnt != 0U) {
+        fr->buf[fr->cnt] = '\0';
+        cb(fr->buf, fr->cnt, 0U, ctx);
+      }
+      AT_FramerReset(fr);
+    } else if (ch == '\n') {
+      // Ignore line feed of "\r\n" terminated lines
+    } else if (fr->cnt < (AT_LINE_MAX - 1U)) {
+      fr->buf[fr->cnt++] = (char)ch;
+    } else {
+      fr->overflow = 1U;
+    }
+  }
+}
+
+// Narrow [*lo, *hi) to the entries whose verb has character c at position pos.
+static void _NarrowRange (const AT_Cmd *table, uint32_t *lo, uint32_t *hi, uint32_t pos, uint8_t c) {
+  uint32_t a, b, m;
+
+  a = *lo; b = *hi;
+  while (a < b) {
+    m = (a + b) / 2U;
+    if ((uint8_t)table[m].verb[pos] < c) { a = m + 1U; } else { b = m; }
+  }
+  *lo = a;
+  b   = *hi;
+  while (a < b) {
+    m = (a + b) / 2U;
+    if ((uint8_t)table[m].verb[pos] <= c) { a = m + 1U; } else { b = m; }
+  }
+  *hi = a;
+}
+
+// Find the table entry matching verb[0..len-1].
+static const AT_Cmd *_Lookup (const AT_Cmd *table, uint32_t num, const char *verb, uint32_t len) {
+  uint32_t lo, hi, pos;
+
+  lo = 0U;
+  hi = num;
+  for (pos = 0U; (pos < len) && (lo < hi); pos++) {
+    _NarrowRange(table, &lo, &hi, pos, (uint8_t)verb[pos]);
+  }
+  if (lo >= hi) {
+    return NULL;
+  }
+  // All remaining entries share the prefix; the exact match sorts first
+  if (table[lo].verb[len] != '\0') {
+    return NULL;
+  }
+  return &table[lo];
+}
+
+// Dispatch one line against a sorted command table.
+int AT_Dispatch (const AT_Cmd *table, uint32_t num, const char *line, uint32_t len, AT_Resp *resp) {
+  const AT_Cmd *cmd;
+  AT_Arg        arg;
+  uint32_t      pos, verb_len;
+
+  if ((len < 2U) || (line[0] != 'A') || (line[1] != 'T')) {
+    goto error;
+  }
+  if (len == 2U) {
+    AT_Puts(resp, "OK\r\n");            // Plain "AT"
+    return 0;
+  }
+  if (line[2] != '+') {
+    goto error;
+  }
+  pos = 3U;
+  while ((pos < len) && (line[pos] >= 'A') && (line[pos] <= 'Z')) {
+    pos++;
+  }
+  verb_len = pos - 3U;
+  if (verb_len == 0U) {
+    goto error;
+  }
+
+  memset(&arg, 0, sizeof(arg));
+  arg.str = &line[len];
+  if (pos == len) {
+    arg.form = AT_FORM_EXEC;
+  } else if ((line[pos] == '?') && ((pos + 1U) == len)) {
+    arg.form = AT_FORM_QUERY;
+  } else if (line[pos] == '=') {
+    arg.form = AT_FORM_SET;
+    arg.str  = &line[pos + 1U];
+    arg.len  = len - pos - 1U;
+  } else if ((line[pos] >= '0') && (line[pos] <= '9')) {
+    arg.form = AT_FORM_SET;             // Legacy AT+<VERB><n>
+    arg.str  = &line[pos];
+    arg.len  = len - pos;
+  } else {
+    goto error;
+  }
+
+  cmd = _Lookup(table, num, &line[3], verb_len);
+  if ((cmd == NULL) || ((cmd->forms & (1U << arg.form)) == 0U)) {
+    goto error;
+  }
+  if (arg.form == AT_FORM_SET) {
+    if (arg.len > cmd->max_arg) {
+      goto error;
+    }
+    if ((cmd->parse != NULL) && (cmd->parse(&arg) != 0)) {
+      goto error;
+    }
+  }
+  if (cmd->handler(&arg, resp) != 0) {
+    goto error;
+  }
+  return 0;
+
+error:
+  AT_Puts(resp, "ERROR\r\n");
+  return -1;
+}
+
+// Parse a decimal or 0x prefixed hexadecimal integer argument.
+int AT_ParseInt (AT_Arg *arg) {
+  const char *p   = arg->str;
+  const char *end = arg->str + arg->len;
+  uint32_t    val = 0U, base = 10U, digit;
+  int32_t     neg = 0;
+
+  if (p == end) {
+    return -1;
+  }
+  if (*p == '-') {
+    neg = 1;
+    p++;
+  }
+  if (((end - p) > 2) && (p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X'))) {
+    base = 16U;
+    p   += 2;
+  }
+  if (p == end) {
+    return -1;
+  }
+  for (; p < end; p++) {
+    if ((*p >= '0') && (*p <= '9')) {
+      digit = (uint32_t)(*p - '0');
+    } else if ((base == 16U) && (*p >= 'A') && (*p <= 'F')) {
+      digit = (uint32_t)(*p - 'A') + 10U;
+    } else if ((base == 16U) && (*p >= 'a') && (*p <= 'f')) {
+      digit = (uint32_t)(*p - 'a') + 10U;
+    } else {
+      return -1;
+    }
+    if (val > ((0x7FFFFFFFU - digit) / base)) {
+      return -1;                        // Out of range
+    }
+    val = (val * base) + digit;
+  }
+  arg->num = (neg != 0) ? -(int32_t)val : (int32_t)val;
+  return 0;
+}
+
+// Parse a comma separated list of integers.
+int AT_ParseInts (const char *str, uint32_t len, int32_t *val, uint32_t max) {
+  AT_Arg   arg;
+  uint32_t n, i;
+
+  if (len == 0U) {
+    return 0;
+  }
+  for (n = 0U; ; n++) {
+    for (i = 0U; (i < len) && (str[i] != ','); i++) {
+    }
+    if (n >= max) {
+      return -1;
+    }
+    arg.str = str;
+    arg.len = i;
+    if (AT_ParseInt(&arg) != 0) {
+      return -1;
+    }
+    val[n] = arg.num;
+    if (i == len) {
+      return (int)(n + 1U);
+    }
+    str += i + 1U;
+    len -= i + 1U;
+  }
+}
+
+// Accept any text argument (length already checked against max_arg).
+int AT_ParseText (AT_Arg *arg) {
+  (void)arg;
+  return 0;
+}
+
+// Append formatted text to the response, truncating at the buffer end.
+void AT_Printf (AT_Resp *resp, const char *fmt, ...) {
+  va_list args;
+  int     n;
+
+  if (resp->len >= resp->size) {
+    return;
+  }
+  va_start(args, fmt);
+  n = vsnprintf(&resp->buf[resp->len], resp->size - resp->len, fmt, args);
+  va_end(args);
+  if (n > 0) {
+    resp->len += (uint32_t)n;
+    if (resp->len >= resp->size) {
+      resp->len = resp->size - 1U;
+    }
+  }
+}
+
+// Append a string to the response, truncating at the buffer end.
+void AT_Puts (AT_Resp *resp, const char *str) {
+  uint32_t n;
+
+  if (resp->len >= resp->size) {
+    return;
+  }
+  n = (uint32_t)strlen(str);
+  if (n > (resp->size - resp->len - 1U)) {
+    n = resp->size - resp->len - 1U;
+  }
+  memcpy(&resp->buf[resp->len], str, n);
+  resp->len += n;
+  resp->buf[resp->len] = '\0';
+}
+
+// Append raw bytes to the response, all or nothing.
+int AT_Write (AT_Resp *resp, const void *data, uint32_t len) {
+
+  if ((resp->len > resp->size) || (len > (resp->size - resp->len))) {
+    return -1;
+  }
+  memcpy(&resp->buf[resp->len], data, len);
+  resp->len += len;
+  return 0;
+}
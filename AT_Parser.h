@@ -0,0 +1,100 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Parser.h
+ * Purpose: AT command line framing and table-driven dispatcher
+ *----------------------------------------------------------------------------*/
+
+#ifndef AT_PARSER_H_
+#define AT_PARSER_H_
+
+#include <stdint.h>
+
+// Maximum command line length including the terminating NUL
+#define AT_LINE_MAX             (64)
+
+// Command forms: AT+X (execute), AT+X? (query), AT+X=<arg> (set)
+typedef enum {
+  AT_FORM_EXEC  = 0,
+  AT_FORM_QUERY = 1,
+  AT_FORM_SET   = 2
+} AT_Form;
+
+#define AT_EXEC                 (1U << AT_FORM_EXEC)
+#define AT_QUERY                (1U << AT_FORM_QUERY)
+#define AT_SET                  (1U << AT_FORM_SET)
+
+// Parsed command argument
+typedef struct {
+  AT_Form      form;            // Form the command was issued in
+  const char  *str;             // Argument text (SET form), NUL terminated
+  uint32_t     len;             // Argument text length
+  int32_t      num;             // Numeric value (filled by AT_ParseInt)
+} AT_Arg;
+
+// Response buffer provided by the transport
+typedef struct {
+  char        *buf;
+  uint32_t     size;
+  uint32_t     len;
+  uint32_t     channel;         // Channel the command was received on
+} AT_Resp;
+
+// Argument parser: validates/converts arg->str, returns 0 on success
+typedef int (*AT_ArgParser) (AT_Arg *arg);
+
+// Command handler: writes its reply to resp, returns 0 on success
+typedef int (*AT_Handler)   (const AT_Arg *arg, AT_Resp *resp);
+
+// Binary protocol handler (AT_Binary.c): in/len is the fixed-layout
+// request payload, the reply payload is written to resp with AT_Write.
+// Returns 0 on success, -1 on a bad payload.
+typedef int (*AT_BinHandler) (AT_Form form, const uint8_t *in, uint32_t len, AT_Resp *resp);
+
+// Command table entry
+typedef struct {
+  const char  *verb;            // Verb without "AT+" prefix, upper case
+  uint8_t      forms;           // Accepted forms (AT_EXEC | AT_QUERY | AT_SET)
+  uint8_t      max_arg;         // Maximum argument length for the SET form
+  AT_ArgParser parse;           // Argument parser for the SET form (NULL: none)
+  AT_Handler   handler;
+  uint8_t      opcode;          // Binary opcode base, op = opcode + form
+  AT_BinHandler bin;            // Binary protocol handler (NULL: text only)
+} AT_Cmd;
+
+// Line framer state (one per input channel)
+typedef struct {
+  char         buf[AT_LINE_MAX];
+  uint32_t     cnt;
+  uint8_t      overflow;
+} AT_Framer;
+
+// Called by AT_FramerFeed for each complete line.
+// \param[in]   line          NUL terminated line (empty on overflow)
+// \param[in]   len           line length
+// \param[in]   overflow      1 if the line exceeded AT_LINE_MAX and was dropped
+// \param[in]   ctx           context passed to AT_FramerFeed
+typedef void (*AT_LineCallback) (const char *line, uint32_t len, uint32_t overflow, void *ctx);
+
+extern void AT_FramerReset (AT_Framer *fr);
+extern void AT_FramerFeed  (AT_Framer *fr, const uint8_t *data, uint32_t len, AT_LineCallback cb, void *ctx);
+
+// Dispatch one line against a command table sorted by verb (strcmp order).
+// \return      0 on success, -1 if an ERROR reply was generated
+extern int  AT_Dispatch    (const AT_Cmd *table, uint32_t num, const char *line, uint32_t len, AT_Resp *resp);
+
+// Standard argument parsers
+extern int  AT_ParseInt    (AT_Arg *arg);
+extern int  AT_ParseText   (AT_Arg *arg);
+
+// Parse a comma separated list of integers (AT_ParseInt syntax).
+// \return      number of values stored, -1 on a syntax error or more than max values
+extern int  AT_ParseInts   (const char *str, uint32_t len, int32_t *val, uint32_t max);
+
+// Response helpers
+extern void AT_Printf      (AT_Resp *resp, const char *fmt, ...);
+extern void AT_Puts        (AT_Resp *resp, const char *str);
+
+// Append raw bytes to the response.
+// \return      0 on success, -1 (nothing written) if they do not fit
+extern int  AT_Write       (AT_Resp *resp, const void *data, uint32_t len);
+
+#endif /* AT_PARSER_H_ */
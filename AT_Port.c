@@ -0,0 +1,43 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Port.c
+ * Purpose: Receive path shared by the AT command transports
+ *----------------------------------------------------------------------------*/
+/*
+ * Every transport (USB CDC ACM, the TCP clients) hands its received
+ * packets to AT_PortReceive, which splits them into AT text lines or, on
+ * a channel in AT+MODE=BIN, into binary frames. The mode is read once per
+ * packet: AT+MODE only takes effect when the executor runs it, so the
+ * rest of the packet that carried it is still decoded in the old mode.
+ * On a mode change the partial input of the previous protocol is dropped.
+ *
+ * The host replay harness (Host/AT_Replay.c) feeds its packets through
+ * the same function, so it tests the device receive path.
+ */
+
+#include "AT_Executor.h"
+#include "AT_Port.h"
+
+void AT_PortDecoderReset (AT_PortDecoder *dec, uint32_t channel) {
+  dec->channel = channel;
+  dec->mode    = AT_MODE_TEXT;
+  AT_FramerReset(&dec->framer);
+  AT_BinFramerReset(&dec->bin_framer);
+}
+
+void AT_PortReceive (AT_PortDecoder *dec, const uint8_t *data, uint32_t len,
+                     AT_LineCallback line, AT_FrameCallback frame, void *ctx) {
+  uint32_t mode;
+
+  mode = AT_Exec_GetMode(dec->channel);
+  if (mode != dec->mode) {
+    // Protocol switched: drop partial input of the previous protocol
+    dec->mode = mode;
+    AT_FramerReset(&dec->framer);
+    AT_BinFramerReset(&dec->bin_framer);
+  }
+  if (mode == AT_MODE_BIN) {
+    AT_BinFramerFeed(&dec->bin_framer, data, len, frame, ctx);
+  } else {
+    AT_FramerFeed(&dec->framer, data, len, line, ctx);
+  }
+}
@@ -0,0 +1,68 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Port.h
+ * Purpose: Target services and receive path of the AT command layer
+ *----------------------------------------------------------------------------*/
+/*
+ * The command layer (AT_Parser.c, AT_Binary.c, AT_Commands.c, AT_Port.c)
+ * reaches the hardware only through the driver module headers
+ * (LedDriver.h, ButtonDriver.h, AdcAcq.h, ...) and the services below.
+ * Framing and dispatch need neither HAL nor RTOS, so the layer can be
+ * built for another target by defining AT_PORT_HOST and linking stub
+ * driver modules. Host/ does so for the replay harness
+ * (make -C Host check).
+ *
+ * The transports pass received data to AT_PortReceive, which the replay
+ * harness calls the same way.
+ */
+
+#ifndef AT_PORT_H_
+#define AT_PORT_H_
+
+#include <stdint.h>
+
+#include "AT_Parser.h"
+#include "AT_Binary.h"
+
+// Input decoder of one channel (one per transport connection)
+typedef struct {
+  uint32_t     channel;         // Executor channel, selects the mode
+  uint32_t     mode;            // Decoder mode of the buffered input
+  AT_Framer    framer;
+  AT_BinFramer bin_framer;
+} AT_PortDecoder;
+
+// Start decoding channel in AT text mode, dropping any partial input.
+extern void AT_PortDecoderReset (AT_PortDecoder *dec, uint32_t channel);
+
+// Decode one received packet by the current mode of the channel
+// (AT_Exec_GetMode): line is called for every AT text line, frame for
+// every binary frame, both with ctx.
+extern void AT_PortReceive      (AT_PortDecoder *dec, const uint8_t *data, uint32_t len,
+                                 AT_LineCallback line, AT_FrameCallback frame, void *ctx);
+
+#ifndef AT_PORT_HOST
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+
+// Enter a critical section against interrupts; may be nested.
+// \return      state to pass to AT_PortUnlock
+static __INLINE uint32_t AT_PortLock (void) {
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  return primask;
+}
+
+static __INLINE void AT_PortUnlock (uint32_t state) {
+  __set_PRIMASK(state);
+}
+
+#else
+
+static inline uint32_t AT_PortLock   (void)           { return 0U; }
+static inline void     AT_PortUnlock (uint32_t state) { (void)state; }
+
+#endif
+
+#endif /* AT_PORT_H_ */
@@ -0,0 +1,322 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_TcpServer.c
+ * Purpose: AT command server on TCP
+ *----------------------------------------------------------------------------*/
+/*
+ * AT_TCP_CLIENTS native TCP sockets listen on AT_TCP_PORT, one per client,
+ * and client n is executor channel AT_CHANNEL_TCP + n. Connections are
+ * persistent (keep-alive) and commands may be pipelined.
+ *
+ * The socket callback runs in the network core thread and works like the
+ * USB transport: it frames received data into lines (or binary frames
+ * after AT+MODE=BIN) with the same AT_PortReceive and posts them to the
+ * executor, so TCP and USB share one dispatcher and one executor. The
+ * per-client state (decoder and a reply ring) is taken from a fixed
+ * memory pool on connect and returned when the connection is closed.
+ *
+ * Replies are written by the executor into the client's SPSC reply ring
+ * (RingBuf.h). The sender thread drains the rings into TCP segments of
+ * up to the maximum segment size whenever the socket is ready, i.e. the
+ * previous segment was acknowledged; queued replies are coalesced.
+ * The sender thread also frees the client state after a close, under
+ * tcp_mutex, so the executor never writes to a released ring.
+ */
+
+#include <string.h>
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+#include "cmsis_os2.h"
+#include "rtx_os.h"
+#include "rl_net.h"
+
+#include "AT_Commands.h"
+#include "AT_Port.h"
+#include "AT_TcpServer.h"
+#include "RingBuf.h"
+
+#define AT_TCP_FLAG             (1U)    // Sender thread flag: work pending
+
+typedef struct {
+  int32_t        sock;
+  uint32_t       channel;
+  AT_PortDecoder decoder;               // Lines or binary frames by channel mode
+  RingBuf        tx;
+  uint8_t        tx_mem[AT_TCP_TX_SIZE];
+} AT_TcpConn;
+
+static uint32_t          tcp_pool_mem[osRtxMemoryPoolMemSize(AT_TCP_CLIENTS, sizeof(AT_TcpConn)) / 4U];
+static uint64_t          tcp_stk[AT_TCP_STACK_SIZE / 8U];
+
+static const osMemoryPoolAttr_t tcp_pool_attr = {
+  .name    = "AT_TcpPool",
+  .mp_mem  = tcp_pool_mem,
+  .mp_size = sizeof(tcp_pool_mem)
+};
+
+static const osMutexAttr_t tcp_mutex_attr = {
+  .name      = "AT_TcpMutex",
+  .attr_bits = osMutexPrioInherit
+};
+
+static const osThreadAttr_t tcp_attr = {
+  .name       = "AT_TcpSender",
+  .stack_mem  = &tcp_stk[0],
+  .stack_size = sizeof(tcp_stk),
+  .priority   = AT_TCP_PRIORITY
+};
+
+static osMemoryPoolId_t  tcp_pool;
+static osMutexId_t       tcp_mutex;
+static osThreadId_t      tcp_tid;
+
+static int32_t           tcp_sock[AT_TCP_CLIENTS];
+static AT_TcpConn * volatile tcp_conn[AT_TCP_CLIENTS];
+static volatile uint8_t  tcp_closed[AT_TCP_CLIENTS];   // Set by the callback
+
+static volatile uint32_t tcp_connects;
+static volatile uint32_t tcp_rejects;
+static volatile uint32_t tcp_dropped;
+
+// Find the client index of a socket.
+static int32_t _Index (int32_t sock) {
+  int32_t i;
+
+  for (i = 0; i < (int32_t)AT_TCP_CLIENTS; i++) {
+    if (tcp_sock[i] == sock) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void _Wake (void) {
+  if (tcp_tid != NULL) {
+    (void)osThreadFlagsSet(tcp_tid, AT_TCP_FLAG);
+  }
+}
+
+// Queue a framed command line for the executor thread.
+static void _Line (const char *line, uint32_t len, uint32_t overflow, void *ctx) {
+  (void)AT_Exec_Post(((AT_TcpConn *)ctx)->channel, line, len, overflow);
+}
+
+// Queue a decoded binary frame for the executor thread.
+static void _Frame (const uint8_t *frame, uint32_t len, uint32_t error, void *ctx) {
+  (void)AT_Exec_PostFrame(((AT_TcpConn *)ctx)->channel, frame, (error != 0U) ? 0U : len);
+}
+
+// Socket callback (network core thread).
+static uint32_t _Listener (int32_t sock, netTCP_Event event, const NET_ADDR *addr, const uint8_t *buf, uint32_t len) {
+  AT_TcpConn *conn;
+  int32_t     i;
+
+  (void)addr;
+
+  i = _Index(sock);
+  if (i < 0) {
+    return 0U;
+  }
+  switch (event) {
+    case netTCP_EventConnect:
+      // Accept only if the previous session's state has been released
+      conn = (tcp_conn[i] == NULL) ? osMemoryPoolAlloc(tcp_pool, 0U) : NULL;
+      if (conn == NULL) {
+        tcp_rejects++;
+        return 0U;
+      }
+      conn->sock    = sock;
+      conn->channel = AT_CHANNEL_TCP + (uint32_t)i;
+      AT_PortDecoderReset(&conn->decoder, conn->channel);
+      RingBuf_Init(&conn->tx, conn->tx_mem, AT_TCP_TX_SIZE);
+      AT_Exec_SetMode(conn->channel, AT_MODE_TEXT);
+      tcp_closed[i] = 0U;
+      tcp_conn[i]   = conn;
+      tcp_connects++;
+      return 1U;
+
+    case netTCP_EventData:
+      conn = tcp_conn[i];
+      if ((conn != NULL) && (tcp_closed[i] == 0U)) {
+        AT_PortReceive(&conn->decoder, buf, len, _Line, _Frame, conn);
+      }
+      break;
+
+    case netTCP_EventACK:
+      _Wake();                          // Next segment may be sent
+      break;
+
+    case netTCP_EventClosed:
+    case netTCP_EventAborted:
+      if (tcp_conn[i] != NULL) {
+        tcp_closed[i] = 1U;
+        _Wake();
+      }
+      break;
+
+    default:
+      break;
+  }
+  return 0U;
+}
+
+// Executor output for all TCP channels: buffer replies in the client ring.
+static void _Output (uint32_t channel, const char *buf, uint32_t len) {
+  AT_TcpConn *conn;
+  uint32_t    i, wait, cnt;
+  int         done;
+
+  i = channel - AT_CHANNEL_TCP;
+  if (i >= AT_TCP_CLIENTS) {
+    return;
+  }
+  if (len != 0U) {
+    // Keep replies whole; wait a bounded time for the client to drain the ring
+    for (wait = 0U; ; wait++) {
+      done = 1;
+      cnt  = 0U;
+      (void)osMutexAcquire(tcp_mutex, osWaitForever);
+      conn = tcp_conn[i];
+      if ((conn != NULL) && (tcp_closed[i] == 0U)) {
+        if (RingBuf_Free(&conn->tx) >= len) {
+          (void)RingBuf_Write(&conn->tx, buf, len);
+          cnt = RingBuf_Count(&conn->tx);
+        } else {
+          done = 0;
+        }
+      }
+      (void)osMutexRelease(tcp_mutex);
+      if (done != 0) {
+        break;
+      }
+      if (wait >= AT_TCP_TX_TIMEOUT) {
+        tcp_dropped++;
+        return;
+      }
+      _Wake();
+      (void)osDelay(1U);
+    }
+    if (cnt < (AT_TCP_TX_SIZE / 2U)) {
+      return;                           // Wait for more replies or queue drain
+    }
+  }
+  _Wake();
+}
+
+// Send buffered replies as one segment if the socket is ready.
+static uint32_t _Send (AT_TcpConn *conn) {
+  uint8_t *seg, *data;
+  uint32_t cnt, max, n, len;
+
+  cnt = RingBuf_Count(&conn->tx);
+  if ((cnt == 0U) || !netTCP_SendReady(conn->sock)) {
+    return cnt;
+  }
+  max = netTCP_GetMaxSegmentSize(conn->sock);
+  if (cnt > max) {
+    cnt = max;
+  }
+  seg = netTCP_GetBuffer(cnt);
+  if (seg == NULL) {
+    return cnt;
+  }
+  for (n = 0U; n < cnt; n += len) {
+    len = RingBuf_Peek(&conn->tx, &data);
+    if (len > (cnt - n)) {
+      len = cnt - n;
+    }
+    memcpy(&seg[n], data, len);
+    RingBuf_Consume(&conn->tx, len);
+  }
+  // The stack releases the buffer also on error, so the replies are lost
+  if (netTCP_Send(conn->sock, seg, cnt) != netOK) {
+    tcp_dropped++;
+  }
+  return RingBuf_Count(&conn->tx);
+}
+
+// Release the state of a closed client and listen again.
+static void _Release (uint32_t i) {
+  AT_TcpConn *conn;
+
+  (void)osMutexAcquire(tcp_mutex, osWaitForever);
+  conn          = tcp_conn[i];
+  tcp_conn[i]   = NULL;
+  tcp_closed[i] = 0U;
+  (void)osMutexRelease(tcp_mutex);
+
+  if (conn != NULL) {
+    AT_ChannelReset(conn->channel);
+    (void)osMemoryPoolFree(tcp_pool, conn);
+  }
+  if (netTCP_GetState(tcp_sock[i]) == netTCP_StateCLOSED) {
+    (void)netTCP_Listen(tcp_sock[i], AT_TCP_PORT);
+  }
+}
+
+// Thread: Sends buffered replies and releases closed clients
+__NO_RETURN static void AT_Tcp_Thread (void *arg) {
+  AT_TcpConn *conn;
+  uint32_t    i, pending;
+
+  (void)arg;
+
+  pending = 0U;
+  for (;;) {
+    // Wake on replies/ACKs; poll while data waits for a busy socket
+    (void)osThreadFlagsWait(AT_TCP_FLAG, osFlagsWaitAny, (pending != 0U) ? 10U : osWaitForever);
+    pending = 0U;
+    for (i = 0U; i < AT_TCP_CLIENTS; i++) {
+      if (tcp_closed[i] != 0U) {
+        _Release(i);
+        continue;
+      }
+      conn = tcp_conn[i];
+      if (conn != NULL) {
+        pending += _Send(conn);
+      }
+    }
+  }
+}
+
+int AT_Tcp_Initialize (void) {
+  uint32_t i;
+  int32_t  sock;
+
+  tcp_pool  = osMemoryPoolNew(AT_TCP_CLIENTS, sizeof(AT_TcpConn), &tcp_pool_attr);
+  tcp_mutex = osMutexNew(&tcp_mutex_attr);
+  if ((tcp_pool == NULL) || (tcp_mutex == NULL)) {
+    return -1;
+  }
+  tcp_tid = osThreadNew(AT_Tcp_Thread, NULL, &tcp_attr);
+  if (tcp_tid == NULL) {
+    return -1;
+  }
+  for (i = 0U; i < AT_TCP_CLIENTS; i++) {
+    sock = netTCP_GetSocket(_Listener);
+    if (sock < 0) {
+      return -1;
+    }
+    tcp_sock[i] = sock;
+    (void)netTCP_SetOption(sock, netTCP_OptionKeepAlive, 1U);
+    AT_Exec_SetOutput(AT_CHANNEL_TCP + i, _Output);
+    if (netTCP_Listen(sock, AT_TCP_PORT) != netOK) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void AT_Tcp_GetStats (AT_Tcp_Stats *stats) {
+  uint32_t i;
+
+  stats->active = 0U;
+  for (i = 0U; i < AT_TCP_CLIENTS; i++) {
+    if (tcp_conn[i] != NULL) {
+      stats->active++;
+    }
+  }
+  stats->connects = tcp_connects;
+  stats->rejects  = tcp_rejects;
+  stats->dropped  = tcp_dropped;
+}
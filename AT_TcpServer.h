@@ -0,0 +1,39 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_TcpServer.h
+ * Purpose: AT command server on TCP
+ *----------------------------------------------------------------------------*/
+
+#ifndef AT_TCP_SERVER_H_
+#define AT_TCP_SERVER_H_
+
+#include <stdint.h>
+
+#include "AT_Executor.h"
+
+// TCP Command Server Configuration --------------------------------------------
+
+#define AT_TCP_PORT             (2323U) // Listening port
+#define AT_TCP_TX_SIZE          (1024)  // Reply ring size per client (power of 2)
+#define AT_TCP_TX_TIMEOUT       (100U)  // Wait for ring space [ms]
+#define AT_TCP_STACK_SIZE       (1024)  // Sender thread stack size
+#define AT_TCP_PRIORITY         osPriorityNormal
+
+//------------------------------------------------------------------------------
+
+// One executor channel per client, AT_CHANNEL_TCP + n
+#define AT_TCP_CLIENTS          AT_CHANNEL_TCP_NUM
+
+typedef struct {
+  uint32_t connects;            // Accepted connections
+  uint32_t rejects;             // Connections rejected (no free client)
+  uint32_t active;              // Open connections
+  uint32_t dropped;             // Replies dropped (ring full or send failed)
+} AT_Tcp_Stats;
+
+// Open the listening sockets and start the sender thread.
+// Call after netInitialize and AT_Exec_Initialize.
+extern int  AT_Tcp_Initialize (void);
+
+extern void AT_Tcp_GetStats   (AT_Tcp_Stats *stats);
+
+#endif /* AT_TCP_SERVER_H_ */
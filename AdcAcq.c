@@ -0,0 +1,309 @@
+/*------------------------------------------------------------------------------
+ * Name:    AdcAcq.c
+ * Purpose: Timer triggered ADC acquisition (potentiometer and sensors)
+ *----------------------------------------------------------------------------*/
+/*
+ * TIM2 update events (TRGO) trigger ADC3 conversions of the potentiometer
+ * (PA0, ADC3_IN0) at a fixed rate and DMA2 Stream0 writes the results into
+ * a circular buffer. The half and full transfer interrupts run every
+ * sample of the completed half through an IIR low-pass filter, so readers
+ * only fetch the filtered value and never start or wait for a conversion.
+ * An optional block hook gets each completed half in place (AdcStream.c).
+ *
+ * Sensors: TIM5 triggers an ADC1 scan of the potentiometer (PA0 is
+ * ADC123_IN0), the die temperature sensor and VREFINT at ACQ_SENSOR_RATE,
+ * and DMA2 Stream4 stores the three results in one burst. The transfer
+ * complete interrupt converts them with the factory calibration values
+ * (VREFINT_CAL, TS_CAL1/TS_CAL2, measured at VDDA = 3.3 V) into a snapshot
+ * that is published with a sequence counter, so readers always get the
+ * three values of one scan.
+ *
+ * The DMA buffers are placed in the non-cacheable SRAM2 region (MPU region 1,
+ * section .bss.nocache in the scatter file), so the CPU always reads what
+ * the DMA wrote without cache maintenance.
+ */
+
+#include "main.h"
+#include "AdcAcq.h"
+#include "AppEvr.h"
+
+// Factory calibration values (system memory)
+#define VREFINT_CAL             (*(const uint16_t *)0x1FF0F44AU)
+#define TS_CAL1                 (*(const uint16_t *)0x1FF0F44CU)        // 30 degC
+#define TS_CAL2                 (*(const uint16_t *)0x1FF0F44EU)        // 110 degC
+#define CAL_VDDA_MV             (3300U)
+
+extern ADC_HandleTypeDef hadc3;
+
+static uint16_t          acq_buf[ACQ_BUF_SAMPLES] __attribute__((section(".bss.nocache"), aligned(32)));
+static uint16_t          acq_scan[3]              __attribute__((section(".bss.nocache"), aligned(32)));
+
+static ADC_HandleTypeDef hadc1;
+static DMA_HandleTypeDef hdma_adc1;
+static DMA_HandleTypeDef hdma_adc3;
+
+static AdcAcq_Sensors    acq_sensors;
+static volatile uint32_t acq_sensors_seq;       // Odd while being updated
+
+static uint32_t          acq_rate = ACQ_RATE_DEFAULT;
+static volatile uint32_t acq_filt;      // Filter state, value << ACQ_IIR_SHIFT
+static volatile uint32_t acq_last;
+static volatile uint32_t acq_samples;
+static volatile uint32_t acq_errors;
+static volatile AdcAcq_BlockHook acq_hook;
+
+// APB1 timer kernel clock
+static uint32_t _TimerClock (void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+// Filter a block of samples.
+static void _Process (const uint16_t *buf, uint32_t num) {
+  uint32_t filt, i;
+
+  filt = acq_filt;
+  for (i = 0U; i < num; i++) {
+    filt = filt + buf[i] - (filt >> ACQ_IIR_SHIFT);
+  }
+  acq_filt     = filt;
+  acq_last     = buf[num - 1U];
+  acq_samples += num;
+
+  if (acq_hook != NULL) {
+    acq_hook(buf, num);
+  }
+}
+
+// Convert a finished scan into the published snapshot.
+static void _Convert (void) {
+  uint32_t vdda, ts;
+  int32_t  temp;
+
+  if (acq_scan[2] == 0U) {
+    return;
+  }
+  vdda = (CAL_VDDA_MV * VREFINT_CAL) / acq_scan[2];
+  ts   = (acq_scan[1] * vdda) / CAL_VDDA_MV;    // Scale to the calibration VDDA
+  temp = 300 + ((((int32_t)ts - (int32_t)TS_CAL1) * 800) / ((int32_t)TS_CAL2 - (int32_t)TS_CAL1));
+
+  acq_sensors_seq++;
+  __DMB();
+  acq_sensors.pot  = acq_scan[0];
+  acq_sensors.temp = temp;
+  acq_sensors.vdda = vdda;
+  acq_sensors.scans++;
+  __DMB();
+  acq_sensors_seq++;
+}
+
+// Set up the ADC1 sensor scan: pot, temperature, VREFINT triggered by TIM5.
+static int _SensorInit (void) {
+  ADC_ChannelConfTypeDef ch = {0};
+
+  __HAL_RCC_ADC1_CLK_ENABLE();
+  hdma_adc1.Instance                 = DMA2_Stream4;
+  hdma_adc1.Init.Channel             = DMA_CHANNEL_0;
+  hdma_adc1.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  hdma_adc1.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_adc1.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_adc1.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+  hdma_adc1.Init.Mode                = DMA_CIRCULAR;
+  hdma_adc1.Init.Priority            = DMA_PRIORITY_LOW;
+  hdma_adc1.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_adc1) != HAL_OK) {
+    return -1;
+  }
+  __HAL_LINKDMA(&hadc1, DMA_Handle, hdma_adc1);
+
+  hadc1.Instance                   = ADC1;
+  hadc1.Init.ClockPrescaler        = ADC_CLOCK_SYNC_PCLK_DIV4;
+  hadc1.Init.Resolution            = ADC_RESOLUTION_12B;
+  hadc1.Init.ScanConvMode          = ADC_SCAN_ENABLE;
+  hadc1.Init.ContinuousConvMode    = DISABLE;
+  hadc1.Init.DiscontinuousConvMode = DISABLE;
+  hadc1.Init.ExternalTrigConvEdge  = ADC_EXTERNALTRIGCONVEDGE_RISING;
+  hadc1.Init.ExternalTrigConv      = ADC_EXTERNALTRIGCONV_T5_TRGO;
+  hadc1.Init.DataAlign             = ADC_DATAALIGN_RIGHT;
+  hadc1.Init.NbrOfConversion       = 3U;
+  hadc1.Init.DMAContinuousRequests = ENABLE;
+  hadc1.Init.EOCSelection          = ADC_EOC_SEQ_CONV;
+  if (HAL_ADC_Init(&hadc1) != HAL_OK) {
+    return -1;
+  }
+  // Temperature sensor and VREFINT need >= 10 us sampling time
+  ch.Channel      = ADC_CHANNEL_0;
+  ch.Rank         = ADC_REGULAR_RANK_1;
+  ch.SamplingTime = ADC_SAMPLETIME_84CYCLES;
+  if (HAL_ADC_ConfigChannel(&hadc1, &ch) != HAL_OK) {
+    return -1;
+  }
+  ch.Channel      = ADC_CHANNEL_TEMPSENSOR;
+  ch.Rank         = ADC_REGULAR_RANK_2;
+  ch.SamplingTime = ADC_SAMPLETIME_480CYCLES;
+  if (HAL_ADC_ConfigChannel(&hadc1, &ch) != HAL_OK) {
+    return -1;
+  }
+  ch.Channel      = ADC_CHANNEL_VREFINT;
+  ch.Rank         = ADC_REGULAR_RANK_3;
+  if (HAL_ADC_ConfigChannel(&hadc1, &ch) != HAL_OK) {
+    return -1;
+  }
+
+  NVIC_SetPriority(DMA2_Stream4_IRQn, ACQ_IRQ_PRIO);
+  NVIC_EnableIRQ(DMA2_Stream4_IRQn);
+
+  // TIM5: update event at ACQ_SENSOR_RATE drives TRGO
+  __HAL_RCC_TIM5_CLK_ENABLE();
+  TIM5->CR1 = TIM_CR1_URS;
+  TIM5->CR2 = TIM_CR2_MMS_1;
+  TIM5->PSC = 0U;
+  TIM5->ARR = (_TimerClock() / ACQ_SENSOR_RATE) - 1U;
+  TIM5->EGR = TIM_EGR_UG;
+
+  if (HAL_ADC_Start_DMA(&hadc1, (uint32_t *)acq_scan, 3U) != HAL_OK) {
+    return -1;
+  }
+  TIM5->CR1 |= TIM_CR1_CEN;
+  return 0;
+}
+
+// Reconfigure ADC3 for TIM2 triggered conversions with circular DMA
+// and start the ADC1 sensor scan.
+int AdcAcq_Initialize (void) {
+  ADC_ChannelConfTypeDef ch = {0};
+
+  __HAL_RCC_DMA2_CLK_ENABLE();
+  hdma_adc3.Instance                 = DMA2_Stream0;
+  hdma_adc3.Init.Channel             = DMA_CHANNEL_2;
+  hdma_adc3.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  hdma_adc3.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_adc3.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_adc3.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_adc3.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+  hdma_adc3.Init.Mode                = DMA_CIRCULAR;
+  hdma_adc3.Init.Priority            = DMA_PRIORITY_LOW;
+  hdma_adc3.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_adc3) != HAL_OK) {
+    return -1;
+  }
+  __HAL_LINKDMA(&hadc3, DMA_Handle, hdma_adc3);
+
+  hadc3.Init.ContinuousConvMode    = DISABLE;
+  hadc3.Init.ExternalTrigConv      = ADC_EXTERNALTRIGCONV_T2_TRGO;
+  hadc3.Init.ExternalTrigConvEdge  = ADC_EXTERNALTRIGCONVEDGE_RISING;
+  hadc3.Init.DMAContinuousRequests = ENABLE;
+  hadc3.Init.EOCSelection          = ADC_EOC_SINGLE_CONV;
+  if (HAL_ADC_Init(&hadc3) != HAL_OK) {
+    return -1;
+  }
+  ch.Channel      = ADC_CHANNEL_0;
+  ch.Rank         = ADC_REGULAR_RANK_1;
+  ch.SamplingTime = ADC_SAMPLETIME_84CYCLES;    // Pot is a high impedance source
+  if (HAL_ADC_ConfigChannel(&hadc3, &ch) != HAL_OK) {
+    return -1;
+  }
+
+  NVIC_SetPriority(DMA2_Stream0_IRQn, ACQ_IRQ_PRIO);
+  NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+  // TIM2: update event at acq_rate drives TRGO
+  __HAL_RCC_TIM2_CLK_ENABLE();
+  TIM2->CR1 = TIM_CR1_URS;
+  TIM2->CR2 = TIM_CR2_MMS_1;            // MMS = 010: update -> TRGO
+  TIM2->PSC = 0U;
+  TIM2->ARR = (_TimerClock() / acq_rate) - 1U;
+  TIM2->EGR = TIM_EGR_UG;
+
+  if (HAL_ADC_Start_DMA(&hadc3, (uint32_t *)acq_buf, ACQ_BUF_SAMPLES) != HAL_OK) {
+    return -1;
+  }
+  TIM2->CR1 |= TIM_CR1_CEN;
+
+  return _SensorInit();
+}
+
+int AdcAcq_SetRate (uint32_t rate) {
+  if ((rate == 0U) || (rate > ACQ_RATE_MAX)) {
+    return -1;
+  }
+  acq_rate  = rate;
+  TIM2->ARR = (_TimerClock() / rate) - 1U;
+  TIM2->EGR = TIM_EGR_UG;               // Restart the period with the new rate
+  return 0;
+}
+
+uint32_t AdcAcq_GetValue (void) {
+  return acq_filt >> ACQ_IIR_SHIFT;
+}
+
+void AdcAcq_GetStats (AdcAcq_Stats *stats) {
+  stats->rate     = acq_rate;
+  stats->samples  = acq_samples;
+  stats->last     = acq_last;
+  stats->filtered = acq_filt >> ACQ_IIR_SHIFT;
+  stats->errors   = acq_errors;
+}
+
+void AdcAcq_SetBlockHook (AdcAcq_BlockHook hook) {
+  acq_hook = hook;
+}
+
+void AdcAcq_GetSensors (AdcAcq_Sensors *sensors) {
+  uint32_t seq;
+
+  do {
+    seq = acq_sensors_seq;
+    __DMB();
+    *sensors = acq_sensors;
+    __DMB();
+  } while (((seq & 1U) != 0U) || (seq != acq_sensors_seq));
+}
+
+// DMA half transfer: first half of the ring is complete
+void HAL_ADC_ConvHalfCpltCallback (ADC_HandleTypeDef *hadc) {
+  if (hadc->Instance == ADC3) {
+    _Process(&acq_buf[0], ACQ_BUF_SAMPLES / 2U);
+    AppEvr_Record(EVR_ADC_BLOCK, 0U, ACQ_BUF_SAMPLES / 2U);
+  }
+}
+
+// DMA transfer complete: second half of the ring / sensor scan is complete
+void HAL_ADC_ConvCpltCallback (ADC_HandleTypeDef *hadc) {
+  if (hadc->Instance == ADC3) {
+    _Process(&acq_buf[ACQ_BUF_SAMPLES / 2U], ACQ_BUF_SAMPLES / 2U);
+    AppEvr_Record(EVR_ADC_BLOCK, 1U, ACQ_BUF_SAMPLES / 2U);
+  } else if (hadc->Instance == ADC1) {
+    _Convert();
+    AppEvr_Record(EVR_ADC_SCAN, (uint32_t)acq_sensors.pot, (uint32_t)acq_sensors.temp);
+  }
+}
+
+// Overrun or DMA error: the HAL stopped the transfer, start it again
+void HAL_ADC_ErrorCallback (ADC_HandleTypeDef *hadc) {
+  AppEvr_Record(EVR_ADC_ERROR, (hadc->Instance == ADC3) ? 3U : 1U, hadc->ErrorCode);
+  if (hadc->Instance == ADC3) {
+    acq_errors++;
+    (void)HAL_ADC_Stop_DMA(hadc);
+    (void)HAL_ADC_Start_DMA(hadc, (uint32_t *)acq_buf, ACQ_BUF_SAMPLES);
+  } else if (hadc->Instance == ADC1) {
+    acq_errors++;
+    (void)HAL_ADC_Stop_DMA(hadc);
+    (void)HAL_ADC_Start_DMA(hadc, (uint32_t *)acq_scan, 3U);
+  }
+}
+
+void DMA2_Stream0_IRQHandler (void);
+void DMA2_Stream0_IRQHandler (void) {
+  HAL_DMA_IRQHandler(&hdma_adc3);
+}
+
+void DMA2_Stream4_IRQHandler (void);
+void DMA2_Stream4_IRQHandler (void) {
+  HAL_DMA_IRQHandler(&hdma_adc1);
+}
@@ -0,0 +1,59 @@
+/*------------------------------------------------------------------------------
+ * Name:    AdcAcq.h
+ * Purpose: Timer triggered ADC acquisition (potentiometer and sensors)
+ *----------------------------------------------------------------------------*/
+
+#ifndef ADC_ACQ_H_
+#define ADC_ACQ_H_
+
+#include <stdint.h>
+
+// ADC Acquisition Configuration -----------------------------------------------
+
+#define ACQ_RATE_DEFAULT        (1000U) // Default sample rate [Hz]
+#define ACQ_RATE_MAX            (100000U)
+#define ACQ_BUF_SAMPLES         (256U)  // DMA ring size, processed in halves
+#define ACQ_IIR_SHIFT           (4U)    // IIR filter: y += (x - y) / 2^shift
+#define ACQ_IRQ_PRIO            (6U)    // DMA interrupt priority
+#define ACQ_SENSOR_RATE         (10U)   // Sensor scan rate [Hz]
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+  uint32_t rate;                // Sample rate [Hz]
+  uint32_t samples;             // Samples processed since start
+  uint32_t last;                // Latest raw sample
+  uint32_t filtered;            // Filtered value
+  uint32_t errors;              // DMA/overrun errors (acquisition restarted)
+} AdcAcq_Stats;
+
+// Latest sensor scan
+typedef struct {
+  uint32_t pot;                 // Potentiometer, raw 12 bit
+  int32_t  temp;                // Die temperature [0.1 degC]
+  uint32_t vdda;                // Analog supply from VREFINT [mV]
+  uint32_t scans;               // Completed scans
+} AdcAcq_Sensors;
+
+// Called in the DMA interrupt with every completed half of the ring.
+// The samples stay valid until the DMA reaches that half again.
+typedef void (*AdcAcq_BlockHook) (const uint16_t *buf, uint32_t num);
+
+extern int      AdcAcq_Initialize (void);
+
+// Change the sample rate (1..ACQ_RATE_MAX Hz).
+// \return      0 on success, -1 if out of range
+extern int      AdcAcq_SetRate    (uint32_t rate);
+
+// Latest filtered potentiometer value (12 bit), never blocks.
+extern uint32_t AdcAcq_GetValue   (void);
+
+extern void     AdcAcq_GetStats   (AdcAcq_Stats *stats);
+
+// Install (NULL: remove) the half buffer hook, e.g. for streaming.
+extern void     AdcAcq_SetBlockHook (AdcAcq_BlockHook hook);
+
+// Consistent copy of the latest sensor scan, never blocks.
+extern void     AdcAcq_GetSensors (AdcAcq_Sensors *sensors);
+
+#endif /* ADC_ACQ_H_ */
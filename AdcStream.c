@@ -0,0 +1,188 @@
+/*------------------------------------------------------------------------------
+ * Name:    AdcStream.c
+ * Purpose: Binary potentiometer sample stream (AT+POTSTREAM)
+ *----------------------------------------------------------------------------*/
+/*
+ * The stream hooks into the ADC acquisition (AdcAcq_SetBlockHook) and
+ * turns every completed DMA half buffer into one block:
+ *
+ *   sync(2) count(2) seq(4) dropped(4)  sample(2) * count
+ *
+ * The samples are copied into one of three block buffers in the
+ * interrupt: the whole half without decimation, every dec-th sample with
+ * it. One buffer is being filled, one can be ready and one can be owned
+ * by the transport, so the interrupt never waits. The DMA half itself is
+ * not handed out, as it is overwritten while a slow transport sends it.
+ *
+ * Only one block is kept ready. If the transport has not taken it when
+ * the next block completes it is replaced and counted as dropped; its
+ * sequence number is skipped, so the host sees both the gap and the drop
+ * counter.
+ *
+ * The stream owns the ADC rate while it runs: Start saves the rate the
+ * acquisition ran at and Stop puts it back, so AT+POT filters and reports
+ * the same way before and after a stream.
+ */
+
+#include <string.h>
+
+#include "main.h"
+#include "cmsis_os2.h"
+#include "AdcStream.h"
+
+#define STREAM_NBUF             (3)
+
+static uint16_t          stream_buf[STREAM_NBUF][STREAM_BLOCK_SAMPLES];
+
+static volatile uint8_t  stream_run;
+static uint32_t          stream_rate_prev;      // ADC rate before Start
+static uint32_t          stream_dec;
+static uint32_t          stream_phase;
+static uint32_t          stream_fill;   // Buffer being filled
+static uint32_t          stream_cnt;    // Samples in the fill buffer
+
+static const uint16_t   *pend_data;     // Ready block (NULL: none)
+static uint32_t          pend_count;
+static uint32_t          pend_seq;
+static int32_t           pend_idx;      // Buffer index
+static volatile int32_t  busy_idx = -1; // Buffer owned by the transport
+
+static uint32_t          stream_seq;
+static volatile uint32_t stream_dropped;
+static volatile uint32_t stream_blocks;
+
+static osThreadId_t      stream_tid;
+static uint32_t          stream_flag;
+
+// Make a block ready and wake the transport (interrupt context).
+static void _Ready (const uint16_t *data, uint32_t count, int32_t idx) {
+  if (pend_data != NULL) {
+    stream_dropped++;                   // Transport did not keep up
+  }
+  pend_data  = data;
+  pend_count = count;
+  pend_seq   = stream_seq++;
+  pend_idx   = idx;
+  if (stream_tid != NULL) {
+    (void)osThreadFlagsSet(stream_tid, stream_flag);
+  }
+}
+
+// Pick a buffer that is neither ready nor owned by the transport.
+static uint32_t _FreeBuf (void) {
+  uint32_t i;
+
+  for (i = 0U; i < STREAM_NBUF; i++) {
+    if (((pend_data == NULL) || ((int32_t)i != pend_idx)) && ((int32_t)i != busy_idx)) {
+      break;
+    }
+  }
+  return i;
+}
+
+// AdcAcq block hook: one DMA half buffer is complete.
+static void _Hook (const uint16_t *buf, uint32_t num) {
+  uint32_t i;
+
+  if (stream_run == 0U) {
+    return;
+  }
+  if (stream_dec == 1U) {
+    if (num > STREAM_BLOCK_SAMPLES) {
+      num = STREAM_BLOCK_SAMPLES;
+    }
+    memcpy(stream_buf[stream_fill], buf, num * sizeof(uint16_t));
+    _Ready(stream_buf[stream_fill], num, (int32_t)stream_fill);
+    stream_fill = _FreeBuf();
+    return;
+  }
+  for (i = 0U; i < num; i++) {
+    if (++stream_phase < stream_dec) {
+      continue;
+    }
+    stream_phase = 0U;
+    stream_buf[stream_fill][stream_cnt++] = buf[i];
+    if (stream_cnt == STREAM_BLOCK_SAMPLES) {
+      _Ready(stream_buf[stream_fill], stream_cnt, (int32_t)stream_fill);
+      stream_fill = _FreeBuf();
+      stream_cnt  = 0U;
+    }
+  }
+}
+
+int AdcStream_Start (uint32_t rate, uint32_t dec) {
+  AdcAcq_Stats acq;
+
+  if ((dec == 0U) || (dec > STREAM_DEC_MAX)) {
+    return -1;
+  }
+  AdcStream_Stop();
+  AdcAcq_GetStats(&acq);
+  if (AdcAcq_SetRate(rate) != 0) {
+    return -1;
+  }
+  __disable_irq();
+  stream_rate_prev = acq.rate;
+  stream_dec       = dec;
+  stream_phase     = 0U;
+  stream_fill      = 0U;
+  stream_cnt       = 0U;
+  stream_seq       = 0U;
+  stream_dropped   = 0U;
+  stream_blocks    = 0U;
+  stream_run       = 1U;
+  __enable_irq();
+  AdcAcq_SetBlockHook(_Hook);
+  return 0;
+}
+
+void AdcStream_Stop (void) {
+  uint32_t run;
+
+  __disable_irq();
+  run        = stream_run;
+  stream_run = 0U;
+  pend_data  = NULL;
+  __enable_irq();
+  if (run != 0U) {
+    (void)AdcAcq_SetRate(stream_rate_prev);
+  }
+}
+
+void AdcStream_SetSignal (void *thread, uint32_t flag) {
+  stream_flag = flag;
+  stream_tid  = (osThreadId_t)thread;
+}
+
+int AdcStream_Take (AdcStream_Block *blk) {
+  __disable_irq();
+  if (pend_data == NULL) {
+    __enable_irq();
+    return -1;
+  }
+  blk->hdr.sync    = STREAM_SYNC;
+  blk->hdr.count   = (uint16_t)pend_count;
+  blk->hdr.seq     = pend_seq;
+  blk->hdr.dropped = stream_dropped;
+  blk->data        = pend_data;
+  busy_idx         = pend_idx;
+  pend_data        = NULL;
+  stream_blocks++;
+  __enable_irq();
+  return 0;
+}
+
+void AdcStream_Release (void) {
+  busy_idx = -1;
+}
+
+void AdcStream_GetStats (AdcStream_Stats *stats) {
+  AdcAcq_Stats acq;
+
+  AdcAcq_GetStats(&acq);
+  stats->running = stream_run;
+  stats->rate    = acq.rate;
+  stats->dec     = stream_dec;
+  stats->blocks  = stream_blocks;
+  stats->dropped = stream_dropped;
+}
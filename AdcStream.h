@@ -0,0 +1,59 @@
+/*------------------------------------------------------------------------------
+ * Name:    AdcStream.h
+ * Purpose: Binary potentiometer sample stream (AT+POTSTREAM)
+ *----------------------------------------------------------------------------*/
+
+#ifndef ADC_STREAM_H_
+#define ADC_STREAM_H_
+
+#include <stdint.h>
+
+#include "AdcAcq.h"
+
+// ADC Stream Configuration ----------------------------------------------------
+
+#define STREAM_BLOCK_SAMPLES    (ACQ_BUF_SAMPLES / 2U)  // Samples per block
+#define STREAM_DEC_MAX          (10000U)        // Maximum decimation factor
+#define STREAM_SYNC             (0x5AA5U)       // Block header sync word
+
+//------------------------------------------------------------------------------
+
+// Block header, followed by count little endian u16 samples (12 bit)
+typedef struct {
+  uint16_t sync;                // STREAM_SYNC
+  uint16_t count;               // Samples in this block
+  uint32_t seq;                 // Block sequence number, from 0 at start
+  uint32_t dropped;             // Blocks dropped since start
+} AdcStream_Hdr;
+
+typedef struct {
+  AdcStream_Hdr   hdr;
+  const uint16_t *data;         // Samples, valid until AdcStream_Release
+} AdcStream_Block;
+
+typedef struct {
+  uint32_t running;             // 1 while streaming
+  uint32_t rate;                // ADC sample rate [Hz]
+  uint32_t dec;                 // Decimation factor
+  uint32_t blocks;              // Blocks handed to the transport
+  uint32_t dropped;             // Blocks dropped (transport too slow)
+} AdcStream_Stats;
+
+// Set the ADC rate and start streaming every dec-th sample.
+// \return      0 on success, -1 if rate or dec is out of range
+extern int  AdcStream_Start   (uint32_t rate, uint32_t dec);
+
+// Stop streaming and restore the ADC rate from before AdcStream_Start.
+extern void AdcStream_Stop    (void);
+
+// Thread flag set on thread when a block is ready (from the DMA interrupt).
+extern void AdcStream_SetSignal (void *thread, uint32_t flag);
+
+// Transport: take the next ready block, send header and data, then release.
+// \return      0 if a block was taken, -1 if none is ready
+extern int  AdcStream_Take    (AdcStream_Block *blk);
+extern void AdcStream_Release (void);
+
+extern void AdcStream_GetStats (AdcStream_Stats *stats);
+
+#endif /* ADC_STREAM_H_ */
@@ -0,0 +1,79 @@
+/*------------------------------------------------------------------------------
+ * Name:    AppEvr.h
+ * Purpose: Event Recorder events of the application pipeline
+ *----------------------------------------------------------------------------*/
+/*
+ * Application events for System Analyzer, next to the RTX and middleware
+ * events: AT command receive/dispatch/complete, ADC acquisition blocks,
+ * DMA2D start/complete, GUI frame begin/end and VNC update send. The
+ * descriptions are in EventRecorderStub.scvd (component numbers 0x01..0x05
+ * of the user range).
+ *
+ * Events are only recorded when the Event Recorder component is part of
+ * the target (Debug); otherwise the calls compile to nothing. RTX records
+ * errors only for components it does not configure (OS_EVR_LEVEL), so
+ * AppEvr_Initialize enables the application components with APP_EVR_LEVEL.
+ * EventRecord2 may be called from threads and interrupts.
+ */
+
+#ifndef APP_EVR_H_
+#define APP_EVR_H_
+
+#include <stdint.h>
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+
+// Application Event Recorder Configuration ------------------------------------
+
+#define APP_EVR_ENABLE          1       // 0 = events compile to nothing
+#define APP_EVR_LEVEL           (0x0FU) // Recorded levels: Error|API|Op|Detail
+
+//------------------------------------------------------------------------------
+
+// Component numbers (EventRecorderStub.scvd)
+#define APP_EVR_NO_AT           (0x01U) // AT command pipeline
+#define APP_EVR_NO_ADC          (0x02U) // ADC acquisition
+#define APP_EVR_NO_DMA2D        (0x03U) // DMA2D operations (LCDConf)
+#define APP_EVR_NO_GUI          (0x04U) // GUI thread
+#define APP_EVR_NO_VNC          (0x05U) // VNC sessions
+
+#if defined(RTE_Compiler_EventRecorder) && (APP_EVR_ENABLE != 0)
+
+#include "EventRecorder.h"
+
+#define APP_EVR_ID(level, no, msg)      EventID(EventLevel##level, no, msg)
+
+static __INLINE void AppEvr_Initialize (void) {
+  (void)EventRecorderEnable(APP_EVR_LEVEL, APP_EVR_NO_AT, APP_EVR_NO_VNC);
+}
+
+static __INLINE void AppEvr_Record (uint32_t id, uint32_t val1, uint32_t val2) {
+  (void)EventRecord2(id, val1, val2);
+}
+
+#else
+
+#define APP_EVR_ID(level, no, msg)      (0U)
+
+static __INLINE void AppEvr_Initialize (void) { }
+static __INLINE void AppEvr_Record (uint32_t id, uint32_t val1, uint32_t val2) { (void)id; (void)val1; (void)val2; }
+
+#endif
+
+// Events                                                  val1, val2
+#define EVR_AT_RECEIVE          APP_EVR_ID(Op,     APP_EVR_NO_AT,    0x00U)  // channel, length
+#define EVR_AT_DISPATCH         APP_EVR_ID(Op,     APP_EVR_NO_AT,    0x01U)  // channel, flags
+#define EVR_AT_COMPLETE         APP_EVR_ID(Op,     APP_EVR_NO_AT,    0x02U)  // channel, reply length
+#define EVR_AT_DROP             APP_EVR_ID(Error,  APP_EVR_NO_AT,    0x03U)  // channel, length
+#define EVR_ADC_BLOCK           APP_EVR_ID(Detail, APP_EVR_NO_ADC,   0x00U)  // half, samples
+#define EVR_ADC_SCAN            APP_EVR_ID(Detail, APP_EVR_NO_ADC,   0x01U)  // potentiometer, die temperature
+#define EVR_ADC_ERROR           APP_EVR_ID(Error,  APP_EVR_NO_ADC,   0x02U)  // ADC (1/3), HAL error code
+#define EVR_DMA2D_START         APP_EVR_ID(Op,     APP_EVR_NO_DMA2D, 0x00U)  // mode, NLR
+#define EVR_DMA2D_COMPLETE      APP_EVR_ID(Op,     APP_EVR_NO_DMA2D, 0x01U)  // mode, operation number
+#define EVR_GUI_FRAME_BEGIN     APP_EVR_ID(Op,     APP_EVR_NO_GUI,   0x00U)  // -, -
+#define EVR_GUI_FRAME_END       APP_EVR_ID(Op,     APP_EVR_NO_GUI,   0x01U)  // GUI_Exec result, -
+#define EVR_VNC_UPDATE_BEGIN    APP_EVR_ID(Op,     APP_EVR_NO_VNC,   0x00U)  // session slot, updates sent
+#define EVR_VNC_UPDATE_SENT     APP_EVR_ID(Op,     APP_EVR_NO_VNC,   0x01U)  // session slot, bytes
+
+#endif /* APP_EVR_H_ */
@@ -0,0 +1,361 @@
+/*------------------------------------------------------------------------------
+ * Name:    Bench.c
+ * Purpose: On-target benchmark runner (Benchmark target, BENCH defined)
+ *----------------------------------------------------------------------------*/
+/*
+ * The Benchmark target defines BENCH: the GUI thread runs Bench_Run
+ * instead of the dialog, and every AT+BENCH starts one run of
+ *  - DMA2D fill, copy and blend throughput through emWin (GUI_FillRect,
+ *    GUI_CopyRect, GUI_FillRect at 50 % alpha) in MPixel/s, each timed
+ *    until the LCDConf DMA2D queue is empty,
+ *  - GUI_Exec time of a full redraw of the dialog (MyDialogDLG.c),
+ *  - VNC frames/s and bytes/s of a session (VNC_Server.c) with a loopback
+ *    client that requests a full, non-incremental update as soon as the
+ *    previous one has been sent; the transport is flagged VNC_TR_UNPACED
+ *    and VNC_TR_PRIVATE, so the result is the encoder rate and neither
+ *    VNC_FPS_MAX nor copies of tiles already encoded for a viewer,
+ *  - CDC ACM bulk IN throughput: BENCH_CDC_BYTES of "+BENCH: FILL" lines
+ *    sent by the bridge thread (the host must be reading the port),
+ *  - AT command round trip latency percentiles: "AT" lines posted on the
+ *    benchmark channel (AT_CHANNEL_BENCH) until their reply arrives.
+ *
+ * Results are sent to the channel that issued AT+BENCH, one line each:
+ *   +BENCH: RUN,<n>
+ *   +BENCH: <test>,<metric>,<value>    value with three decimals
+ *   +BENCH: END,<n>
+ * A test that could not run reports the value 0.000.
+ *
+ * Short intervals are taken from the DWT cycle counter (Stats_Initialize
+ * starts it), long ones from the kernel tick.
+ */
+
+#ifdef BENCH
+
+#include <string.h>
+
+#include "cmsis_os2.h"
+#include "GUI.h"
+#include "DIALOG.h"
+
+#include "AT_Executor.h"
+#include "VNC_Server.h"
+#include "USBD_User_CDC_ACM_UART_0.h"
+#include "Prof.h"
+#include "Bench.h"
+
+#define BENCH_FLAG_START        (1U << 12)      // GUI thread flag: AT+BENCH
+#define BENCH_FLAG_REPLY        (1U << 13)      // GUI thread flag: AT reply
+
+extern WM_HWIN CreateMyDialog(void);
+extern void    LCD_X_DMA2D_Wait(void);          // LCDConf.c
+
+typedef struct {
+  const char *test;
+  const char *metric;
+  uint32_t    value;                    // Thousandths
+} Bench_Result;
+
+typedef struct {
+  uint32_t    start;                    // Session start [ticks]
+  uint32_t    pos;                      // Client handshake bytes sent
+  uint32_t    sent;                     // Update sent since the last request
+  uint32_t    bytes;
+} Bench_VncConn;
+
+static osThreadId_t      bench_tid;
+static volatile uint32_t bench_channel;
+static uint32_t          bench_runs;
+
+static Bench_Result      bench_result[BENCH_RESULTS_MAX];
+static uint32_t          bench_results;
+
+static volatile uint32_t bench_at_done;         // Cycle counter at the reply
+static uint32_t          bench_at_us[BENCH_AT_SAMPLES];
+
+static VNC_Session       bench_vnc;
+static Bench_VncConn     bench_vnc_conn;
+static uint8_t           bench_vnc_buf[BENCH_VNC_BUF_SIZE] __attribute__((section(".bss.sdram"), aligned(32)));
+
+// Client side of the RFB handshake: version 3.8, security None, shared,
+// SetEncodings Hextile, Raw
+static const uint8_t bench_vnc_hello[] = {
+  'R', 'F', 'B', ' ', '0', '0', '3', '.', '0', '0', '8', '\n',
+  1U,
+  1U,
+  2U, 0U, 0U, 2U,  0U, 0U, 0U, 5U,  0U, 0U, 0U, 0U
+};
+
+static void _Result (const char *test, const char *metric, uint32_t value) {
+  if (bench_results < BENCH_RESULTS_MAX) {
+    bench_result[bench_results].test   = test;
+    bench_result[bench_results].metric = metric;
+    bench_result[bench_results].value  = value;
+    bench_results++;
+  }
+}
+
+// Thousandths of millions per second: amount in us microseconds.
+static uint32_t _MegaRate (uint64_t amount, uint32_t us) {
+  return (us != 0U) ? (uint32_t)((amount * 1000U) / us) : 0U;
+}
+
+// Notifier (executor thread): write the results of the run.
+static void _Print (AT_Resp *resp) {
+  uint32_t i;
+
+  AT_Printf(resp, "+BENCH: RUN,%u\r\n", bench_runs);
+  for (i = 0U; i < bench_results; i++) {
+    AT_Printf(resp, "+BENCH: %s,%s,%u.%03u\r\n", bench_result[i].test, bench_result[i].metric,
+              bench_result[i].value / 1000U, bench_result[i].value % 1000U);
+  }
+  AT_Printf(resp, "+BENCH: END,%u\r\n", bench_runs);
+}
+
+// ==== Display ====
+
+// Time loops full screen fills; alpha != 0 blends them.
+static uint32_t _Fill (uint32_t loops, U8 alpha) {
+  uint32_t i, start, us;
+  int      xs, ys;
+
+  xs = LCD_GetXSize();
+  ys = LCD_GetYSize();
+  GUI_MULTIBUF_Begin();
+  (void)GUI_SetAlpha(alpha);
+  start = Prof_Begin();
+  for (i = 0U; i < loops; i++) {
+    GUI_SetColor(((i & 1U) != 0U) ? GUI_BLUE : GUI_RED);
+    GUI_FillRect(0, 0, xs - 1, ys - 1);
+  }
+  LCD_X_DMA2D_Wait();
+  us = Prof_CyclesToUs(DWT->CYCCNT - start);
+  (void)GUI_SetAlpha(0U);
+  GUI_MULTIBUF_End();
+  return _MegaRate((uint64_t)loops * (uint32_t)(xs * ys), us);
+}
+
+static void _BenchDisplay (void) {
+  uint32_t i, start, us;
+  int      xs, ys;
+
+  _Result("DMA2D_FILL",  "mpix_s", _Fill(BENCH_FILL_LOOPS, 0U));
+  _Result("DMA2D_BLEND", "mpix_s", _Fill(BENCH_BLEND_LOOPS, 0x80U));
+
+  xs = LCD_GetXSize();
+  ys = LCD_GetYSize();
+  GUI_MULTIBUF_Begin();
+  start = Prof_Begin();
+  for (i = 0U; i < BENCH_COPY_LOOPS; i++) {
+    GUI_CopyRect(0, 0, xs / 2, 0, xs / 2, ys);
+  }
+  LCD_X_DMA2D_Wait();
+  us = Prof_CyclesToUs(DWT->CYCCNT - start);
+  GUI_MULTIBUF_End();
+  _Result("DMA2D_COPY", "mpix_s", _MegaRate((uint64_t)BENCH_COPY_LOOPS * (uint32_t)((xs / 2) * ys), us));
+}
+
+static void _BenchRedraw (void) {
+  WM_HWIN  hDlg;
+  uint32_t i, start, cyc, sum, max;
+
+  hDlg = CreateMyDialog();
+  (void)GUI_Exec();
+  sum = 0U;
+  max = 0U;
+  for (i = 0U; i < BENCH_REDRAW_LOOPS; i++) {
+    WM_InvalidateWindow(hDlg);
+    start = Prof_Begin();
+    (void)GUI_Exec();
+    LCD_X_DMA2D_Wait();
+    cyc  = DWT->CYCCNT - start;
+    sum += Prof_CyclesToUs(cyc);
+    if (cyc > max) {
+      max = cyc;
+    }
+  }
+  WM_DeleteWindow(hDlg);
+  (void)GUI_Exec();
+  _Result("GUI_REDRAW", "avg_us", (sum / BENCH_REDRAW_LOOPS) * 1000U);
+  _Result("GUI_REDRAW", "max_us", Prof_CyclesToUs(max) * 1000U);
+}
+
+// ==== VNC loopback ====
+
+static int32_t _VncRecv (void *conn, uint8_t *buf, uint32_t len) {
+  Bench_VncConn *c = conn;
+  uint32_t       n;
+  int            xs, ys;
+
+  if ((osKernelGetTickCount() - c->start) >= BENCH_VNC_MS) {
+    return -1;                          // End of the session
+  }
+  if (c->pos < sizeof(bench_vnc_hello)) {
+    n = sizeof(bench_vnc_hello) - c->pos;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(buf, &bench_vnc_hello[c->pos], n);
+    c->pos += n;
+    return (int32_t)n;
+  }
+  if ((c->sent == 0U) || (len < 10U)) {
+    return 0;
+  }
+  c->sent = 0U;
+  xs = LCD_GetXSize();
+  ys = LCD_GetYSize();
+  buf[0] = 3U;                          // FramebufferUpdateRequest
+  buf[1] = 0U;                          // Not incremental
+  buf[2] = 0U; buf[3] = 0U; buf[4] = 0U; buf[5] = 0U;
+  buf[6] = (uint8_t)(xs >> 8); buf[7] = (uint8_t)xs;
+  buf[8] = (uint8_t)(ys >> 8); buf[9] = (uint8_t)ys;
+  return 10;
+}
+
+static uint8_t *_VncGetBuf (void *conn, uint32_t *size) {
+  (void)conn;
+  *size = sizeof(bench_vnc_buf);
+  return bench_vnc_buf;
+}
+
+static int32_t _VncSend (void *conn, uint8_t *buf, uint32_t len) {
+  Bench_VncConn *c = conn;
+
+  (void)buf;
+  c->bytes += len;
+  c->sent   = 1U;
+  return 0;
+}
+
+static uint32_t _VncInFlight (void *conn) {
+  (void)conn;
+  return 0U;                            // Acknowledged at once
+}
+
+static const VNC_Transport bench_vnc_transport = {
+  _VncRecv,
+  _VncGetBuf,
+  _VncSend,
+  _VncInFlight,
+  VNC_TR_UNPACED | VNC_TR_PRIVATE       // Measure encoding, not pacing or copies
+};
+
+static void _BenchVnc (void) {
+  uint32_t ms;
+  int      rc;
+
+  memset(&bench_vnc_conn, 0, sizeof(bench_vnc_conn));
+  bench_vnc_conn.start = osKernelGetTickCount();
+  rc = VNC_Server_Run(&bench_vnc, &bench_vnc_transport, &bench_vnc_conn);
+  ms = osKernelGetTickCount() - bench_vnc_conn.start;
+  if ((rc != 0) || (ms == 0U)) {
+    _Result("VNC", "fps", 0U);
+    _Result("VNC", "kbyte_s", 0U);
+    return;
+  }
+  _Result("VNC", "fps",     (uint32_t)(((uint64_t)bench_vnc.stats.updates * 1000000U) / ms));
+  _Result("VNC", "kbyte_s", (uint32_t)(((uint64_t)bench_vnc_conn.bytes * 1000U) / ms));
+}
+
+// ==== USB and commands ====
+
+static void _BenchCdc (void) {
+  uint32_t start, ms;
+
+  start = osKernelGetTickCount();
+  if (CDC0_ACM_Fill(BENCH_CDC_BYTES) != 0) {
+    _Result("CDC_BULK_IN", "kbyte_s", 0U);
+    return;
+  }
+  while (CDC0_ACM_FillStatus() == 1) {
+    if ((osKernelGetTickCount() - start) >= BENCH_CDC_TIMEOUT) {
+      break;
+    }
+    (void)osDelay(1U);
+  }
+  ms = osKernelGetTickCount() - start;
+  if ((CDC0_ACM_FillStatus() != 0) || (ms == 0U)) {
+    _Result("CDC_BULK_IN", "kbyte_s", 0U);
+    return;
+  }
+  _Result("CDC_BULK_IN", "kbyte_s", (uint32_t)(((uint64_t)BENCH_CDC_BYTES * 1000U) / ms));
+}
+
+// Reply output of the benchmark channel (executor thread).
+static void _AtOutput (uint32_t channel, const char *buf, uint32_t len) {
+  (void)channel;
+  (void)buf;
+  if (len != 0U) {
+    bench_at_done = DWT->CYCCNT;
+    (void)osThreadFlagsSet(bench_tid, BENCH_FLAG_REPLY);
+  }
+}
+
+static void _BenchAt (void) {
+  uint32_t i, j, n, v, start;
+
+  AT_Exec_SetOutput(AT_CHANNEL_BENCH, _AtOutput);
+  n = 0U;
+  for (i = 0U; i < BENCH_AT_SAMPLES; i++) {
+    (void)osThreadFlagsClear(BENCH_FLAG_REPLY);
+    start = Prof_Begin();
+    if (AT_Exec_Post(AT_CHANNEL_BENCH, "AT", 2U, 0U) != 0) {
+      continue;
+    }
+    if ((osThreadFlagsWait(BENCH_FLAG_REPLY, osFlagsWaitAny, BENCH_AT_TIMEOUT) & osFlagsError) != 0U) {
+      continue;
+    }
+    // Insertion sort [0.001 us]
+    v = (uint32_t)(((uint64_t)(bench_at_done - start) * 1000U) / (SystemCoreClock / 1000000U));
+    for (j = n; (j != 0U) && (bench_at_us[j - 1U] > v); j--) {
+      bench_at_us[j] = bench_at_us[j - 1U];
+    }
+    bench_at_us[j] = v;
+    n++;
+  }
+  AT_Exec_SetOutput(AT_CHANNEL_BENCH, NULL);
+  if (n == 0U) {
+    _Result("AT_RTT", "p50_us", 0U);
+    return;
+  }
+  _Result("AT_RTT", "p50_us", bench_at_us[(n * 50U) / 100U]);
+  _Result("AT_RTT", "p90_us", bench_at_us[(n * 90U) / 100U]);
+  _Result("AT_RTT", "p99_us", bench_at_us[(n * 99U) / 100U]);
+  _Result("AT_RTT", "max_us", bench_at_us[n - 1U]);
+}
+
+// ==== Runner ====
+
+static void _Idle (void) {
+  GUI_SetBkColor(GUI_BLACK);
+  GUI_Clear();
+  GUI_SetColor(GUI_WHITE);
+  GUI_SetFont(GUI_FONT_20_ASCII);
+  GUI_DispStringHCenterAt("Benchmark: send AT+BENCH", LCD_GetXSize() / 2, LCD_GetYSize() / 2 - 10);
+}
+
+void Bench_Start (uint32_t channel) {
+  if (bench_tid != NULL) {
+    bench_channel = channel;
+    (void)osThreadFlagsSet(bench_tid, BENCH_FLAG_START);
+  }
+}
+
+__NO_RETURN void Bench_Run (void) {
+  bench_tid = osThreadGetId();
+  _Idle();
+  for (;;) {
+    (void)osThreadFlagsWait(BENCH_FLAG_START, osFlagsWaitAny, osWaitForever);
+    bench_runs++;
+    bench_results = 0U;
+    _BenchDisplay();
+    _BenchRedraw();
+    _Idle();
+    _BenchVnc();
+    _BenchCdc();
+    _BenchAt();
+    (void)AT_Exec_Notify(1U << bench_channel, _Print);
+  }
+}
+
+#endif /* BENCH */
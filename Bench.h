@@ -0,0 +1,38 @@
+/*------------------------------------------------------------------------------
+ * Name:    Bench.h
+ * Purpose: On-target benchmark runner (Benchmark target, BENCH defined)
+ *----------------------------------------------------------------------------*/
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+
+// Benchmark Configuration -----------------------------------------------------
+
+#define BENCH_FILL_LOOPS        (100U)  // Full screen fills
+#define BENCH_COPY_LOOPS        (100U)  // Half screen rectangle copies
+#define BENCH_BLEND_LOOPS       (20U)   // Full screen fills at 50 % alpha
+#define BENCH_REDRAW_LOOPS      (50U)   // Full redraws of the dialog
+#define BENCH_VNC_MS            (5000U) // VNC loopback session duration [ms]
+#define BENCH_VNC_BUF_SIZE      (8192U) // VNC loopback transport buffer
+#define BENCH_CDC_BYTES         (1048576U) // CDC ACM bulk IN transfer [bytes]
+#define BENCH_CDC_TIMEOUT       (30000U) // CDC ACM transfer timeout [ms]
+#define BENCH_AT_SAMPLES        (256U)  // AT command round trips
+#define BENCH_AT_TIMEOUT        (100U)  // Round trip timeout [ms]
+#define BENCH_RESULTS_MAX       (24U)   // Result lines per run
+
+//------------------------------------------------------------------------------
+
+// Start a benchmark run; the results are sent as unsolicited lines to
+// channel (AT+BENCH). May be called from any thread.
+extern void Bench_Start (uint32_t channel);
+
+// Benchmark runner; the GUI thread calls it instead of creating the
+// dialog and never returns.
+extern __NO_RETURN void Bench_Run (void);
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,240 @@
+/*------------------------------------------------------------------------------
+ * Name:    ButtonDriver.c
+ * Purpose: SW1..SW4 button driver
+ *----------------------------------------------------------------------------*/
+/*
+ * The button pins are taken from the CubeMX pin names in main.h and
+ * grouped by GPIO port at initialization. BtnDrv_Read reads the IDR of
+ * every port once (all four buttons are on GPIOF, so a single read) and
+ * packs the pressed buttons into a mask, so all bits come from the same
+ * instant. The buttons are active low.
+ *
+ * Press and release events come from EXTI interrupts on both edges. The
+ * first edge is reported at once, so the event latency is the interrupt
+ * latency. The button EXTI lines are then masked and TIM14 is started in
+ * one-pulse mode for BTN_DEBOUNCE_MS; its interrupt samples the buttons
+ * again, reports a state that changed in the meantime and only re-enables
+ * the EXTI lines once the state is stable. Contact bounce therefore never
+ * causes events and nothing busy-waits.
+ */
+
+#include "RTE_Components.h"
+#include "main.h"
+#include "cmsis_os2.h"
+#include "rtx_os.h"
+#include "ButtonDriver.h"
+#include "TouchDriver.h"
+
+typedef struct {
+  GPIO_TypeDef *port;
+  uint16_t      pin;
+} BTN_Pin;
+
+// Button n+1 is reported as mask bit n
+static const BTN_Pin btn_pin[BTN_NUM] = {
+  { SW1_GPIO_Port, SW1_Pin },
+  { SW2_GPIO_Port, SW2_Pin },
+  { SW3_GPIO_Port, SW3_Pin },
+  { SW4_GPIO_Port, SW4_Pin },
+};
+
+static GPIO_TypeDef *btn_port[BTN_NUM];         // Distinct button ports
+static uint32_t      btn_port_pins[BTN_NUM];    // All button pins of a port
+static uint8_t       btn_slot[BTN_NUM];         // Port index of each button
+static uint32_t      btn_port_num;
+static uint32_t      btn_exti_lines;            // EXTI lines of all buttons
+
+static uint32_t      btn_queue_mem[osRtxMessageQueueMemSize(BTN_EVENT_QUEUE_DEPTH, sizeof(BtnDrv_Event)) / 4U];
+
+static const osMessageQueueAttr_t btn_queue_attr = {
+  .name    = "BTN_Events",
+  .mq_mem  = btn_queue_mem,
+  .mq_size = sizeof(btn_queue_mem)
+};
+
+static osMessageQueueId_t     btn_queue;
+static volatile BtnDrv_Notify btn_notify;
+static uint32_t               btn_stable;       // Last reported mask
+static volatile uint32_t      btn_dropped;
+
+// APB1 timer kernel clock
+static uint32_t _TimerClock (void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+// Group buttons by port, configure the pins as EXTI inputs with pull-up.
+void BtnDrv_Initialize (void) {
+  GPIO_InitTypeDef init;
+  uint32_t         i, s;
+
+  btn_port_num = 0U;
+  for (i = 0U; i < BTN_NUM; i++) {
+    for (s = 0U; s < btn_port_num; s++) {
+      if (btn_port[s] == btn_pin[i].port) {
+        break;
+      }
+    }
+    if (s == btn_port_num) {
+      btn_port[s]      = btn_pin[i].port;
+      btn_port_pins[s] = 0U;
+      btn_port_num++;
+    }
+    btn_port_pins[s] |= btn_pin[i].pin;
+    btn_slot[i]       = (uint8_t)s;
+  }
+
+  btn_queue = osMessageQueueNew(BTN_EVENT_QUEUE_DEPTH, sizeof(BtnDrv_Event), &btn_queue_attr);
+
+  // EXTI line n is shared by pin n of all ports, one button port per line
+  btn_exti_lines = 0U;
+  for (s = 0U; s < btn_port_num; s++) {
+    btn_exti_lines |= btn_port_pins[s];
+  }
+
+  init.Mode      = GPIO_MODE_IT_RISING_FALLING;
+  init.Pull      = GPIO_PULLUP;
+  init.Speed     = GPIO_SPEED_FREQ_LOW;
+  init.Alternate = 0U;
+  for (s = 0U; s < btn_port_num; s++) {
+    init.Pin = btn_port_pins[s];
+    HAL_GPIO_Init(btn_port[s], &init);
+  }
+  btn_stable = BtnDrv_Read();
+
+  // TIM14: 10 kHz count clock, one pulse of BTN_DEBOUNCE_MS
+  __HAL_RCC_TIM14_CLK_ENABLE();
+  TIM14->CR1  = TIM_CR1_URS | TIM_CR1_OPM;
+  TIM14->PSC  = (_TimerClock() / 10000U) - 1U;
+  TIM14->ARR  = (BTN_DEBOUNCE_MS * 10U) - 1U;
+  TIM14->EGR  = TIM_EGR_UG;
+  TIM14->SR   = 0U;
+  TIM14->DIER = TIM_DIER_UIE;
+
+  NVIC_SetPriority(TIM8_TRG_COM_TIM14_IRQn, BTN_IRQ_PRIO);
+  NVIC_EnableIRQ(TIM8_TRG_COM_TIM14_IRQn);
+  if ((btn_exti_lines & 0x03E0U) != 0U) {
+    NVIC_SetPriority(EXTI9_5_IRQn, BTN_IRQ_PRIO);
+    NVIC_EnableIRQ(EXTI9_5_IRQn);
+  }
+  if ((btn_exti_lines & 0xFC00U) != 0U) {
+    NVIC_SetPriority(EXTI15_10_IRQn, BTN_IRQ_PRIO);
+    NVIC_EnableIRQ(EXTI15_10_IRQn);
+  }
+}
+
+// Snapshot all button ports and return the pressed button mask.
+uint32_t BtnDrv_Read (void) {
+  uint32_t idr[BTN_NUM];
+  uint32_t i, s, mask;
+
+  for (s = 0U; s < btn_port_num; s++) {
+    idr[s] = btn_port[s]->IDR;
+  }
+  mask = 0U;
+  for (i = 0U; i < BTN_NUM; i++) {
+    if ((idr[btn_slot[i]] & btn_pin[i].pin) == 0U) {
+      mask |= 1U << i;
+    }
+  }
+  return mask;
+}
+
+// Queue an event for every button that changed since the last report.
+// \return      mask of changed buttons
+static uint32_t _Sample (void) {
+  BtnDrv_Event  ev;
+  BtnDrv_Notify notify;
+  uint32_t      now, changed, i;
+
+  now     = BtnDrv_Read();
+  changed = now ^ btn_stable;
+  if (changed == 0U) {
+    return 0U;
+  }
+  btn_stable  = now;
+  ev.mask     = (uint8_t)now;
+  ev.reserved = 0U;
+  ev.time     = osKernelGetTickCount();
+  for (i = 0U; i < BTN_NUM; i++) {
+    if ((changed & (1U << i)) != 0U) {
+      ev.button  = (uint8_t)i;
+      ev.pressed = ((now & (1U << i)) != 0U) ? 1U : 0U;
+      if (osMessageQueuePut(btn_queue, &ev, 0U, 0U) != osOK) {
+        btn_dropped++;
+      }
+    }
+  }
+  notify = btn_notify;
+  if (notify != NULL) {
+    notify();
+  }
+  return changed;
+}
+
+// Report the edge and hold off further edges for the debounce window.
+static void _Edge (void) {
+  EXTI->IMR &= ~btn_exti_lines;
+  (void)_Sample();
+  TIM14->CNT  = 0U;
+  TIM14->CR1 |= TIM_CR1_CEN;
+}
+
+int BtnDrv_GetEvent (BtnDrv_Event *event) {
+  if ((btn_queue == NULL) || (osMessageQueueGet(btn_queue, event, NULL, 0U) != osOK)) {
+    return -1;
+  }
+  return 0;
+}
+
+void BtnDrv_SetNotify (BtnDrv_Notify notify) {
+  btn_notify = notify;
+}
+
+uint32_t BtnDrv_GetDropped (void) {
+  return btn_dropped;
+}
+
+// EXTI lines 5..9 (SW2..SW4)
+void EXTI9_5_IRQHandler (void);
+void EXTI9_5_IRQHandler (void) {
+  uint32_t pending = EXTI->PR & btn_exti_lines & 0x03E0U;
+
+  if (pending != 0U) {
+    EXTI->PR = pending;
+    _Edge();
+  }
+}
+
+// EXTI lines 10..15 (SW1, touch controller INT on line 13)
+void EXTI15_10_IRQHandler (void);
+void EXTI15_10_IRQHandler (void) {
+  uint32_t pending = EXTI->PR & btn_exti_lines & 0xFC00U;
+
+  if (pending != 0U) {
+    EXTI->PR = pending;
+    _Edge();
+  }
+#ifdef RTE_Graphics_Touchscreen
+  TouchDrv_IRQHandler();
+#endif
+}
+
+// TIM14: debounce window elapsed
+void TIM8_TRG_COM_TIM14_IRQHandler (void);
+void TIM8_TRG_COM_TIM14_IRQHandler (void) {
+  TIM14->SR = ~TIM_SR_UIF;
+  if (_Sample() != 0U) {
+    _Edge();                            // Changed during the window: hold off again
+    return;
+  }
+  EXTI->PR   = btn_exti_lines;
+  EXTI->IMR |= btn_exti_lines;
+  if (BtnDrv_Read() != btn_stable) {
+    _Edge();                            // Edge between sample and unmask
+  }
+}
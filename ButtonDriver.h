@@ -0,0 +1,47 @@
+/*------------------------------------------------------------------------------
+ * Name:    ButtonDriver.h
+ * Purpose: SW1..SW4 button driver
+ *----------------------------------------------------------------------------*/
+
+#ifndef BUTTON_DRIVER_H_
+#define BUTTON_DRIVER_H_
+
+#include <stdint.h>
+
+// Button Event Configuration --------------------------------------------------
+
+#define BTN_DEBOUNCE_MS         (20U)   // Debounce window after an edge
+#define BTN_EVENT_QUEUE_DEPTH   (16U)   // Queued press/release events
+#define BTN_IRQ_PRIO            (5U)    // EXTI and debounce timer priority
+
+//------------------------------------------------------------------------------
+
+#define BTN_NUM                 (4U)            // SW1..SW4, bit n = SWn+1
+#define BTN_MASK_ALL            ((1U << BTN_NUM) - 1U)
+
+typedef struct {
+  uint8_t  button;              // Button index 0..BTN_NUM-1
+  uint8_t  pressed;             // 1 = press, 0 = release
+  uint8_t  mask;                // Pressed button mask after the event
+  uint8_t  reserved;
+  uint32_t time;                // Kernel tick count [ms] of the edge
+} BtnDrv_Event;
+
+// Called from interrupt context after events were queued.
+typedef void (*BtnDrv_Notify) (void);
+
+extern void     BtnDrv_Initialize (void);
+
+// Pressed buttons from one IDR snapshot per GPIO port.
+extern uint32_t BtnDrv_Read       (void);
+
+// Take the oldest queued event.
+// \return      0 on success, -1 if the queue is empty
+extern int      BtnDrv_GetEvent   (BtnDrv_Event *event);
+
+extern void     BtnDrv_SetNotify  (BtnDrv_Notify notify);
+
+// Events lost because the queue was full.
+extern uint32_t BtnDrv_GetDropped (void);
+
+#endif /* BUTTON_DRIVER_H_ */
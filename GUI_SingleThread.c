@@ -34,9 +34,15 @@
 #include "cmsis_os2.h"
 #include "GUI.h"
 #include "Dialog.h"
+#include "GUI_Thread.h"
+#include "Stats.h"
+#include "Prof.h"
+#include "AppEvr.h"
+#include "Bench.h"
+#include "TouchDriver.h"
 
 extern WM_HWIN CreateMyDialog(void);
-extern int  GUI_VNC_X_StartServer(int, int);
+extern void    MyDialog_Update(WM_HWIN hWin);
 
 #ifdef _RTE_
 #include "RTE_Components.h"             // Component selection
@@ -44,14 +50,34 @@ extern int  GUI_VNC_X_StartServer(int, int);
 
 /*----------------------------------------------------------------------------
  *      GUIThread: GUI Thread for Single-Task Execution Model
+ *
+ * The thread blocks on its thread flags instead of polling. It wakes on
+ *  - GUI_EVT_STATE from command handlers that change displayed state,
+ *  - GUI_EVT_INPUT from emWin when PID/key input is stored (VNC clients),
+ *  - GUI_EVT_FRAME from the frame timer while an animation or a WM timer
+ *    is active (GUI_SetAnimating, called by the owner of the animation or
+ *    timer), so emWin runs them in GUI_Exec without other events,
+ *  - GUI_EVT_TOUCH from the touch thread (TouchDriver.c), which is woken
+ *    by the touch controller interrupt and stores touch states,
+ * so an idle screen costs no GUI_Exec calls.
+ *
+ * At boot the thread draws a splash frame right after GUI_Init, before
+ * the network and USB are up, then creates the dialog. The VNC server is
+ * started by app_main once an interface has a link (GUI_WaitStarted).
  *---------------------------------------------------------------------------*/
 #define GUI_THREAD_STK_SZ    (4096U)
 
 static void         GUIThread (void *argument);         /* thread function */
 static osThreadId_t GUIThread_tid;                      /* thread id */
-static uint64_t     GUIThread_stk[GUI_THREAD_STK_SZ/8]; /* thread stack */
+static uint64_t     GUIThread_stk[GUI_THREAD_STK_SZ/8] __attribute__((section(".bss.dtcm"))); /* thread stack */
+static osTimerId_t  GUIFrame_tid;                       /* frame timer id */
+static uint32_t     GUIFrame_users;                     /* active GUI_SetAnimating calls */
+static osEventFlagsId_t GUIStart_evt;                   /* splash frame drawn */
+
+#define GUI_START_FLAG       (1U)
 
 static const osThreadAttr_t GUIThread_attr = {
+  .name       = "GUI",
   .stack_mem  = &GUIThread_stk[0],
   .stack_size = sizeof(GUIThread_stk),
   .priority   = osPriorityNormal 
@@ -59,6 +85,10 @@ static const osThreadAttr_t GUIThread_attr = {
 
 int Init_GUIThread (void) {
 
+  GUIStart_evt = osEventFlagsNew(NULL);
+  if (GUIStart_evt == NULL) {
+    return(-1);
+  }
   GUIThread_tid = osThreadNew(GUIThread, NULL, &GUIThread_attr);
   if (GUIThread_tid == NULL) {
     return(-1);
@@ -67,23 +97,93 @@ int Init_GUIThread (void) {
   return(0);
 }
 
+void GUI_WaitStarted (void) {
+  (void)osEventFlagsWait(GUIStart_evt, GUI_START_FLAG, osFlagsWaitAny | osFlagsNoClear, osWaitForever);
+}
+
+/* Splash frame shown while the rest of the system starts */
+static void GUI_Splash (void) {
+  GUI_MULTIBUF_Begin();
+  GUI_SetBkColor(GUI_BLACK);
+  GUI_Clear();
+  GUI_SetColor(GUI_WHITE);
+  GUI_SetFont(&GUI_Font24_ASCII);
+  GUI_DispStringHCenterAt("Starting...", LCD_GetXSize() / 2, (LCD_GetYSize() - GUI_GetFontSizeY()) / 2);
+  GUI_MULTIBUF_End();
+}
+
+void GUI_Signal (uint32_t events) {
+  if (GUIThread_tid != NULL) {
+    (void)osThreadFlagsSet(GUIThread_tid, events & GUI_EVT_ALL);
+  }
+}
+
+/* emWin signal event function: input was stored by another task */
+static void GUI_SignalInput (void) {
+  GUI_Signal(GUI_EVT_INPUT);
+}
+
+/* Frame timer callback (timer thread) */
+static void GUI_FrameTimer (void *argument) {
+  (void)argument;
+  GUI_Signal(GUI_EVT_FRAME);
+}
+
+void GUI_SetAnimating (uint32_t on) {
+  if (GUIFrame_tid == NULL) {
+    return;
+  }
+  if (on != 0U) {
+    if (GUIFrame_users++ == 0U) {
+      (void)osTimerStart(GUIFrame_tid, GUI_FRAME_MS);
+    }
+  } else if (GUIFrame_users != 0U) {
+    if (--GUIFrame_users == 0U) {
+      (void)osTimerStop(GUIFrame_tid);
+    }
+  }
+}
+
 __NO_RETURN static void GUIThread (void *argument) {
+  uint32_t start;
+  int      done;
+  WM_HWIN  hDlg;
+
   (void)argument;
 
   GUI_Init();           /* Initialize the Graphics Component */
+  WM_MULTIBUF_Enable(1); /* Draw into back buffers, flip on VSYNC */
+  GUI_SetSignalEventFunc(GUI_SignalInput);
+  GUIFrame_tid = osTimerNew(GUI_FrameTimer, osTimerPeriodic, NULL, NULL);
+#ifdef RTE_Graphics_Touchscreen   /* Graphics Input Device Touchscreen enabled */
+  TouchDrv_Initialize();        /* Touch thread stores touch states */
+#endif
 
-  GUI_VNC_X_StartServer(0,0);
-  CreateMyDialog();
+  GUI_Splash();
+  Stats_BootMark(STATS_BOOT_FRAME);
+  (void)osEventFlagsSet(GUIStart_evt, GUI_START_FLAG);
+#ifdef BENCH
+  Bench_Run();          /* Benchmark target: runner instead of the dialog */
+#endif
+  hDlg = CreateMyDialog();
+#if (PROF_OVERLAY != 0)
+  ProfOverlay_Create();
+#endif
+  (void)GUI_Exec();     /* Draw the dialog */
+  Stats_BootMark(STATS_BOOT_DIALOG);
 
   while (1) {
     
     /* All GUI related activities might only be called from here */
 
-#ifdef RTE_Graphics_Touchscreen   /* Graphics Input Device Touchscreen enabled */
-    GUI_TOUCH_Exec();             /* Execute Touchscreen support */
-#endif
-    GUI_Exec();                   /* Execute all GUI jobs ... Return 0 if nothing was done. */
-    GUI_X_ExecIdle();             /* Nothing left to do for the moment ... Idle processing */
-    osDelay(100);
+    MyDialog_Update(hDlg);        /* Pick up host text (AT+LCD) */
+    AppEvr_Record(EVR_GUI_FRAME_BEGIN, 0U, 0U);
+    start = Prof_Begin();
+    done  = GUI_Exec();           /* Execute all GUI jobs ... Return 0 if nothing was done. */
+    Prof_End(PROF_GUI_EXEC, start);
+    AppEvr_Record(EVR_GUI_FRAME_END, (uint32_t)done, 0U);
+    Stats_SetGuiHeap((uint32_t)GUI_ALLOC_GetNumUsedBytes(), (uint32_t)GUI_ALLOC_GetNumFreeBytes());
+
+    (void)osThreadFlagsWait(GUI_EVT_ALL, osFlagsWaitAny, osWaitForever);
   }
 }
@@ -0,0 +1,39 @@
+/*------------------------------------------------------------------------------
+ * Name:    GUI_Thread.h
+ * Purpose: Event driven GUI thread (GUI_SingleThread.c)
+ *----------------------------------------------------------------------------*/
+
+#ifndef GUI_THREAD_H_
+#define GUI_THREAD_H_
+
+#include <stdint.h>
+
+// GUI Thread Configuration ----------------------------------------------------
+
+#define GUI_FRAME_MS            (20U)   // Frame period while animating [ms]
+
+//------------------------------------------------------------------------------
+
+// Wake-up events (thread flags of the GUI thread)
+#define GUI_EVT_TOUCH           (1U << 0)       // Touch state stored (TouchDriver.c)
+#define GUI_EVT_STATE           (1U << 1)       // Displayed state changed (AT+LCD, AT+LED)
+#define GUI_EVT_INPUT           (1U << 2)       // PID/key input stored (VNC)
+#define GUI_EVT_FRAME           (1U << 3)       // Frame timer (GUI_SetAnimating)
+#define GUI_EVT_ALL             (0x0FU)
+
+extern int  Init_GUIThread   (void);
+
+// Block until the GUI thread has initialized emWin and drawn the splash
+// frame. Call from any thread after Init_GUIThread.
+extern void GUI_WaitStarted  (void);
+
+// Wake the GUI thread; may be called from any thread or ISR.
+extern void GUI_Signal       (uint32_t events);
+
+// Run the frame timer (GUI_FRAME_MS) while an animation or a WM timer is
+// active; without it the GUI thread only wakes on the other events. Calls
+// nest: the timer stops when every on has been matched by an off.
+// Call from the GUI thread.
+extern void GUI_SetAnimating (uint32_t on);
+
+#endif /* GUI_THREAD_H_ */
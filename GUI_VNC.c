@@ -37,17 +37,97 @@
 #include "Board_LED.h"                  // ::Board Support:LED
 #include "rl_net.h"                     // Keil.MDK-Pro::Network:CORE
 #include "rl_usb.h"                     // Keil.MDK-Pro::USB:CORE
-
-extern void Init_GUIThread(void);
+#include "LedDriver.h"
+#include "LedSeq.h"
+#include "ButtonDriver.h"
+#include "AdcAcq.h"
+#include "Telem.h"
+#include "AT_Executor.h"
+#include "AT_TcpServer.h"
+#include "GUI_Thread.h"
+#include "Stats.h"
+#include "AppEvr.h"
 
 // Main stack size must be multiple of 8 Bytes
 #define APP_MAIN_STK_SZ (4096)
 uint64_t app_main_stk[APP_MAIN_STK_SZ / 8];
 const osThreadAttr_t app_main_attr = {
+  .name       = "app_main",
   .stack_mem  = &app_main_stk[0],
   .stack_size = sizeof(app_main_stk)
 };
 
+/*----------------------------------------------------------------------------
+ * Staged boot
+ *
+ * 1. Board drivers and the AT executor, which the dialog and the command
+ *    channels use; none of them waits for hardware.
+ * 2. Display: the GUI thread draws a splash frame, then the dialog.
+ * 3. USB (usb_boot thread) and network (app_main) start in parallel; the
+ *    USB OTG HS core is initialized there instead of in main().
+ * 4. The VNC server starts once an interface reports link up
+ *    (netETH_Notify), at the latest after BOOT_LINK_TIMEOUT.
+ * The milestones are recorded in the statistics (AT+STATS=BOOT).
+ *---------------------------------------------------------------------------*/
+#define BOOT_LINK_TIMEOUT (10000U)      /* VNC start without link [ms]       */
+#define BOOT_USB_TIMEOUT  (10000U)      /* Wait for USB configuration [ms]   */
+#define BOOT_USB_POLL_MS  (10U)         /* USB configuration poll period [ms] */
+#define BOOT_FLAG_LINK    (1U)          /* app_main thread flag: link up     */
+
+#define USB_BOOT_STK_SZ   (2048)
+static uint64_t usb_boot_stk[USB_BOOT_STK_SZ / 8];
+static const osThreadAttr_t usb_boot_attr = {
+  .name       = "usb_boot",
+  .stack_mem  = &usb_boot_stk[0],
+  .stack_size = sizeof(usb_boot_stk)
+};
+
+static osThreadId_t app_main_tid;
+
+extern int GUI_VNC_X_StartServer (int LayerIndex, int ServerIndex);
+
+/* Network interface link state (Network core thread) */
+void netETH_Notify (uint32_t if_num, netETH_Event event, uint32_t val) {
+  (void)if_num;
+  (void)val;
+  if (event == netETH_LinkUp) {
+    Stats_BootMark(STATS_BOOT_LINK);
+    (void)osThreadFlagsSet(app_main_tid, BOOT_FLAG_LINK);
+  }
+}
+
+/* DHCP client options (Network core thread) */
+void netDHCP_Notify (uint32_t if_id, uint8_t option, const uint8_t *val, uint32_t len) {
+  (void)if_id;
+  (void)val;
+  (void)len;
+  if (option == NET_DHCP_OPTION_IP_ADDRESS) {
+    Stats_BootMark(STATS_BOOT_DHCP);
+  }
+}
+
+/* USB device boot stage */
+__NO_RETURN static void usb_boot (void *argument) {
+  uint32_t start;
+
+  (void)argument;
+
+  MX_USB_OTG_HS_PCD_Init();              /* USB OTG HS core                    */
+  USBD_Initialize         (0U);          /* USB Device 0 Initialization        */
+  USBD_Connect            (0U);          /* USB Device 0 Connect               */
+  Stats_BootMark(STATS_BOOT_USB);
+
+  start = osKernelGetTickCount();
+  while ((osKernelGetTickCount() - start) < BOOT_USB_TIMEOUT) {
+    if (USBD_Configured(0U)) {
+      Stats_BootMark(STATS_BOOT_USB_CONFIG);
+      break;
+    }
+    (void)osDelay(BOOT_USB_POLL_MS);
+  }
+  osThreadExit();
+}
+
 /*----------------------------------------------------------------------------
  * Application main thread
  *---------------------------------------------------------------------------*/
@@ -55,13 +135,32 @@ __NO_RETURN void app_main (void *argument) {
 
   (void)argument;
 
+  app_main_tid = osThreadGetId();
+  Stats_Initialize();                    /* Cycle counter for the CPU load     */
+  AppEvr_Initialize();                   /* Record the application events      */
+  Stats_BootMark(STATS_BOOT_MAIN);
+
   LED_Initialize();
+  LedDrv_Initialize();                   /* LED1..LED8 outputs                 */
+  LedSeq_Initialize();                   /* LED pattern sequencer timer        */
+  BtnDrv_Initialize();                   /* SW1..SW4 inputs                    */
+  AdcAcq_Initialize();                   /* Potentiometer sampling (TIM2/DMA)  */
+  AT_Exec_Initialize();                  /* AT command executor thread         */
+
+  Init_GUIThread();                      /* Display and splash frame           */
+
+  osThreadNew(usb_boot, NULL, &usb_boot_attr); /* USB in parallel             */
+
   netInitialize();
-	
-	USBD_Initialize         (0U);          /* USB Device 0 Initialization        */
-  USBD_Connect            (0U);          /* USB Device 0 Connect               */
+  Stats_BootMark(STATS_BOOT_NET);
+  Telem_Initialize();                    /* UDP telemetry publisher thread     */
+  AT_Tcp_Initialize();                   /* AT commands on TCP port 2323       */
 
-  Init_GUIThread();
+  (void)osThreadFlagsWait(BOOT_FLAG_LINK, osFlagsWaitAny, BOOT_LINK_TIMEOUT);
+  GUI_WaitStarted();
+  if (GUI_VNC_X_StartServer(0, 0) == 0) {
+    Stats_BootMark(STATS_BOOT_VNC);
+  }
 
   osThreadExit();
 }
@@ -0,0 +1,308 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_HostStubs.c
+ * Purpose: Host stubs of the modules used by the AT command layer
+ *----------------------------------------------------------------------------*/
+/*
+ * Stand-ins for the target modules that AT_Commands.c calls, for the
+ * AT_PORT_HOST build. They keep just enough state for the replies to be
+ * deterministic: LED mask, levels, LED sequence, telemetry target and the
+ * channel modes are stored, the potentiometer and sensors return fixed
+ * values. Statistics are 0, except for one thread, one boot milestone and
+ * one profiler sample, as a running target always has them, so that the
+ * listing commands reply. None of them allocates memory.
+ */
+
+#include <string.h>
+
+#include "AT_Port.h"
+#include "Temp.h"
+#include "LedDriver.h"
+#include "ButtonDriver.h"
+#include "AdcAcq.h"
+#include "AdcStream.h"
+#include "Telem.h"
+#include "LedSeq.h"
+#include "Stats.h"
+#include "Prof.h"
+#include "AT_Executor.h"
+#include "GUI_Thread.h"
+#include "AT_HostStubs.h"
+
+#define HOST_POT                (2048U) // Potentiometer value (12 bit)
+#define HOST_TEMP               (250)   // Die temperature [0.1 degC]
+#define HOST_VDDA               (3300U) // Analog supply [mV]
+
+Host_DWT_Type            Host_DWT;
+
+static uint32_t          host_leds;
+static uint32_t          host_level[LED_NUM];
+static uint32_t          host_rate;
+static uint32_t          host_rate_prev;
+static uint32_t          host_mode[AT_CHANNEL_NUM];
+static uint32_t          host_signals;
+static LedSeq_Status     host_seq;
+static Telem_Status      host_telem;
+static AdcStream_Stats   host_stream;
+
+static const char * const prof_name[PROF_SITES] = {
+  "AT_COMMAND",
+  "READ_POT",
+  "CDC_LOOP",
+  "GUI_EXEC",
+  "VNC_UPDATE",
+  "DMA2D_FILL",
+  "DMA2D_COPY",
+  "DMA2D_CONVERT",
+  "DMA2D_BLEND",
+  "DMA2D_WAIT",
+  "FRAME"
+};
+
+void Host_Reset (void) {
+  uint32_t i;
+
+  host_leds = 0U;
+  for (i = 0U; i < LED_NUM; i++) {
+    host_level[i] = LED_LEVEL_MAX;
+  }
+  host_rate = ACQ_RATE_DEFAULT;
+  memset(host_mode, 0, sizeof(host_mode));
+  host_signals = 0U;
+  memset(&host_seq,    0, sizeof(host_seq));
+  memset(&host_telem,  0, sizeof(host_telem));
+  memset(&host_stream, 0, sizeof(host_stream));
+}
+
+uint32_t Host_GetSignals (void) {
+  return host_signals;
+}
+
+// ==== Temp.h ====
+
+uint16_t ReadPot (int32_t *potValue) {
+  *potValue = (int32_t)HOST_POT;
+  return (uint16_t)HOST_POT;
+}
+
+// ==== LedDriver.h ====
+
+void LedDrv_Write (uint32_t mask) {
+  host_leds = mask & LED_MASK_ALL;
+}
+
+uint32_t LedDrv_Read (void) {
+  return host_leds;
+}
+
+int LedDrv_SetLevel (uint32_t led, uint32_t level) {
+  if ((led >= LED_NUM) || (level > LED_LEVEL_MAX)) {
+    return -1;
+  }
+  host_level[led] = level;
+  return 0;
+}
+
+uint32_t LedDrv_GetLevel (uint32_t led) {
+  return (led < LED_NUM) ? host_level[led] : 0U;
+}
+
+// ==== ButtonDriver.h ====
+
+uint32_t BtnDrv_Read (void) {
+  return 0U;
+}
+
+int BtnDrv_GetEvent (BtnDrv_Event *event) {
+  (void)event;
+  return -1;
+}
+
+void BtnDrv_SetNotify (BtnDrv_Notify notify) {
+  (void)notify;
+}
+
+// ==== AdcAcq.h, AdcStream.h ====
+
+int AdcAcq_SetRate (uint32_t rate) {
+  if ((rate == 0U) || (rate > ACQ_RATE_MAX)) {
+    return -1;
+  }
+  host_rate = rate;
+  return 0;
+}
+
+void AdcAcq_GetStats (AdcAcq_Stats *stats) {
+  memset(stats, 0, sizeof(AdcAcq_Stats));
+  stats->rate     = host_rate;
+  stats->last     = HOST_POT;
+  stats->filtered = HOST_POT;
+}
+
+void AdcAcq_GetSensors (AdcAcq_Sensors *sensors) {
+  sensors->pot   = HOST_POT;
+  sensors->temp  = HOST_TEMP;
+  sensors->vdda  = HOST_VDDA;
+  sensors->scans = 0U;
+}
+
+int AdcStream_Start (uint32_t rate, uint32_t dec) {
+  uint32_t prev;
+
+  if ((dec == 0U) || (dec > STREAM_DEC_MAX)) {
+    return -1;
+  }
+  AdcStream_Stop();
+  prev = host_rate;
+  if (AdcAcq_SetRate(rate) != 0) {
+    return -1;
+  }
+  host_rate_prev      = prev;
+  host_stream.running = 1U;
+  host_stream.rate    = rate;
+  host_stream.dec     = dec;
+  return 0;
+}
+
+void AdcStream_Stop (void) {
+  if (host_stream.running != 0U) {
+    host_rate = host_rate_prev;
+  }
+  host_stream.running = 0U;
+}
+
+void AdcStream_GetStats (AdcStream_Stats *stats) {
+  *stats = host_stream;
+}
+
+// ==== Telem.h ====
+
+int Telem_Configure (uint32_t addr, uint16_t port, uint32_t interval) {
+  if ((interval < TELEM_SAMPLE_MS) || (interval > TELEM_INTERVAL_MAX) ||
+      ((addr != 0U) && (port == 0U))) {
+    return -1;
+  }
+  host_telem.addr     = addr;
+  host_telem.port     = port;
+  host_telem.interval = (uint16_t)interval;
+  return 0;
+}
+
+void Telem_GetStatus (Telem_Status *status) {
+  *status = host_telem;
+}
+
+// ==== LedSeq.h ====
+
+void LedSeq_Clear (void) {
+  memset(&host_seq, 0, sizeof(host_seq));
+}
+
+int LedSeq_Add (uint32_t mask, uint32_t ms) {
+  (void)mask;
+  if ((host_seq.running != 0U) || (host_seq.steps >= LEDSEQ_MAX_STEPS) ||
+      (ms == 0U) || (ms > LEDSEQ_MAX_MS)) {
+    return -1;
+  }
+  host_seq.steps++;
+  return 0;
+}
+
+int LedSeq_Start (uint32_t repeat) {
+  (void)repeat;
+  if (host_seq.steps == 0U) {
+    return -1;
+  }
+  host_seq.running = 1U;
+  host_seq.step    = 0U;
+  return 0;
+}
+
+void LedSeq_Stop (void) {
+  host_seq.running = 0U;
+}
+
+void LedSeq_GetStatus (LedSeq_Status *status) {
+  *status = host_seq;
+}
+
+// ==== Stats.h ====
+
+void Stats_GetCounters (Stats_Counters *counters) {
+  memset(counters, 0, sizeof(Stats_Counters));
+}
+
+uint32_t Stats_GetThreads (Stats_Thread *threads, uint32_t max) {
+  if (max == 0U) {
+    return 0U;
+  }
+  threads[0].name       = "AT_Executor";
+  threads[0].stack_size = AT_EXEC_STACK_SIZE;
+  threads[0].stack_used = 0U;
+  threads[0].priority   = 24U;          // osPriorityNormal
+  return 1U;
+}
+
+uint32_t Stats_GetBoot (uint32_t *ms) {
+  memset(ms, 0, STATS_BOOT_NUM * sizeof(uint32_t));
+  return 1U << STATS_BOOT_MAIN;
+}
+
+const char *Stats_BootName (Stats_Boot milestone) {
+  return (milestone == STATS_BOOT_MAIN) ? "MAIN" : "?";
+}
+
+// ==== Prof.h ====
+
+void Prof_Record (Prof_Site site, uint32_t cycles) {
+  (void)site;
+  (void)cycles;
+}
+
+void Prof_Get (Prof_Site site, Prof_Entry *entry) {
+  memset(entry, 0, sizeof(Prof_Entry));
+  if (site == PROF_AT_COMMAND) {
+    entry->count   = 1U;
+    entry->hist[0] = 1U;
+  }
+}
+
+void Prof_Reset (void) {
+}
+
+const char *Prof_SiteName (Prof_Site site) {
+  return ((uint32_t)site < PROF_SITES) ? prof_name[site] : "?";
+}
+
+uint32_t Prof_CyclesToUs (uint64_t cycles) {
+  return (uint32_t)cycles;
+}
+
+// ==== AT_Executor.h ====
+
+void AT_Exec_SetMode (uint32_t channel, uint32_t mode) {
+  if (channel < AT_CHANNEL_NUM) {
+    host_mode[channel] = mode;
+  }
+}
+
+uint32_t AT_Exec_GetMode (uint32_t channel) {
+  return (channel < AT_CHANNEL_NUM) ? host_mode[channel] : AT_MODE_TEXT;
+}
+
+void AT_Exec_GetStats (AT_Exec_Stats *stats) {
+  memset(stats, 0, sizeof(AT_Exec_Stats));
+}
+
+// Button events are not generated on the host, so no notifier runs.
+int AT_Exec_Notify (uint32_t channel_mask, AT_Notifier notify) {
+  (void)channel_mask;
+  (void)notify;
+  return 0;
+}
+
+// ==== GUI_Thread.h ====
+
+void GUI_Signal (uint32_t events) {
+  (void)events;
+  host_signals++;
+}
@@ -0,0 +1,17 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_HostStubs.h
+ * Purpose: Host stubs of the modules used by the AT command layer
+ *----------------------------------------------------------------------------*/
+
+#ifndef AT_HOST_STUBS_H_
+#define AT_HOST_STUBS_H_
+
+#include <stdint.h>
+
+// Return the stubs to their power-on state (LEDs off, text mode, ...).
+extern void     Host_Reset (void);
+
+// GUI_Signal calls since Host_Reset.
+extern uint32_t Host_GetSignals (void);
+
+#endif /* AT_HOST_STUBS_H_ */
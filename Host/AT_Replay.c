@@ -0,0 +1,418 @@
+/*------------------------------------------------------------------------------
+ * Name:    AT_Replay.c
+ * Purpose: Host replay harness of the AT command layer
+ *----------------------------------------------------------------------------*/
+/*
+ * Replays command streams through the receive path of the transports:
+ * the stream is cut into packets of at most REPLAY_PACKET_SIZE bytes and
+ * each packet is passed to AT_PortReceive (AT_Port.c), as
+ * USBD_CDC0_ACM_DataReceived does. Every line or frame is executed at
+ * once the way the executor thread does it, so the overflow and frame
+ * error replies are the same as on the target.
+ *
+ * AT_PortReceive reads the channel mode once per packet, so a stream
+ * that switches modes pads REPLAY_PACKET_SIZE - 1 bytes the new mode
+ * ignores after the switch (Streams/binary.bin). A host tool waits for
+ * the "OK" of AT+MODE instead.
+ *
+ * A run fails (exit code 1) unless
+ *  - every text line gets a reply of whole CRLF terminated lines (ERROR
+ *    counted as an error), and every binary frame one reply frame with a
+ *    valid CRC,
+ *  - each stream file gives the same replies for every packet size from
+ *    1 to REPLAY_PACKET_SIZE bytes,
+ *  - an overlong line or frame gets one error reply and the command after
+ *    it executes normally,
+ *  - the command layer calls no allocator while a stream is replayed
+ *    (the linker wraps malloc, calloc, realloc and free for the objects
+ *    of this build, see Makefile; main checks that the wrap is active).
+ *
+ * Usage: AT_Replay [-n <commands>] [<stream file>...]
+ *   Stream files hold bytes captured from a host tool (Streams/), replayed
+ *   as they are. The text and binary floods replay <commands> commands
+ *   (default REPLAY_FLOOD) and report commands/s.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "AT_Commands.h"
+#include "AT_Executor.h"
+#include "AT_Port.h"
+#include "AT_HostStubs.h"
+
+// Replay Configuration --------------------------------------------------------
+
+#define REPLAY_PACKET_SIZE      (512U)          // USB high speed bulk packet
+#define REPLAY_STREAM_MAX       (256U * 1024U)  // Largest stream file
+#define REPLAY_FLOOD_SIZE       (64U * 1024U)   // Flood buffer, replayed repeatedly
+#define REPLAY_OUT_MAX          (1024U * 1024U) // Reply capture per pass
+#define REPLAY_FLOOD            (1000000U)      // Default flood commands
+
+//------------------------------------------------------------------------------
+
+#define REPLAY_CHANNEL          AT_CHANNEL_USB
+
+typedef struct {
+  AT_PortDecoder decoder;       // Receive path of the transports
+  uint32_t       lines;         // Text lines executed
+  uint32_t       frames;        // Binary frames executed
+  uint32_t       errors;        // ERROR replies and failed records
+  uint32_t       bad;           // Replies violating the checks
+  uint8_t       *out;           // Reply capture (NULL: none)
+  uint32_t       out_len;
+} Replay;
+
+static char          replay_resp[AT_EXEC_RESP_SIZE];
+static uint8_t       replay_stream[REPLAY_STREAM_MAX];
+static uint8_t       replay_out[2][REPLAY_OUT_MAX];
+static uint8_t       replay_frame[AT_BIN_FRAME_MAX];
+
+static unsigned long replay_allocs;     // Allocator calls (linker wrapped)
+
+// ==== Allocation counter ====
+
+extern void *__real_malloc  (size_t size);
+extern void *__real_calloc  (size_t num, size_t size);
+extern void *__real_realloc (void *ptr, size_t size);
+extern void  __real_free    (void *ptr);
+
+void *__wrap_malloc (size_t size) {
+  replay_allocs++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc (size_t num, size_t size) {
+  replay_allocs++;
+  return __real_calloc(num, size);
+}
+
+void *__wrap_realloc (void *ptr, size_t size) {
+  replay_allocs++;
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free (void *ptr) {
+  if (ptr != NULL) {
+    replay_allocs++;
+  }
+  __real_free(ptr);
+}
+
+// ==== Replay ====
+
+static void _Capture (Replay *r, const void *data, uint32_t len) {
+  if ((r->out != NULL) && (len <= (REPLAY_OUT_MAX - r->out_len))) {
+    memcpy(&r->out[r->out_len], data, len);
+    r->out_len += len;
+  }
+}
+
+// Reply ends with code.
+static uint32_t _EndsWith (const AT_Resp *resp, const char *code) {
+  uint32_t n = (uint32_t)strlen(code);
+
+  return ((resp->len >= n) && (memcmp(&resp->buf[resp->len - n], code, n) == 0)) ? 1U : 0U;
+}
+
+static void _Line (const char *line, uint32_t len, uint32_t overflow, void *ctx) {
+  Replay  *r = ctx;
+  AT_Resp  resp;
+
+  resp.buf     = replay_resp;
+  resp.size    = sizeof(replay_resp);
+  resp.len     = 0U;
+  resp.channel = REPLAY_CHANNEL;
+  if (overflow != 0U) {
+    AT_Puts(&resp, "ERROR\r\n");        // As the executor
+  } else {
+    (void)process_AT_command(line, len, &resp);
+  }
+  r->lines++;
+  if (_EndsWith(&resp, "ERROR\r\n") != 0U) {
+    r->errors++;
+  } else if (_EndsWith(&resp, "\r\n") == 0U) {
+    r->bad++;                           // No reply or a truncated one
+  }
+  _Capture(r, resp.buf, resp.len);
+}
+
+static void _Frame (const uint8_t *frame, uint32_t len, uint32_t error, void *ctx) {
+  Replay  *r = ctx;
+  AT_Resp  resp;
+  int32_t  n;
+
+  resp.buf     = replay_resp;
+  resp.size    = sizeof(replay_resp);
+  resp.len     = 0U;
+  resp.channel = REPLAY_CHANNEL;
+  if ((error != 0U) || (len > AT_BIN_FRAME_MAX)) {
+    len = 0U;                           // Frame error reply, as AT_Exec_PostFrame
+  }
+  if (process_BIN_frame(frame, len, &resp) != 0) {
+    r->errors++;
+  }
+  r->frames++;
+  _Capture(r, resp.buf, resp.len);
+
+  // One delimited reply frame with a valid CRC
+  if ((resp.len < 2U) || (resp.len > (AT_BIN_ENCODED_MAX + 1U)) ||
+      (memchr(resp.buf, 0, resp.len) != &resp.buf[resp.len - 1U])) {
+    r->bad++;
+    return;
+  }
+  memcpy(replay_frame, resp.buf, resp.len - 1U);
+  n = AT_CobsDecode(replay_frame, resp.len - 1U);
+  if ((n < 3) || (AT_Crc16(replay_frame, (uint32_t)n - 2U) !=
+                  (uint16_t)(replay_frame[n - 2] | ((uint32_t)replay_frame[n - 1] << 8)))) {
+    r->bad++;
+  }
+}
+
+// Start a replay from the power-on state of the board and the channel.
+static void _Begin (Replay *r, uint8_t *out) {
+  Host_Reset();
+  memset(r, 0, sizeof(Replay));
+  AT_PortDecoderReset(&r->decoder, REPLAY_CHANNEL);
+  r->out = out;
+}
+
+// Feed len bytes of data in packets of packet bytes.
+static void _Feed (Replay *r, const uint8_t *data, uint32_t len, uint32_t packet) {
+  uint32_t pos, n;
+
+  for (pos = 0U; pos < len; pos += n) {
+    n = ((len - pos) < packet) ? (len - pos) : packet;
+    AT_PortReceive(&r->decoder, &data[pos], n, _Line, _Frame, r);
+  }
+}
+
+static double _Seconds (void) {
+  struct timespec ts;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static int _Fail (const char *name, const char *what) {
+  printf("%s: FAIL, %s\n", name, what);
+  return -1;
+}
+
+// Check the allocator was not called since count was taken.
+static int _NoAlloc (const char *name, unsigned long count) {
+  if (replay_allocs != count) {
+    printf("%s: FAIL, %lu allocator calls\n", name, replay_allocs - count);
+    return -1;
+  }
+  return 0;
+}
+
+// ==== Scenarios ====
+
+// Replay a stream file with every packet size; the replies must not
+// depend on where the packets split the stream.
+static int _ReplayFile (const char *path) {
+  Replay        r, ref;
+  FILE         *f;
+  uint32_t      len, packet;
+  unsigned long allocs;
+  double        t;
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    return _Fail(path, "cannot open");
+  }
+  len = (uint32_t)fread(replay_stream, 1U, sizeof(replay_stream), f);
+  if (fgetc(f) != EOF) {
+    (void)fclose(f);
+    return _Fail(path, "larger than REPLAY_STREAM_MAX");
+  }
+  (void)fclose(f);
+
+  allocs = replay_allocs;
+  _Begin(&ref, replay_out[0]);
+  t = _Seconds();
+  _Feed(&ref, replay_stream, len, REPLAY_PACKET_SIZE);
+  t = _Seconds() - t;
+  if (ref.bad != 0U) {
+    return _Fail(path, "missing or truncated reply, or bad reply frame");
+  }
+  for (packet = 1U; packet < REPLAY_PACKET_SIZE; packet++) {
+    _Begin(&r, replay_out[1]);
+    _Feed(&r, replay_stream, len, packet);
+    if ((r.out_len != ref.out_len) || (memcmp(replay_out[0], replay_out[1], ref.out_len) != 0)) {
+      printf("%s: FAIL, replies differ with %u byte packets\n", path, packet);
+      return -1;
+    }
+  }
+  if (_NoAlloc(path, allocs) != 0) {
+    return -1;
+  }
+  printf("%s: %u lines, %u frames, %u errors, same replies for 1..%u byte packets, %.0f commands/s\n",
+         path, ref.lines, ref.frames, ref.errors, REPLAY_PACKET_SIZE,
+         ((t > 0.0) ? ((double)(ref.lines + ref.frames) / t) : 0.0));
+  return 0;
+}
+
+// Overlong text lines and binary frames: one error each, the next
+// command is not affected.
+static int _ReplayOverlong (void) {
+  static const uint8_t next[] = "AT+LED?\r";
+  Replay        r;
+  uint32_t      len, start;
+  unsigned long allocs;
+
+  allocs = replay_allocs;
+
+  // Text: 4 * AT_LINE_MAX bytes without terminator, then a command
+  _Begin(&r, replay_out[0]);
+  memset(replay_stream, 'A', 4U * AT_LINE_MAX);
+  replay_stream[4U * AT_LINE_MAX] = '\r';
+  len = (4U * AT_LINE_MAX) + 1U;
+  memcpy(&replay_stream[len], next, sizeof(next) - 1U);
+  len += sizeof(next) - 1U;
+  _Feed(&r, replay_stream, len, REPLAY_PACKET_SIZE);
+  if ((r.lines != 2U) || (r.errors != 1U) || (r.bad != 0U) || (r.out_len != 16U) ||
+      (memcmp(replay_out[0], "ERROR\r\n+LED: 0\r\n", 16U) != 0)) {
+    return _Fail("overlong", "line not rejected once");
+  }
+
+  // Binary: twice AT_BIN_ENCODED_MAX bytes without delimiter, then MODE=AT
+  _Begin(&r, replay_out[0]);
+  _Feed(&r, (const uint8_t *)"AT+MODE=BIN\r", 12U, REPLAY_PACKET_SIZE);
+  start = r.lines;
+  memset(replay_stream, 0x55, 2U * AT_BIN_ENCODED_MAX);
+  len = 2U * AT_BIN_ENCODED_MAX;
+  replay_stream[len++] = 0x00U;
+  replay_frame[0] = 1U;                 // seq 1, MODE set 0
+  replay_frame[1] = 0x22U;
+  replay_frame[2] = 1U;
+  replay_frame[3] = AT_MODE_TEXT;
+  replay_frame[4] = (uint8_t)AT_Crc16(replay_frame, 4U);
+  replay_frame[5] = (uint8_t)(AT_Crc16(replay_frame, 4U) >> 8);
+  len += AT_CobsEncode(replay_frame, 6U, &replay_stream[len]);
+  replay_stream[len++] = 0x00U;
+  _Feed(&r, replay_stream, len, REPLAY_PACKET_SIZE);
+  _Feed(&r, next, sizeof(next) - 1U, REPLAY_PACKET_SIZE);
+  if ((r.frames != 2U) || (r.errors != 1U) || (r.bad != 0U) || ((r.lines - start) != 1U)) {
+    return _Fail("overlong", "frame not rejected once");
+  }
+  if (_NoAlloc("overlong", allocs) != 0) {
+    return -1;
+  }
+  printf("overlong: %u byte line and %u byte frame rejected once, next command executed\n",
+         4U * AT_LINE_MAX, 2U * AT_BIN_ENCODED_MAX);
+  return 0;
+}
+
+// Text flood: a command mix back to back, split into full packets.
+static int _FloodText (uint32_t num) {
+  static const char * const mix[] = {
+    "AT+LED=0x5A\r\n", "AT+LED?\r\n", "AT+POT?\r\n", "AT+LEDPWM=3,7\r\n",
+    "AT+SENSORS\r\n", "AT+LCD=Flood\r\n", "AT+BUTTON?\r\n", "AT\r\n",
+    "AT+NOPE\r\n"
+  };
+  Replay        r;
+  uint32_t      len, pass, i, n;
+  unsigned long allocs;
+  double        t;
+
+  // Whole passes of the mix; lines straddle the packet boundaries
+  len = 0U;
+  do {
+    pass = len;
+    for (i = 0U; i < (sizeof(mix) / sizeof(mix[0])); i++) {
+      n = (uint32_t)strlen(mix[i]);
+      memcpy(&replay_stream[len], mix[i], n);
+      len += n;
+    }
+  } while ((len + (len - pass)) <= REPLAY_FLOOD_SIZE);
+  allocs = replay_allocs;
+  _Begin(&r, NULL);
+  t = _Seconds();
+  while (r.lines < num) {
+    _Feed(&r, replay_stream, len, REPLAY_PACKET_SIZE);
+  }
+  t = _Seconds() - t;
+  if ((r.bad != 0U) || (r.errors != (r.lines / (sizeof(mix) / sizeof(mix[0]))))) {
+    return _Fail("flood text", "unexpected replies");
+  }
+  if (_NoAlloc("flood text", allocs) != 0) {
+    return -1;
+  }
+  printf("flood text: %u commands, %.0f commands/s\n", r.lines, (t > 0.0) ? ((double)r.lines / t) : 0.0);
+  return 0;
+}
+
+// Binary flood: frames with LED set, LED query and POT query records.
+static int _FloodBinary (uint32_t num) {
+  static const uint8_t rec[] = { 0x1EU, 1U, 0xA5U, 0x1DU, 0U, 0x25U, 0U };
+  Replay        r;
+  uint32_t      len, i, n;
+  uint16_t      crc;
+  unsigned long allocs;
+  double        t;
+
+  // Frames straddle the packet boundaries
+  len = 0U;
+  for (i = 0U; (len + AT_BIN_ENCODED_MAX) <= REPLAY_FLOOD_SIZE; i++) {
+    replay_frame[0] = (uint8_t)i;
+    memcpy(&replay_frame[1], rec, sizeof(rec));
+    n   = 1U + sizeof(rec);
+    crc = AT_Crc16(replay_frame, n);
+    replay_frame[n++] = (uint8_t)crc;
+    replay_frame[n++] = (uint8_t)(crc >> 8);
+    len += AT_CobsEncode(replay_frame, n, &replay_stream[len]);
+    replay_stream[len++] = 0x00U;
+  }
+  allocs = replay_allocs;
+  _Begin(&r, NULL);
+  AT_Exec_SetMode(REPLAY_CHANNEL, AT_MODE_BIN);
+  t = _Seconds();
+  while ((r.frames * 3U) < num) {
+    _Feed(&r, replay_stream, len, REPLAY_PACKET_SIZE);
+  }
+  t = _Seconds() - t;
+  if ((r.bad != 0U) || (r.errors != 0U)) {
+    return _Fail("flood binary", "unexpected replies");
+  }
+  if (_NoAlloc("flood binary", allocs) != 0) {
+    return -1;
+  }
+  printf("flood binary: %u frames, %u commands, %.0f commands/s\n", r.frames, r.frames * 3U,
+         (t > 0.0) ? ((double)r.frames * 3.0 / t) : 0.0);
+  return 0;
+}
+
+int main (int argc, char *argv[]) {
+  void * volatile probe;
+  uint32_t        num;
+  int             i, rc;
+
+  // The allocation checks are void unless the allocator is wrapped
+  probe = malloc(1U);
+  free(probe);
+  if (replay_allocs != 2UL) {
+    printf("FAIL, allocator not wrapped (link with --wrap)\n");
+    return 1;
+  }
+
+  num = REPLAY_FLOOD;
+  i   = 1;
+  if ((argc > 2) && (strcmp(argv[1], "-n") == 0)) {
+    num = (uint32_t)strtoul(argv[2], NULL, 0);
+    i   = 3;
+  }
+  rc = 0;
+  for (; i < argc; i++) {
+    rc |= _ReplayFile(argv[i]);
+  }
+  rc |= _ReplayOverlong();
+  rc |= _FloodText(num);
+  rc |= _FloodBinary(num);
+  printf("%s\n", (rc == 0) ? "PASS" : "FAIL");
+  return (rc == 0) ? 0 : 1;
+}
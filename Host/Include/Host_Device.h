@@ -0,0 +1,27 @@
+/*------------------------------------------------------------------------------
+ * Name:    Host_Device.h
+ * Purpose: Host stand-in for the CMSIS device header (AT_PORT_HOST)
+ *----------------------------------------------------------------------------*/
+/*
+ * Provides what the headers included by the command layer (Prof.h,
+ * Bench.h) use from the device header: the compiler keywords and a cycle
+ * counter, which stays 0 on the host.
+ */
+
+#ifndef HOST_DEVICE_H_
+#define HOST_DEVICE_H_
+
+#include <stdint.h>
+
+#define __INLINE                inline
+#define __NO_RETURN             __attribute__((noreturn))
+
+typedef struct {
+  volatile uint32_t CYCCNT;
+} Host_DWT_Type;
+
+extern Host_DWT_Type Host_DWT;
+
+#define DWT                     (&Host_DWT)
+
+#endif /* HOST_DEVICE_H_ */
@@ -0,0 +1,11 @@
+/*------------------------------------------------------------------------------
+ * Name:    RTE_Components.h
+ * Purpose: Host stand-in for the RTE component selection (AT_PORT_HOST)
+ *----------------------------------------------------------------------------*/
+
+#ifndef RTE_COMPONENTS_H
+#define RTE_COMPONENTS_H
+
+#define CMSIS_device_header     "Host_Device.h"
+
+#endif /* RTE_COMPONENTS_H */
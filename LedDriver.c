@@ -0,0 +1,206 @@
+/*------------------------------------------------------------------------------
+ * Name:    LedDriver.c
+ * Purpose: LED1..LED8 bitmask driver with software PWM brightness
+ *----------------------------------------------------------------------------*/
+/*
+ * The LED pins are taken from the CubeMX pin names in main.h. At
+ * initialization the LEDs are grouped by GPIO port, so LedDrv_Write only
+ * has to build one BSRR value (set and reset half) per port and store it
+ * with a single write. All LEDs of a port change in the same cycle and no
+ * LED ever passes through an intermediate state.
+ *
+ * Brightness uses bit angle modulation: a PWM frame has LED_PWM_BITS slots
+ * of 1, 2, 4, ... LED_PWM_UNIT_US, and in slot k an LED is enabled when bit
+ * k of its level is set. The enabled LEDs of every slot are precomputed
+ * when a level changes, so the TIM7 interrupt only does one LedDrv_Write
+ * per slot (4 interrupts per 1.5 ms frame by default). TIM7 is stopped
+ * while all LEDs are fully on or off.
+ */
+
+#include "main.h"
+#include "LedDriver.h"
+
+typedef struct {
+  GPIO_TypeDef *port;
+  uint16_t      pin;
+} LED_Pin;
+
+// LED n+1 is driven by mask bit n
+static const LED_Pin led_pin[LED_NUM] = {
+  { LED1_GPIO_Port, LED1_Pin },
+  { LED2_GPIO_Port, LED2_Pin },
+  { LED3_GPIO_Port, LED3_Pin },
+  { LED4_GPIO_Port, LED4_Pin },
+  { LED5_GPIO_Port, LED5_Pin },
+  { LED6_GPIO_Port, LED6_Pin },
+  { LED7_GPIO_Port, LED7_Pin },
+  { LED8_GPIO_Port, LED8_Pin },
+};
+
+static GPIO_TypeDef     *led_port[LED_NUM];     // Distinct LED ports
+static uint32_t          led_port_pins[LED_NUM];// All LED pins of a port
+static uint8_t           led_slot[LED_NUM];     // Port index of each LED
+static uint32_t          led_port_num;
+static volatile uint32_t led_mask;
+
+static uint8_t           led_level[LED_NUM];
+static uint32_t          led_bam[LED_PWM_BITS]; // LEDs enabled in PWM slot k
+static volatile uint32_t led_gate = LED_MASK_ALL;
+static uint32_t          led_bam_slot;
+static uint32_t          led_pwm_on;
+
+// Store one BSRR value per port.
+static void _Apply (uint32_t mask) {
+  uint32_t bsrr[LED_NUM];
+  uint32_t i, s;
+
+  for (s = 0U; s < led_port_num; s++) {
+    bsrr[s] = led_port_pins[s] << 16;   // Reset all LED pins of the port ...
+  }
+  for (i = 0U; i < LED_NUM; i++) {
+    if ((mask & (1U << i)) != 0U) {
+      bsrr[led_slot[i]] |= led_pin[i].pin;      // ... set wins over reset
+    }
+  }
+  for (s = 0U; s < led_port_num; s++) {
+    led_port[s]->BSRR = bsrr[s];
+  }
+}
+
+// APB1 timer kernel clock
+static uint32_t _TimerClock (void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+// Group LEDs by port and configure the pins as outputs, all LEDs off.
+void LedDrv_Initialize (void) {
+  GPIO_InitTypeDef init;
+  uint32_t         i, s;
+
+  led_port_num = 0U;
+  for (i = 0U; i < LED_NUM; i++) {
+    for (s = 0U; s < led_port_num; s++) {
+      if (led_port[s] == led_pin[i].port) {
+        break;
+      }
+    }
+    if (s == led_port_num) {
+      led_port[s]      = led_pin[i].port;
+      led_port_pins[s] = 0U;
+      led_port_num++;
+    }
+    led_port_pins[s] |= led_pin[i].pin;
+    led_slot[i]       = (uint8_t)s;
+    led_level[i]      = LED_LEVEL_MAX;
+  }
+
+  LedDrv_Write(0U);
+
+  init.Mode      = GPIO_MODE_OUTPUT_PP;
+  init.Pull      = GPIO_NOPULL;
+  init.Speed     = GPIO_SPEED_FREQ_LOW;
+  init.Alternate = 0U;
+  for (s = 0U; s < led_port_num; s++) {
+    init.Pin = led_port_pins[s];
+    HAL_GPIO_Init(led_port[s], &init);
+  }
+
+  // TIM7: 1 MHz count clock, update interrupt ends a PWM slot
+  __HAL_RCC_TIM7_CLK_ENABLE();
+  TIM7->CR1 = TIM_CR1_URS;
+  TIM7->PSC = (_TimerClock() / 1000000U) - 1U;
+  TIM7->ARR = LED_PWM_UNIT_US - 1U;
+  TIM7->EGR = TIM_EGR_UG;
+  TIM7->SR  = 0U;
+  NVIC_SetPriority(TIM7_IRQn, LED_PWM_IRQ_PRIO);
+  NVIC_EnableIRQ(TIM7_IRQn);
+}
+
+// Apply an LED mask, gated by the current PWM slot.
+void LedDrv_Write (uint32_t mask) {
+  uint32_t primask;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  led_mask = mask & LED_MASK_ALL;
+  _Apply(led_mask & led_gate);
+  __set_PRIMASK(primask);
+}
+
+// Last applied LED mask.
+uint32_t LedDrv_Read (void) {
+  return led_mask;
+}
+
+// Set LED brightness and rebuild the PWM slot masks.
+int LedDrv_SetLevel (uint32_t led, uint32_t level) {
+  uint32_t bam[LED_PWM_BITS];
+  uint32_t i, k, pwm;
+
+  if ((led >= LED_NUM) || (level > LED_LEVEL_MAX)) {
+    return -1;
+  }
+  led_level[led] = (uint8_t)level;
+
+  pwm = 0U;
+  for (k = 0U; k < LED_PWM_BITS; k++) {
+    bam[k] = 0U;
+    for (i = 0U; i < LED_NUM; i++) {
+      if ((led_level[i] & (1U << k)) != 0U) {
+        bam[k] |= 1U << i;
+      }
+    }
+    pwm |= bam[k] ^ bam[0];             // Differs between slots: needs PWM
+  }
+
+  NVIC_DisableIRQ(TIM7_IRQn);
+  for (k = 0U; k < LED_PWM_BITS; k++) {
+    led_bam[k] = bam[k];
+  }
+  if (pwm == 0U) {
+    // Only full on/off levels: static gate, no interrupts
+    TIM7->CR1 &= ~TIM_CR1_CEN;
+    TIM7->DIER = 0U;
+    led_pwm_on = 0U;
+    led_gate   = bam[0];
+    LedDrv_Write(led_mask);
+  } else if (led_pwm_on == 0U) {
+    led_pwm_on   = 1U;
+    led_bam_slot = 0U;
+    led_gate     = bam[0];
+    LedDrv_Write(led_mask);
+    TIM7->ARR  = LED_PWM_UNIT_US - 1U;
+    TIM7->CNT  = 0U;
+    TIM7->SR   = 0U;
+    TIM7->DIER = TIM_DIER_UIE;
+    TIM7->CR1 |= TIM_CR1_CEN;
+  }
+  NVIC_EnableIRQ(TIM7_IRQn);
+  return 0;
+}
+
+// Brightness of an LED.
+uint32_t LedDrv_GetLevel (uint32_t led) {
+  return (led < LED_NUM) ? led_level[led] : 0U;
+}
+
+// TIM7: advance to the next PWM slot
+void TIM7_IRQHandler (void);
+void TIM7_IRQHandler (void) {
+  uint32_t slot;
+
+  TIM7->SR = ~TIM_SR_UIF;
+  slot = led_bam_slot + 1U;
+  if (slot >= LED_PWM_BITS) {
+    slot = 0U;
+  }
+  led_bam_slot = slot;
+  TIM7->ARR    = (LED_PWM_UNIT_US << slot) - 1U;
+  led_gate     = led_bam[slot];
+  _Apply(led_mask & led_gate);
+}
@@ -0,0 +1,37 @@
+/*------------------------------------------------------------------------------
+ * Name:    LedDriver.h
+ * Purpose: LED1..LED8 bitmask driver with software PWM brightness
+ *----------------------------------------------------------------------------*/
+
+#ifndef LED_DRIVER_H_
+#define LED_DRIVER_H_
+
+#include <stdint.h>
+
+// LED PWM Configuration -------------------------------------------------------
+
+#define LED_PWM_BITS            (4U)    // Brightness resolution in bits
+#define LED_PWM_UNIT_US         (100U)  // Shortest PWM slot [us]
+#define LED_PWM_IRQ_PRIO        (6U)    // TIM7 interrupt priority
+
+//------------------------------------------------------------------------------
+
+#define LED_NUM                 (8U)            // LED1..LED8, bit n = LEDn+1
+#define LED_MASK_ALL            ((1U << LED_NUM) - 1U)
+#define LED_LEVEL_MAX           ((1U << LED_PWM_BITS) - 1U)
+
+extern void     LedDrv_Initialize (void);
+
+// Apply an LED mask: one BSRR write per GPIO port, bits above LED_NUM ignored.
+// May be called from threads and interrupts.
+extern void     LedDrv_Write      (uint32_t mask);
+
+// Last mask applied with LedDrv_Write.
+extern uint32_t LedDrv_Read       (void);
+
+// Set the brightness of LED led (0..LED_NUM-1) to 0..LED_LEVEL_MAX.
+// \return      0 on success, -1 on a bad LED or level
+extern int      LedDrv_SetLevel   (uint32_t led, uint32_t level);
+extern uint32_t LedDrv_GetLevel   (uint32_t led);
+
+#endif /* LED_DRIVER_H_ */
@@ -0,0 +1,110 @@
+/*------------------------------------------------------------------------------
+ * Name:    LedSeq.c
+ * Purpose: Timer driven LED pattern sequencer
+ *----------------------------------------------------------------------------*/
+/*
+ * The host uploads a table of (mask, duration) steps once (AT+LEDSEQ) and
+ * TIM6 plays it back: every update interrupt applies the next mask with
+ * LedDrv_Write and loads the duration of the step into ARR. No thread and
+ * no USB traffic is involved while a pattern runs, and step timing only
+ * has the interrupt latency as jitter.
+ *
+ * TIM6 has the same interrupt priority as the PWM timer in LedDriver.c,
+ * so the two never preempt each other in the middle of a BSRR update.
+ */
+
+#include "main.h"
+#include "LedDriver.h"
+#include "LedSeq.h"
+
+static uint8_t           seq_mask[LEDSEQ_MAX_STEPS];
+static uint16_t          seq_ticks[LEDSEQ_MAX_STEPS];
+static uint32_t          seq_num;
+static uint32_t          seq_repeat;
+static volatile uint32_t seq_step;
+static volatile uint32_t seq_loops;
+static volatile uint32_t seq_running;
+
+// Set up TIM6 with a LEDSEQ_TICK_HZ count clock.
+void LedSeq_Initialize (void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;                          // APB1 timer clock
+  }
+  __HAL_RCC_TIM6_CLK_ENABLE();
+  TIM6->CR1 = TIM_CR1_URS;
+  TIM6->PSC = (clk / LEDSEQ_TICK_HZ) - 1U;
+  TIM6->EGR = TIM_EGR_UG;
+  TIM6->SR  = 0U;
+  NVIC_SetPriority(TIM6_DAC_IRQn, LED_PWM_IRQ_PRIO);
+  NVIC_EnableIRQ(TIM6_DAC_IRQn);
+}
+
+// Stop playback, the LEDs keep their current state.
+void LedSeq_Stop (void) {
+  TIM6->CR1  &= ~TIM_CR1_CEN;
+  TIM6->DIER  = 0U;
+  TIM6->SR    = 0U;
+  seq_running = 0U;
+}
+
+void LedSeq_Clear (void) {
+  LedSeq_Stop();
+  seq_num = 0U;
+}
+
+int LedSeq_Add (uint32_t mask, uint32_t ms) {
+  if ((seq_running != 0U) || (seq_num >= LEDSEQ_MAX_STEPS) ||
+      (ms == 0U) || (ms > LEDSEQ_MAX_MS)) {
+    return -1;
+  }
+  seq_mask[seq_num]  = (uint8_t)(mask & LED_MASK_ALL);
+  seq_ticks[seq_num] = (uint16_t)(ms * (LEDSEQ_TICK_HZ / 1000U));
+  seq_num++;
+  return 0;
+}
+
+int LedSeq_Start (uint32_t repeat) {
+  if (seq_num == 0U) {
+    return -1;
+  }
+  LedSeq_Stop();
+  seq_repeat  = repeat;
+  seq_step    = 0U;
+  seq_loops   = 0U;
+  seq_running = 1U;
+  LedDrv_Write(seq_mask[0]);
+  TIM6->ARR  = seq_ticks[0] - 1U;
+  TIM6->CNT  = 0U;
+  TIM6->DIER = TIM_DIER_UIE;
+  TIM6->CR1 |= TIM_CR1_CEN;
+  return 0;
+}
+
+void LedSeq_GetStatus (LedSeq_Status *status) {
+  status->steps   = seq_num;
+  status->running = seq_running;
+  status->step    = seq_step;
+  status->loops   = seq_loops;
+}
+
+// TIM6: current step elapsed, show the next one
+void TIM6_DAC_IRQHandler (void);
+void TIM6_DAC_IRQHandler (void) {
+  uint32_t step;
+
+  TIM6->SR = ~TIM_SR_UIF;
+  step = seq_step + 1U;
+  if (step >= seq_num) {
+    step = 0U;
+    seq_loops++;
+    if ((seq_repeat != 0U) && (seq_loops >= seq_repeat)) {
+      LedSeq_Stop();
+      return;
+    }
+  }
+  seq_step  = step;
+  TIM6->ARR = seq_ticks[step] - 1U;
+  LedDrv_Write(seq_mask[step]);
+}
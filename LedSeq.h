@@ -0,0 +1,42 @@
+/*------------------------------------------------------------------------------
+ * Name:    LedSeq.h
+ * Purpose: Timer driven LED pattern sequencer
+ *----------------------------------------------------------------------------*/
+
+#ifndef LED_SEQ_H_
+#define LED_SEQ_H_
+
+#include <stdint.h>
+
+// LED Sequencer Configuration -------------------------------------------------
+
+#define LEDSEQ_MAX_STEPS        (64U)   // Maximum number of pattern steps
+#define LEDSEQ_TICK_HZ          (10000U)// TIM6 count clock
+#define LEDSEQ_MAX_MS           (65535U / (LEDSEQ_TICK_HZ / 1000U))
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+  uint32_t steps;               // Steps in the table
+  uint32_t running;             // 1 while the sequencer runs
+  uint32_t step;                // Current step
+  uint32_t loops;               // Completed passes through the table
+} LedSeq_Status;
+
+extern void LedSeq_Initialize (void);
+
+// Stop and empty the step table.
+extern void LedSeq_Clear      (void);
+
+// Append a step showing mask for ms milliseconds (1..LEDSEQ_MAX_MS).
+// \return      0 on success, -1 if running, full or ms out of range
+extern int  LedSeq_Add        (uint32_t mask, uint32_t ms);
+
+// Run the table repeat times (0 = forever); the last mask stays on at the end.
+// \return      0 on success, -1 if the table is empty
+extern int  LedSeq_Start      (uint32_t repeat);
+
+extern void LedSeq_Stop       (void);
+extern void LedSeq_GetStatus  (LedSeq_Status *status);
+
+#endif /* LED_SEQ_H_ */
@@ -19,7 +19,9 @@
 */
 
 // USER START (Optionally insert additional includes)
+#include <string.h>
 #include "Board_LED.h"                  // ::Board Support:LED
+#include "AT_Commands.h"
 // USER END
 
 #include "DIALOG.h"
@@ -37,6 +39,7 @@
 
 
 // USER START (Optionally insert additional defines)
+#define MSG_LCD_TEXT   (WM_USER + 0x00)  // New host text in the LCD mailbox
 // USER END
 
 /*********************************************************************
@@ -47,7 +50,7 @@
 */
 
 // USER START (Optionally insert additional static data)
-extern char storedLCDString[];
+static U32 _LcdVersion;                 // Mailbox version shown in the widget
 // USER END
 
 /*********************************************************************
@@ -82,6 +85,8 @@ static void _cbDialog(WM_MESSAGE * pMsg) {
   int     NCode;
   int     Id;
   // USER START (Optionally insert additional variables)
+  char    acText[LCD_STRING_SIZE];
+  char    acShown[LCD_STRING_SIZE];
   // USER END
 
   switch (pMsg->MsgId) {
@@ -93,6 +98,7 @@ static void _cbDialog(WM_MESSAGE * pMsg) {
     CHECKBOX_SetText(hItem, "LED 0");
     // USER START (Optionally insert additional code for further widget initialization)
     hItem = WM_GetDialogItem(pMsg->hWin, ID_MULTIEDIT_0);
+    MULTIEDIT_SetMaxNumChars(hItem, LCD_STRING_SIZE - 1);
     // USER END
     break;
   case WM_NOTIFY_PARENT:
@@ -128,20 +134,17 @@ static void _cbDialog(WM_MESSAGE * pMsg) {
       switch(NCode) {
       case WM_NOTIFICATION_CLICKED:
         // USER START (Optionally insert code for reacting on notification message)
-        hItem = WM_GetDialogItem(pMsg->hWin, ID_MULTIEDIT_0);
-        MULTIEDIT_GetText(hItem, storedLCDString, 100);
         // USER END
         break;
       case WM_NOTIFICATION_RELEASED:
         // USER START (Optionally insert code for reacting on notification message)
-        hItem = WM_GetDialogItem(pMsg->hWin, ID_MULTIEDIT_0);
-        MULTIEDIT_GetText(hItem, storedLCDString, 100);
         // USER END
         break;
       case WM_NOTIFICATION_VALUE_CHANGED:
         // USER START (Optionally insert code for reacting on notification message)
         hItem = WM_GetDialogItem(pMsg->hWin, ID_MULTIEDIT_0);
-        MULTIEDIT_GetText(hItem, storedLCDString, 100);
+        MULTIEDIT_GetText(hItem, acText, sizeof(acText));
+        editLCDString(acText);
         // USER END
         break;
       // USER START (Optionally insert additional code for further notification handling)
@@ -152,6 +155,17 @@ static void _cbDialog(WM_MESSAGE * pMsg) {
     }
     break;
   // USER START (Optionally insert additional message handling)
+  case MSG_LCD_TEXT:
+    //
+    // Show the host text; SetText invalidates only the MULTIEDIT
+    //
+    _LcdVersion = readLCDString(acText, sizeof(acText));
+    hItem = WM_GetDialogItem(pMsg->hWin, ID_MULTIEDIT_0);
+    MULTIEDIT_GetText(hItem, acShown, sizeof(acShown));
+    if (strcmp(acShown, acText) != 0) {
+      MULTIEDIT_SetText(hItem, acText);
+    }
+    break;
   // USER END
   default:
     WM_DefaultProc(pMsg);
@@ -178,6 +192,19 @@ WM_HWIN CreateMyDialog(void) {
 }
 
 // USER START (Optionally insert additional public code)
+/*********************************************************************
+*
+*       MyDialog_Update
+*
+*  Called by the GUI thread after each wake-up. Sends MSG_LCD_TEXT to the
+*  dialog when the host stored new text in the LCD mailbox.
+*/
+void MyDialog_Update(WM_HWIN hWin);
+void MyDialog_Update(WM_HWIN hWin) {
+  if (getLCDVersion() != _LcdVersion) {
+    WM_SendMessageNoPara(hWin, MSG_LCD_TEXT);
+  }
+}
 // USER END
 
 /*************************** End of file ****************************/
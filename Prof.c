@@ -0,0 +1,99 @@
+/*------------------------------------------------------------------------------
+ * Name:    Prof.c
+ * Purpose: Cycle counter profiler for hot paths (AT+PROF)
+ *----------------------------------------------------------------------------*/
+/*
+ * A site is measured with a begin/end pair around the code of interest,
+ *
+ *   start = Prof_Begin();
+ *   GUI_Exec();
+ *   Prof_End(PROF_GUI_EXEC, start);
+ *
+ * or at one point with Prof_Mark for periods. Each site has a fixed
+ * entry with count, min, max, sum and a log2 histogram of the DWT cycle
+ * counts; an update is a few instructions with interrupts disabled, so
+ * sites may be recorded from interrupt handlers (DMA2D, LTDC). The cycle
+ * counter wraps after 2^32 cycles (about 19 s), longer samples are not
+ * meaningful. With PROF_ENABLE 0 the markers compile to nothing.
+ */
+
+#include <string.h>
+
+#include "Prof.h"
+
+static Prof_Entry prof_tab[PROF_SITES] __attribute__((section(".bss.dtcm")));
+
+static const char * const prof_name[PROF_SITES] = {
+  "AT_COMMAND",
+  "READ_POT",
+  "CDC_LOOP",
+  "GUI_EXEC",
+  "VNC_UPDATE",
+  "DMA2D_FILL",
+  "DMA2D_COPY",
+  "DMA2D_CONVERT",
+  "DMA2D_BLEND",
+  "DMA2D_WAIT",
+  "FRAME"
+};
+
+#if (PROF_ENABLE != 0)
+void Prof_Record (Prof_Site site, uint32_t cycles) {
+  Prof_Entry *e = &prof_tab[site];
+  uint32_t    bucket, primask;
+
+  bucket = 32U - __CLZ(cycles >> PROF_HIST_SHIFT);
+  if (bucket >= PROF_BUCKETS) {
+    bucket = PROF_BUCKETS - 1U;
+  }
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if ((e->count == 0U) || (cycles < e->min)) {
+    e->min = cycles;
+  }
+  if (cycles > e->max) {
+    e->max = cycles;
+  }
+  e->count++;
+  e->sum += cycles;
+  e->hist[bucket]++;
+  __set_PRIMASK(primask);
+}
+
+void Prof_Mark (Prof_Site site) {
+  uint32_t now, last;
+
+  now  = DWT->CYCCNT;
+  last = prof_tab[site].last;
+  prof_tab[site].last = now;
+  if (last != 0U) {
+    Prof_Record(site, now - last);
+  }
+}
+#endif
+
+void Prof_Get (Prof_Site site, Prof_Entry *entry) {
+  uint32_t primask;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  *entry = prof_tab[site];
+  __set_PRIMASK(primask);
+}
+
+void Prof_Reset (void) {
+  uint32_t primask;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  memset(prof_tab, 0, sizeof(prof_tab));
+  __set_PRIMASK(primask);
+}
+
+const char *Prof_SiteName (Prof_Site site) {
+  return (site < PROF_SITES) ? prof_name[site] : "?";
+}
+
+uint32_t Prof_CyclesToUs (uint64_t cycles) {
+  return (uint32_t)(cycles / (SystemCoreClock / 1000000U));
+}
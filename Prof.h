@@ -0,0 +1,87 @@
+/*------------------------------------------------------------------------------
+ * Name:    Prof.h
+ * Purpose: Cycle counter profiler for hot paths (AT+PROF)
+ *----------------------------------------------------------------------------*/
+
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <stdint.h>
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+
+// Profiler Configuration ------------------------------------------------------
+
+#define PROF_ENABLE             1       // 0 = markers compile to nothing
+#define PROF_BUCKETS            (16U)   // Histogram buckets per site
+#define PROF_HIST_SHIFT         (10U)   // Bucket 0: below 2^shift cycles
+#define PROF_OVERLAY            0       // 1 = emWin overlay with frame time and top sites
+#define PROF_OVERLAY_MS         (500U)  // Overlay refresh period [ms]
+
+//------------------------------------------------------------------------------
+
+// Profiled sites
+typedef enum {
+  PROF_AT_COMMAND = 0,          // AT command or binary frame execution
+  PROF_READ_POT,                // ReadPot
+  PROF_CDC_LOOP,                // CDC bridge thread loop
+  PROF_GUI_EXEC,                // GUI_Exec
+  PROF_VNC_UPDATE,              // VNC update of one viewer, including sending
+  PROF_DMA2D_FILL,              // DMA2D register to memory (fill)
+  PROF_DMA2D_COPY,              // DMA2D memory to memory (copy)
+  PROF_DMA2D_CONVERT,           // DMA2D pixel format conversion
+  PROF_DMA2D_BLEND,             // DMA2D blending
+  PROF_DMA2D_WAIT,              // CPU waiting for queued DMA2D operations
+  PROF_FRAME,                   // Time between display page flips
+  PROF_SITES
+} Prof_Site;
+
+typedef struct {
+  uint32_t count;               // Samples
+  uint32_t min;                 // Shortest sample [cycles]
+  uint32_t max;                 // Longest sample [cycles]
+  uint32_t last;                // Cycle counter at the last Prof_Mark
+  uint64_t sum;                 // Total [cycles]
+  uint32_t hist[PROF_BUCKETS];  // Bucket b >= 1: 2^(shift+b-1) .. 2^(shift+b)-1 cycles
+} Prof_Entry;
+
+#if (PROF_ENABLE != 0)
+
+// Start of a measurement: keep the value for Prof_End.
+static __INLINE uint32_t Prof_Begin (void) {
+  return DWT->CYCCNT;
+}
+
+// Record the cycles since start for site; may be called from ISRs.
+extern void Prof_Record (Prof_Site site, uint32_t cycles);
+
+static __INLINE void Prof_End (Prof_Site site, uint32_t start) {
+  Prof_Record(site, DWT->CYCCNT - start);
+}
+
+// Record the cycles since the previous mark of site (periods, e.g. frames).
+extern void Prof_Mark  (Prof_Site site);
+
+#else
+
+static __INLINE uint32_t Prof_Begin (void) { return 0U; }
+static __INLINE void     Prof_End   (Prof_Site site, uint32_t start) { (void)site; (void)start; }
+static __INLINE void     Prof_Mark  (Prof_Site site) { (void)site; }
+
+#endif
+
+// The cycle counter is started by Stats_Initialize.
+
+// Consistent copy of the entry of site.
+extern void        Prof_Get      (Prof_Site site, Prof_Entry *entry);
+extern void        Prof_Reset    (void);
+extern const char *Prof_SiteName (Prof_Site site);
+
+// Convert cycles to microseconds.
+extern uint32_t    Prof_CyclesToUs (uint64_t cycles);
+
+// Create the overlay window (PROF_OVERLAY); call from the GUI thread.
+extern void        ProfOverlay_Create (void);
+
+#endif /* PROF_H_ */
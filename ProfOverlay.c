@@ -0,0 +1,125 @@
+/*------------------------------------------------------------------------------
+ * Name:    ProfOverlay.c
+ * Purpose: emWin overlay with frame time and the busiest profiler sites
+ *----------------------------------------------------------------------------*/
+/*
+ * With PROF_OVERLAY set the GUI thread creates a small stay-on-top window
+ * in the bottom right corner. Every PROF_OVERLAY_MS it shows the average
+ * frame time and the PROF_OVERLAY_TOP sites that took the most cycles
+ * since the previous refresh, as a share of that period. The WM timer of
+ * the window updates the text in GUI_Exec and invalidates the window; the
+ * overlay keeps the GUI frame timer running (GUI_SetAnimating) so the
+ * event driven GUI thread runs GUI_Exec while the WM timer is pending.
+ */
+
+#include <stdio.h>
+
+#include "GUI.h"
+#include "WM.h"
+
+#include "GUI_Thread.h"
+#include "Prof.h"
+
+#if (PROF_OVERLAY != 0)
+
+#define PROF_OVERLAY_TOP        (3U)    // Sites shown
+#define PROF_OVERLAY_XSIZE      (150)
+#define PROF_OVERLAY_YSIZE      (12 * (1 + PROF_OVERLAY_TOP))
+
+static uint64_t overlay_sum[PROF_SITES];        // Site sums at the last refresh
+static uint32_t overlay_count;                  // Frame count at the last refresh
+static uint32_t overlay_cycle;                  // Cycle counter at the last refresh
+static char     overlay_text[1U + PROF_OVERLAY_TOP][24];
+
+// Format the frame time and the top sites since the last refresh.
+static void _OverlayUpdate (void) {
+  Prof_Entry e;
+  uint64_t   delta[PROF_SITES], frame_sum;
+  uint32_t   i, n, top, now, period, frames;
+
+  now    = DWT->CYCCNT;
+  period = now - overlay_cycle;
+  overlay_cycle = now;
+
+  frames    = 0U;
+  frame_sum = 0U;
+  for (i = 0U; i < PROF_SITES; i++) {
+    Prof_Get((Prof_Site)i, &e);
+    delta[i]       = e.sum - overlay_sum[i];
+    overlay_sum[i] = e.sum;
+    if (i == PROF_FRAME) {
+      frames        = e.count - overlay_count;
+      frame_sum     = delta[i];
+      overlay_count = e.count;
+      delta[i]      = 0U;                       // A period, not busy time
+    }
+  }
+
+  n = (frames != 0U) ? Prof_CyclesToUs(frame_sum / frames) : 0U;
+  (void)snprintf(overlay_text[0], sizeof(overlay_text[0]), "frame %u.%u ms", n / 1000U, (n % 1000U) / 100U);
+  for (n = 0U; n < PROF_OVERLAY_TOP; n++) {
+    top = PROF_SITES;
+    for (i = 0U; i < PROF_SITES; i++) {
+      if ((delta[i] != 0U) && ((top == PROF_SITES) || (delta[i] > delta[top]))) {
+        top = i;
+      }
+    }
+    if ((top == PROF_SITES) || (period == 0U)) {
+      overlay_text[n + 1U][0] = '\0';
+      continue;
+    }
+    i = (uint32_t)((delta[top] * 1000U) / period);  // [0.1 %]
+    (void)snprintf(overlay_text[n + 1U], sizeof(overlay_text[0]), "%-13s%3u.%u%%",
+                   Prof_SiteName((Prof_Site)top), i / 10U, i % 10U);
+    delta[top] = 0U;
+  }
+}
+
+static void _OverlayPaint (void) {
+  uint32_t i;
+
+  GUI_SetBkColor(GUI_BLACK);
+  GUI_Clear();
+  GUI_SetColor(GUI_WHITE);
+  GUI_SetFont(GUI_FONT_8X8);
+  for (i = 0U; i < (1U + PROF_OVERLAY_TOP); i++) {
+    GUI_DispStringAt(overlay_text[i], 2, 2 + (12 * (int)i));
+  }
+}
+
+static void _cbOverlay (WM_MESSAGE *pMsg) {
+  switch (pMsg->MsgId) {
+    case WM_PAINT:
+      _OverlayPaint();
+      break;
+    case WM_TIMER:
+      _OverlayUpdate();
+      WM_InvalidateWindow(pMsg->hWin);
+      WM_RestartTimer(pMsg->Data.v, PROF_OVERLAY_MS);
+      break;
+    default:
+      WM_DefaultProc(pMsg);
+      break;
+  }
+}
+
+void ProfOverlay_Create (void) {
+  WM_HWIN hWin;
+
+  hWin = WM_CreateWindow(LCD_GetXSize() - PROF_OVERLAY_XSIZE, LCD_GetYSize() - PROF_OVERLAY_YSIZE,
+                         PROF_OVERLAY_XSIZE, PROF_OVERLAY_YSIZE,
+                         WM_CF_SHOW | WM_CF_STAYONTOP, _cbOverlay, 0);
+  if (hWin == 0) {
+    return;
+  }
+  if (WM_CreateTimer(hWin, 0, PROF_OVERLAY_MS, 0) != 0) {
+    GUI_SetAnimating(1U);               // The window and its timer stay
+  }
+}
+
+#else
+
+void ProfOverlay_Create (void) {
+}
+
+#endif
@@ -54,6 +54,7 @@ extern "C" {
 void Error_Handler(void);
 void MX_ETH_Init(void);
 void MX_LTDC_Init(void);
+void MX_USB_OTG_HS_PCD_Init(void);
 
 /* USER CODE BEGIN EFP */
 
@@ -87,7 +87,6 @@ static void MX_GPIO_Init(void);
 static void MX_FMC_Init(void);
 static void MX_USART1_UART_Init(void);
 static void MX_DMA2D_Init(void);
-static void MX_USB_OTG_HS_PCD_Init(void);
 static void MX_ADC3_Init(void);
 /* USER CODE BEGIN PFP */
 /* Private function prototypes -----------------------------------------------*/
@@ -166,7 +165,6 @@ int main(void)
   MX_GPIO_Init();
   MX_USART1_UART_Init();
   MX_DMA2D_Init();
-  MX_USB_OTG_HS_PCD_Init();
   MX_ADC3_Init();
   /* USER CODE BEGIN 2 */
 
@@ -506,7 +504,7 @@ static void MX_USART1_UART_Init(void)
   * @param None
   * @retval None
   */
-static void MX_USB_OTG_HS_PCD_Init(void)
+void MX_USB_OTG_HS_PCD_Init(void)
 {
 
   /* USER CODE BEGIN USB_OTG_HS_Init 0 */
@@ -617,6 +615,26 @@ static void MX_GPIO_Init(void)
 
 /* MPU Configuration */
 
+/*
+ * Memory attribute map (see stm32f746ng.sct for the matching sections):
+ *   Region 0  0x20000000 512 kB  Normal, write-back, write-allocate
+ *             DTCM (not cached): hot data, DMA2D conversion buffers
+ *             (.bss.dtcm); SRAM1: CPU data, stacks, network heap
+ *   Region 1  0x2004C000  16 kB  Normal, non-cacheable (SRAM2)
+ *             ETH MAC DMA descriptors and buffers (EMAC_DMA_MEMORY_ADDRESS),
+ *             ADC and UART receive DMA buffers (.bss.nocache)
+ *   Region 2  0xC0000000  16 MB  Normal, non-cacheable (SDRAM)
+ *             emWin heap (.bss.sdram.gui), LTDC frame buffers, VNC
+ *             encoding arenas (.bss.sdram)
+ *   Region 3  0x00000000  256 B  No access
+ *             Start of ITCM, left empty (ER_ITCM starts at 0x00000100):
+ *             NULL pointer accesses fault instead of reaching a handler
+ * The rest of the ITCM (interrupt handlers) is covered by the default
+ * memory map.
+ * DMA buffers in regions 1 and 2 need no cache maintenance
+ * (EMAC_DCACHE_MAINTENANCE=0); DMA2D maintains only sources and
+ * destinations located in region 0.
+ */
 void MPU_Config(void)
 {
   MPU_Region_InitTypeDef MPU_InitStruct = {0};
@@ -645,6 +663,8 @@ void MPU_Config(void)
   MPU_InitStruct.Number = MPU_REGION_NUMBER1;
   MPU_InitStruct.BaseAddress = 0x2004C000;
   MPU_InitStruct.Size = MPU_REGION_SIZE_16KB;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
   MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
   MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
 
@@ -655,6 +675,23 @@ void MPU_Config(void)
   MPU_InitStruct.Number = MPU_REGION_NUMBER2;
   MPU_InitStruct.BaseAddress = 0xC0000000;
   MPU_InitStruct.Size = MPU_REGION_SIZE_16MB;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+  MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+  MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+
+  HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+  /** Initializes and configures the Region and the memory to be protected
+  */
+  MPU_InitStruct.Number = MPU_REGION_NUMBER3;
+  MPU_InitStruct.BaseAddress = 0x0;
+  MPU_InitStruct.Size = MPU_REGION_SIZE_256B;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL0;
+  MPU_InitStruct.AccessPermission = MPU_REGION_NO_ACCESS;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+  MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+  MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
 
   HAL_MPU_ConfigRegion(&MPU_InitStruct);
   /* Enables the MPU */
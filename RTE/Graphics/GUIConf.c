@@ -50,9 +50,13 @@ Purpose     : Display controller initialization
 **********************************************************************
 */
 //
-// Define the available number of bytes available for the GUI
+// Define the available number of bytes available for the GUI.
+// The heap fills the SDRAM below the frame buffers (RW_SDRAM_GUI in
+// stm32f746ng.sct), which leaves room for memory devices. The SDRAM is
+// not cacheable, so DMA2D operations on memory devices need no cache
+// maintenance.
 //
-#define GUI_NUMBYTES  0x10000
+#define GUI_NUMBYTES  0x00200000
 
 /*********************************************************************
 *
@@ -70,9 +74,9 @@ Purpose     : Display controller initialization
 */
 void GUI_X_Config(void) {
   //
-  // 32 bit aligned memory area
+  // 32 bit aligned memory area in SDRAM, not initialized (set up by main)
   //
-  static U32 aMemory[GUI_NUMBYTES / 4];
+  static U32 aMemory[GUI_NUMBYTES / 4] __attribute__((section(".bss.sdram.gui"), aligned(32)));
   //
   // Assign memory to emWin
   //
@@ -65,6 +65,9 @@ can be set here.
 #include "LCD_X.h"
 
 #include "stm32f7xx_hal.h"
+#include "VNC_Server.h"
+#include "Prof.h"
+#include "AppEvr.h"
 
 /*********************************************************************
 *
@@ -111,7 +114,7 @@ can be set here.
 //
 // Buffers / VScreens
 //
-#define NUM_BUFFERS  1 // Number of multiple buffers to be used (at least 1 buffer)
+#define NUM_BUFFERS  3 // Number of multiple buffers to be used (at least 1 buffer)
 #define NUM_VSCREENS 1 // Number of virtual  screens to be used (at least 1 screen)
 
 //
@@ -129,6 +132,10 @@ can be set here.
 #define USE_TOUCH   0
 #endif
 //
+// Report drawn areas and buffer flips of layer 0 to the VNC server
+//
+#define USE_VNC     1
+//
 // Touch screen calibration
 #define TOUCH_X_MIN 0x0000
 #define TOUCH_X_MAX 0x01E0
@@ -141,9 +148,22 @@ can be set here.
 #define VRAM_ADDR 0xC0200000
 
 //
-// DMA2D Buffer Address
+// Number of DMA2D operations which can be queued (power of 2)
+//
+#define DMA2D_QUEUE_SIZE 8
+
+//
+// Cacheable RAM which needs cache maintenance for DMA2D transfers.
+// DTCM is not cached, SDRAM and RW_SRAM2_NOCACHE are not cacheable (MPU).
 //
-#define DMA2D_BUFFER_ADDR 0xC0000000
+// DMA2D conversion buffers and the operation queue are accessed by the
+// CPU and the DMA2D for every drawing operation, so they are placed in
+// DTCM (zero wait states, no cache maintenance; stm32f746ng.sct).
+//
+#define DTCM_DATA __attribute__((section(".bss.dtcm"), aligned(32)))
+//
+#define CACHED_RAM_START 0x20010000
+#define CACHED_RAM_END   0x2004C000
 
 /*********************************************************************
 *
@@ -459,6 +479,9 @@ static void _Index2ColorBulk_##PFIX##_DMA2D(void * pIndex, LCD_COLOR * pColor, U
 #if (NUM_VSCREENS > 1) && (NUM_BUFFERS > 1)
   #error Virtual screens together with multiple buffers are not allowed!
 #endif
+#if USE_VNC && ((NUM_BUFFERS > VNC_FB_BUFFERS) || (XSIZE_PHYS > VNC_XSIZE_MAX) || (YSIZE_PHYS > VNC_YSIZE_MAX))
+  #error VNC server configuration (VNC_Server.h) does not match the display!
+#endif
 
 /*********************************************************************
 *
@@ -489,18 +512,6 @@ static const U8 _aMirror[] = {
 };
 
 
-#ifndef      __MEMORY_AT
-  #if     (defined (__CC_ARM))
-    #define  __MEMORY_AT(x)     __attribute__((at(x)))
-  #elif   (defined (__ARMCC_VERSION) && (__ARMCC_VERSION >= 6010050))
-    #define  __MEMORY_AT__(x)   __attribute__((section(".bss.ARM.__at_"#x)))
-    #define  __MEMORY_AT(x)     __MEMORY_AT__(x)
-  #else
-    #define  __MEMORY_AT(x)
-    #warning Position memory containing __MEMORY_AT macro at absolute address!
-  #endif
-#endif
-
 #if (GUI_NUM_LAYERS == 2)
 #define VRAM_SIZE \
  ((XSIZE_0 * YSIZE_0 * BYTE_PER_PIXEL_0 * NUM_VSCREENS * NUM_BUFFERS) + \
@@ -517,7 +528,11 @@ static const U32 _aAddr[GUI_NUM_LAYERS] = {
 #endif
 };
 
-static volatile int _aPendingBuffer[2] = { -1, -1 };  // Important: Needs to be volatile
+static volatile int _aPendingBuffer[GUI_NUM_LAYERS] = { -1,  // Important: Needs to be volatile
+#if (GUI_NUM_LAYERS > 1)
+  -1
+#endif
+};
 
 static int _aBufferIndex[GUI_NUM_LAYERS];
 static int _axSize[GUI_NUM_LAYERS];
@@ -536,26 +551,52 @@ static void _DMA_Color2IndexBulk(LCD_COLOR * pColor, void * pIndex, U32 NumItems
 //
 DEFINE_DMA2D_COLORCONVERSION(M8888I, LTDC_PIXEL_FORMAT_ARGB8888)
 DEFINE_DMA2D_COLORCONVERSION(M888,   LTDC_PIXEL_FORMAT_ARGB8888) // Internal pixel format of emWin is 32 bit, because of that ARGB8888
-//DEFINE_DMA2D_COLORCONVERSION(M565,   LTDC_PIXEL_FORMAT_RGB565)
+DEFINE_DMA2D_COLORCONVERSION(M565,   LTDC_PIXEL_FORMAT_RGB565)  // Format of layer 0
 DEFINE_DMA2D_COLORCONVERSION(M1555I, LTDC_PIXEL_FORMAT_ARGB1555)
 DEFINE_DMA2D_COLORCONVERSION(M4444I, LTDC_PIXEL_FORMAT_ARGB4444)
 
 //
 // Buffer for DMA2D color conversion, required because hardware does not support overlapping regions
 //
+#define DMA2D_BUFFER_ITEMS (XSIZE_PHYS * sizeof(U32))  // Colors per conversion buffer, bulk conversions are done in chunks of this size
 
 #if (GUI_USE_ARGB == 0)
-static U32 _aBuffer[XSIZE_PHYS * sizeof(U32) * 3] __MEMORY_AT(DMA2D_BUFFER_ADDR);
+static U32 _aBuffer[XSIZE_PHYS * sizeof(U32) * 3] DTCM_DATA;
 
 static U32 * _pBuffer_DMA2D = &_aBuffer[XSIZE_PHYS * sizeof(U32) * 0];
 static U32 * _pBuffer_FG    = &_aBuffer[XSIZE_PHYS * sizeof(U32) * 1];
 static U32 * _pBuffer_BG    = &_aBuffer[XSIZE_PHYS * sizeof(U32) * 2];
 #else
-static U32 _aBuffer[40 * 40] __MEMORY_AT(DMA2D_BUFFER_ADDR);  // Only required for drawing AA4 characters
+static U32 _aBuffer[40 * 40] DTCM_DATA;  // Only required for drawing AA4 characters
 #endif
 
 static uint32_t _CLUT[256];
 
+//
+// Queue of DMA2D operations. The operation at _QueueRd is running while the
+// queue is not empty, the transfer complete interrupt starts the next one.
+//
+typedef struct {
+  U32 CR;
+  U32 FGMAR, FGOR, FGPFCCR, FGCOLR;
+  U32 BGMAR, BGOR, BGPFCCR;
+  U32 OMAR,  OOR,  OPFCCR,  OCOLR;
+  U32 NLR;
+  U32 InvAddr, InvSize;  // Cacheable output area, invalidated on completion
+} DMA2D_OP;
+
+static DMA2D_OP          _aQueue[DMA2D_QUEUE_SIZE] DTCM_DATA;
+static volatile unsigned _QueueRd;
+static volatile unsigned _QueueWr;
+static U32               _DmaStart;  // Cycle counter at the start of the running operation (Prof.h)
+
+//
+// Bits per pixel of the DMA2D color modes
+//
+static const U8 _aBitsPerPixel[16] = {
+  32, 24, 16, 16, 16, 8, 8, 16, 4, 8, 4
+};
+
 //
 // Array of color conversions for each layer
 //
@@ -579,6 +620,16 @@ static const int _aOrientation[] = {
 static LTDC_HandleTypeDef  LTDC_Handle;
 static DMA2D_HandleTypeDef DMA2D_Handle;
 
+//
+// Mark an area drawn by a hook in the current buffer of the VNC layer
+//
+#if USE_VNC
+  #define VNC_MARK(LayerIndex, x0, y0, x1, y1) \
+    if ((LayerIndex) == 0) { VNC_Server_Mark(_aBufferIndex[0], (x0), (y0), (x1), (y1)); }
+#else
+  #define VNC_MARK(LayerIndex, x0, y0, x1, y1)
+#endif
+
 /*********************************************************************
 *
 *       Static code
@@ -618,24 +669,163 @@ static U32 _GetPixelformat(unsigned LayerIndex) {
 
 /*********************************************************************
 *
-*       _DMA_ExecOperation
+*       _DMA_GetArea
+*
+* Purpose:
+*   Computes the cache line aligned range of a DMA2D area if it is located
+*   in cacheable RAM. Returns 0 if no cache maintenance is required.
 */
-static void _DMA_ExecOperation(void) {
-  //
-  // Invalidate and clean the data cache before executing the DMA2D operation.
-  // Otherwise we would have artifacts on the LCD.
-  //
-  SCB_CleanInvalidateDCache();
+static U32 _DMA_GetArea(U32 Addr, U32 PixelFormat, U32 NLR, U32 OffLine, U32 * pStart) {
+  U32 xSize, ySize, NumBytes, Start;
+
+  if ((Addr < CACHED_RAM_START) || (Addr >= CACHED_RAM_END)) {
+    return 0;
+  }
+  xSize    = NLR >> 16;
+  ySize    = NLR & 0xFFFF;
+  NumBytes = (((ySize - 1) * (xSize + OffLine) + xSize) * _aBitsPerPixel[PixelFormat & 0xF] + 7) >> 3;
+  Start    = Addr & ~31UL;
+  *pStart  = Start;
+  return (NumBytes + (Addr - Start) + 31) & ~31UL;
+}
+
+/*********************************************************************
+*
+*       _DMA_Start
+*/
+static void _DMA_Start(const DMA2D_OP * pOp) {
+  DMA2D->FGMAR   = pOp->FGMAR;
+  DMA2D->FGOR    = pOp->FGOR;
+  DMA2D->FGPFCCR = pOp->FGPFCCR;
+  DMA2D->FGCOLR  = pOp->FGCOLR;
+  DMA2D->BGMAR   = pOp->BGMAR;
+  DMA2D->BGOR    = pOp->BGOR;
+  DMA2D->BGPFCCR = pOp->BGPFCCR;
+  DMA2D->OMAR    = pOp->OMAR;
+  DMA2D->OOR     = pOp->OOR;
+  DMA2D->OPFCCR  = pOp->OPFCCR;
+  DMA2D->OCOLR   = pOp->OCOLR;
+  DMA2D->NLR     = pOp->NLR;
+  _DmaStart      = Prof_Begin();
+  AppEvr_Record(EVR_DMA2D_START, (pOp->CR & DMA2D_CR_MODE) >> 16, pOp->NLR);
+  DMA2D->CR      = pOp->CR | DMA2D_CR_TEIE | DMA2D_CR_START;
+}
+
+/*********************************************************************
+*
+*       _DMA_ProfSite
+*
+* Purpose:
+*   Profiler site of an operation, by DMA2D transfer mode.
+*/
+static Prof_Site _DMA_ProfSite(const DMA2D_OP * pOp) {
+  switch (pOp->CR & DMA2D_CR_MODE) {
+  case DMA2D_R2M:
+    return PROF_DMA2D_FILL;
+  case DMA2D_M2M:
+    return PROF_DMA2D_COPY;
+  case DMA2D_M2M_PFC:
+    return PROF_DMA2D_CONVERT;
+  default:
+    return PROF_DMA2D_BLEND;
+  }
+}
+
+/*********************************************************************
+*
+*       _DMA_Wait
+*
+* Purpose:
+*   Waits until all queued DMA2D operations are done. Required before the
+*   CPU accesses the result of an operation or a buffer it still uses.
+*/
+static void _DMA_Wait(void) {
+  U32 Start;
+
+  if (_QueueRd == _QueueWr) {
+    return;
+  }
+  Start = Prof_Begin();
+  while (_QueueRd != _QueueWr) {
+    __WFI();                                        // Sleep until next interrupt
+  }
+  Prof_End(PROF_DMA2D_WAIT, Start);
+}
+
+/*********************************************************************
+*
+*       LCD_X_DMA2D_Wait
+*
+* Purpose:
+*   Waits until all queued DMA2D operations are done, for timing them
+*   from outside (Bench.c).
+*/
+void LCD_X_DMA2D_Wait(void);
+void LCD_X_DMA2D_Wait(void) {
+  _DMA_Wait();
+}
+
+/*********************************************************************
+*
+*       _DMA_Submit
+*
+* Purpose:
+*   Queues a DMA2D operation and returns without waiting for it.
+*   Instead of cleaning the whole data cache only the areas touched by
+*   the operation are maintained: sources in cacheable RAM are cleaned,
+*   the output area is cleaned and invalidated now and invalidated
+*   again when the operation is done.
+*/
+static void _DMA_Submit(DMA2D_OP * pOp) {
+  U32 Mode, Start, Size;
+
+  Start = 0;
+  Mode = pOp->CR & DMA2D_CR_MODE;
+  if (Mode != DMA2D_R2M) {
+    Size = _DMA_GetArea(pOp->FGMAR, pOp->FGPFCCR, pOp->NLR, pOp->FGOR, &Start);
+    if (Size) {
+      SCB_CleanDCache_by_Addr((uint32_t *)Start, (int32_t)Size);
+    }
+  }
+  if (Mode == DMA2D_M2M_BLEND) {
+    Size = _DMA_GetArea(pOp->BGMAR, pOp->BGPFCCR, pOp->NLR, pOp->BGOR, &Start);
+    if (Size) {
+      SCB_CleanDCache_by_Addr((uint32_t *)Start, (int32_t)Size);
+    }
+  }
   //
-  // Execute operation
+  // Without PFC the output has the pixel size of the foreground
   //
-  DMA2D->CR |= DMA2D_CR_START;                      // Control Register (Start operation)
+  Size = _DMA_GetArea(pOp->OMAR, (Mode == DMA2D_M2M) ? pOp->FGPFCCR : pOp->OPFCCR, pOp->NLR, pOp->OOR, &Start);
+  if (Size) {
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *)Start, (int32_t)Size);
+  }
+  pOp->InvAddr = Start;
+  pOp->InvSize = Size;
   //
-  // Wait until transfer is done
+  // Wait for a free entry
   //
-  while (DMA2D->CR & DMA2D_CR_START) {
+  while ((_QueueWr - _QueueRd) >= DMA2D_QUEUE_SIZE) {
     __WFI();                                        // Sleep until next interrupt
   }
+  _aQueue[_QueueWr & (DMA2D_QUEUE_SIZE - 1)] = *pOp;
+  __disable_irq();
+  if (_QueueRd == _QueueWr++) {
+    _DMA_Start(pOp);                                // Queue was empty
+  }
+  __enable_irq();
+}
+
+/*********************************************************************
+*
+*       _DMA_ExecOperation
+*
+* Purpose:
+*   Queues an operation and waits for the result.
+*/
+static void _DMA_ExecOperation(DMA2D_OP * pOp) {
+  _DMA_Submit(pOp);
+  _DMA_Wait();
 }
 
 /*********************************************************************
@@ -643,17 +833,18 @@ static void _DMA_ExecOperation(void) {
 *       _DMA_Copy
 */
 static void _DMA_Copy(int LayerIndex, const void * pSrc, void * pDst, int xSize, int ySize, int OffLineSrc, int OffLineDst) {
+  DMA2D_OP Op = { 0 };
   U32 PixelFormat;
 
   PixelFormat = _GetPixelformat(LayerIndex);
-  DMA2D->CR      = 0x00000000UL | (1 << 9);         // Control Register (Memory to memory and TCIE)
-  DMA2D->FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
-  DMA2D->OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
-  DMA2D->FGOR    = (U32)OffLineSrc;                 // Foreground Offset Register (Source line offset)
-  DMA2D->OOR     = (U32)OffLineDst;                 // Output Offset Register (Destination line offset)
-  DMA2D->FGPFCCR = PixelFormat;                     // Foreground PFC Control Register (Defines the input pixel format)
-  DMA2D->NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
-  _DMA_ExecOperation();
+  Op.CR      = 0x00000000UL | (1 << 9);         // Control Register (Memory to memory and TCIE)
+  Op.FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
+  Op.OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
+  Op.FGOR    = (U32)OffLineSrc;                 // Foreground Offset Register (Source line offset)
+  Op.OOR     = (U32)OffLineDst;                 // Output Offset Register (Destination line offset)
+  Op.FGPFCCR = PixelFormat;                     // Foreground PFC Control Register (Defines the input pixel format)
+  Op.NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
+  _DMA_ExecOperation(&Op);
 }
 
 /*********************************************************************
@@ -661,17 +852,19 @@ static void _DMA_Copy(int LayerIndex, const void * pSrc, void * pDst, int xSize,
 *       _DMA_DrawBitmap
 */
 static void _DMA_DrawBitmap(void * pDst, const void * pSrc, int xSize, int ySize, int OffLineSrc, int OffLineDst, int PixelFormatSrc, int PixelFormatDst) {
-  DMA2D->CR      = 0x00010000UL | (1 << 9);         // Control Register (Memory-to-memory with PFC and TCIE)
-  DMA2D->FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
-  DMA2D->BGMAR   = (U32)pDst;                       // Background Memory Address Register (Destination address)
-  DMA2D->OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
-  DMA2D->FGOR    = OffLineSrc;                      // Foreground Offset Register (Source line offset)
-  DMA2D->BGOR    = OffLineDst;                      // Background Offset Register (Destination line offset)
-  DMA2D->OOR     = OffLineDst;                      // Output Offset Register (Destination line offset)
-  DMA2D->FGPFCCR = PixelFormatSrc;                  // Foreground PFC Control Register (Defines the input pixel format)
-  DMA2D->OPFCCR  = PixelFormatDst;                  // Output     PFC Control Register (Defines the output pixel format)
-  DMA2D->NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
-  _DMA_ExecOperation();
+  DMA2D_OP Op = { 0 };
+
+  Op.CR      = 0x00010000UL | (1 << 9);         // Control Register (Memory-to-memory with PFC and TCIE)
+  Op.FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
+  Op.BGMAR   = (U32)pDst;                       // Background Memory Address Register (Destination address)
+  Op.OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
+  Op.FGOR    = OffLineSrc;                      // Foreground Offset Register (Source line offset)
+  Op.BGOR    = OffLineDst;                      // Background Offset Register (Destination line offset)
+  Op.OOR     = OffLineDst;                      // Output Offset Register (Destination line offset)
+  Op.FGPFCCR = PixelFormatSrc;                  // Foreground PFC Control Register (Defines the input pixel format)
+  Op.OPFCCR  = PixelFormatDst;                  // Output     PFC Control Register (Defines the output pixel format)
+  Op.NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
+  _DMA_ExecOperation(&Op);
 }
 
 /*********************************************************************
@@ -679,18 +872,20 @@ static void _DMA_DrawBitmap(void * pDst, const void * pSrc, int xSize, int ySize
 *       _DMA_DrawAlphaBitmap
 */
 static void _DMA_DrawAlphaBitmap(void * pDst, const void * pSrc, int xSize, int ySize, int OffLineSrc, int OffLineDst, int PixelFormat) {
-  DMA2D->CR      = 0x00020000UL | (1 << 9);         // Control Register (Memory to memory with blending of FG and BG and TCIE)
-  DMA2D->FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
-  DMA2D->BGMAR   = (U32)pDst;                       // Background Memory Address Register (Destination address)
-  DMA2D->OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
-  DMA2D->FGOR    = OffLineSrc;                      // Foreground Offset Register (Source line offset)
-  DMA2D->BGOR    = OffLineDst;                      // Background Offset Register (Destination line offset)
-  DMA2D->OOR     = OffLineDst;                      // Output Offset Register (Destination line offset)
-  DMA2D->FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888;       // Foreground PFC Control Register (Defines the input pixel format)
-  DMA2D->BGPFCCR = PixelFormat;                     // Background PFC Control Register (Defines the destination pixel format)
-  DMA2D->OPFCCR  = PixelFormat;                     // Output     PFC Control Register (Defines the output pixel format)
-  DMA2D->NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
-  _DMA_ExecOperation();
+  DMA2D_OP Op = { 0 };
+
+  Op.CR      = 0x00020000UL | (1 << 9);         // Control Register (Memory to memory with blending of FG and BG and TCIE)
+  Op.FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
+  Op.BGMAR   = (U32)pDst;                       // Background Memory Address Register (Destination address)
+  Op.OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
+  Op.FGOR    = OffLineSrc;                      // Foreground Offset Register (Source line offset)
+  Op.BGOR    = OffLineDst;                      // Background Offset Register (Destination line offset)
+  Op.OOR     = OffLineDst;                      // Output Offset Register (Destination line offset)
+  Op.FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888;       // Foreground PFC Control Register (Defines the input pixel format)
+  Op.BGPFCCR = PixelFormat;                     // Background PFC Control Register (Defines the destination pixel format)
+  Op.OPFCCR  = PixelFormat;                     // Output     PFC Control Register (Defines the output pixel format)
+  Op.NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
+  _DMA_ExecOperation(&Op);
 }
 
 #if GUI_MEMDEV_SUPPORT_CUSTOMDRAW
@@ -699,14 +894,16 @@ static void _DMA_DrawAlphaBitmap(void * pDst, const void * pSrc, int xSize, int
 *       _DMA_CopyRGB565
 */
 static void _DMA_CopyRGB565(const void * pSrc, void * pDst, int xSize, int ySize, int OffLineSrc, int OffLineDst) {
-  DMA2D->CR      = 0x00000000UL | (1 << 9);         // Control Register (Memory to memory and TCIE)
-  DMA2D->FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
-  DMA2D->OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
-  DMA2D->FGOR    = OffLineSrc;                      // Foreground Offset Register (Source line offset)
-  DMA2D->OOR     = OffLineDst;                      // Output Offset Register (Destination line offset)
-  DMA2D->FGPFCCR = LTDC_PIXEL_FORMAT_RGB565;         // Foreground PFC Control Register (Defines the input pixel format)
-  DMA2D->NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
-  _DMA_ExecOperation();
+  DMA2D_OP Op = { 0 };
+
+  Op.CR      = 0x00000000UL | (1 << 9);         // Control Register (Memory to memory and TCIE)
+  Op.FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
+  Op.OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
+  Op.FGOR    = OffLineSrc;                      // Foreground Offset Register (Source line offset)
+  Op.OOR     = OffLineDst;                      // Output Offset Register (Destination line offset)
+  Op.FGPFCCR = LTDC_PIXEL_FORMAT_RGB565;         // Foreground PFC Control Register (Defines the input pixel format)
+  Op.NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
+  _DMA_ExecOperation(&Op);
 }
 #endif
 
@@ -715,34 +912,35 @@ static void _DMA_CopyRGB565(const void * pSrc, void * pDst, int xSize, int ySize
 *       _DMA_Fill
 */
 static void _DMA_Fill(int LayerIndex, void * pDst, int xSize, int ySize, int OffLine, U32 ColorIndex) {
+  DMA2D_OP Op = { 0 };
   U32 PixelFormat;
 
   PixelFormat = _GetPixelformat(LayerIndex);
   //
   // Set up mode
   //
-  DMA2D->CR      = 0x00030000UL | (1 << 9);         // Control Register (Register to memory and TCIE)
-  DMA2D->OCOLR   = ColorIndex;                      // Output Color Register (Color to be used)
+  Op.CR      = 0x00030000UL | (1 << 9);         // Control Register (Register to memory and TCIE)
+  Op.OCOLR   = ColorIndex;                      // Output Color Register (Color to be used)
   //
   // Set up pointers
   //
-  DMA2D->OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
+  Op.OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
   //
   // Set up offsets
   //
-  DMA2D->OOR     = (U32)OffLine;                    // Output Offset Register (Destination line offset)
+  Op.OOR     = (U32)OffLine;                    // Output Offset Register (Destination line offset)
   //
   // Set up pixel format
   //
-  DMA2D->OPFCCR  = PixelFormat;                     // Output PFC Control Register (Defines the output pixel format)
+  Op.OPFCCR  = PixelFormat;                     // Output PFC Control Register (Defines the output pixel format)
   //
   // Set up size
   //
-  DMA2D->NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
+  Op.NLR     = (U32)(xSize << 16) | (U16)ySize; // Number of Line Register (Size configuration of area to be transfered)
   //
   // Execute operation
   //
-  _DMA_ExecOperation();
+  _DMA_ExecOperation(&Op);
 }
 
 /*********************************************************************
@@ -750,36 +948,38 @@ static void _DMA_Fill(int LayerIndex, void * pDst, int xSize, int ySize, int Off
 *       _DMA_AlphaBlendingBulk
 */
 static void _DMA_AlphaBlendingBulk(LCD_COLOR * pColorFG, LCD_COLOR * pColorBG, LCD_COLOR * pColorDst, U32 NumItems) {
+  DMA2D_OP Op = { 0 };
+
   //
   // Set up mode
   //
-  DMA2D->CR      = 0x00020000UL | (1 << 9);         // Control Register (Memory to memory with blending of FG and BG and TCIE)
+  Op.CR      = 0x00020000UL | (1 << 9);         // Control Register (Memory to memory with blending of FG and BG and TCIE)
   //
   // Set up pointers
   //
-  DMA2D->FGMAR   = (U32)pColorFG;                   // Foreground Memory Address Register
-  DMA2D->BGMAR   = (U32)pColorBG;                   // Background Memory Address Register
-  DMA2D->OMAR    = (U32)pColorDst;                  // Output Memory Address Register (Destination address)
+  Op.FGMAR   = (U32)pColorFG;                   // Foreground Memory Address Register
+  Op.BGMAR   = (U32)pColorBG;                   // Background Memory Address Register
+  Op.OMAR    = (U32)pColorDst;                  // Output Memory Address Register (Destination address)
   //
   // Set up offsets
   //
-  DMA2D->FGOR    = 0;                               // Foreground Offset Register
-  DMA2D->BGOR    = 0;                               // Background Offset Register
-  DMA2D->OOR     = 0;                               // Output Offset Register
+  Op.FGOR    = 0;                               // Foreground Offset Register
+  Op.BGOR    = 0;                               // Background Offset Register
+  Op.OOR     = 0;                               // Output Offset Register
   //
   // Set up pixel format
   //
-  DMA2D->FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888;      // Foreground PFC Control Register (Defines the FG pixel format)
-  DMA2D->BGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888;      // Background PFC Control Register (Defines the BG pixel format)
-  DMA2D->OPFCCR  = LTDC_PIXEL_FORMAT_ARGB8888;      // Output     PFC Control Register (Defines the output pixel format)
+  Op.FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888;      // Foreground PFC Control Register (Defines the FG pixel format)
+  Op.BGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888;      // Background PFC Control Register (Defines the BG pixel format)
+  Op.OPFCCR  = LTDC_PIXEL_FORMAT_ARGB8888;      // Output     PFC Control Register (Defines the output pixel format)
   //
   // Set up size
   //
-  DMA2D->NLR     = (U32)(NumItems << 16) | 1;       // Number of Line Register (Size configuration of area to be transfered)
+  Op.NLR     = (U32)(NumItems << 16) | 1;       // Number of Line Register (Size configuration of area to be transfered)
   //
   // Execute operation
   //
-  _DMA_ExecOperation();
+  _DMA_ExecOperation(&Op);
 }
 
 /*********************************************************************
@@ -792,40 +992,51 @@ static void _DMA_AlphaBlendingBulk(LCD_COLOR * pColorFG, LCD_COLOR * pColorBG, L
 *   foreground color should be used unchanged.
 */
 static LCD_COLOR _DMA_MixColors(LCD_COLOR Color, LCD_COLOR BkColor, U8 Intens) {
+  DMA2D_OP Op = { 0 };
   U32 ColorDst;
+  U32 * pMix;
 
 #if (GUI_USE_ARGB == 0)
   Color   ^= 0xFF000000;
   BkColor ^= 0xFF000000;
 #endif
+  //
+  // Use the conversion buffer for the operands. It is located in DTCM,
+  // which is not cached, so neither the operands nor the result need cache
+  // maintenance, unlike a buffer on the stack of the calling task.
+  //
+  pMix    = (U32 *)_aBuffer;
+  pMix[0] = Color;
+  pMix[1] = BkColor;
   //
   // Set up mode
   //
-  DMA2D->CR      = 0x00020000UL | (1 << 9);       // Control Register (Memory to memory with blending of FG and BG and TCIE)
+  Op.CR      = 0x00020000UL | (1 << 9);       // Control Register (Memory to memory with blending of FG and BG and TCIE)
   //
   // Set up pointers
   //
-  DMA2D->FGMAR   = (U32)&Color;                   // Foreground Memory Address Register
-  DMA2D->BGMAR   = (U32)&BkColor;                 // Background Memory Address Register
-  DMA2D->OMAR    = (U32)&ColorDst;                // Output Memory Address Register (Destination address)
+  Op.FGMAR   = (U32)&pMix[0];                 // Foreground Memory Address Register
+  Op.BGMAR   = (U32)&pMix[1];                 // Background Memory Address Register
+  Op.OMAR    = (U32)&pMix[2];                 // Output Memory Address Register (Destination address)
   //
   // Set up pixel format
   //
-  DMA2D->FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
-                 | (1UL << 16)
-                 | ((U32)Intens << 24);
-  DMA2D->BGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
-                 | (0UL << 16)
-                 | ((U32)(255 - Intens) << 24);
-  DMA2D->OPFCCR  = LTDC_PIXEL_FORMAT_ARGB8888;
+  Op.FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
+             | (1UL << 16)
+             | ((U32)Intens << 24);
+  Op.BGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
+             | (0UL << 16)
+             | ((U32)(255 - Intens) << 24);
+  Op.OPFCCR  = LTDC_PIXEL_FORMAT_ARGB8888;
   //
   // Set up size
   //
-  DMA2D->NLR     = (U32)(1 << 16) | 1;              // Number of Line Register (Size configuration of area to be transfered)
+  Op.NLR     = (U32)(1 << 16) | 1;              // Number of Line Register (Size configuration of area to be transfered)
   //
   // Execute operation
   //
-  _DMA_ExecOperation();
+  _DMA_ExecOperation(&Op);
+  ColorDst = pMix[2];
 
 #if (GUI_USE_ARGB == 0)
   ColorDst ^= 0xFF000000;
@@ -836,36 +1047,41 @@ static LCD_COLOR _DMA_MixColors(LCD_COLOR Color, LCD_COLOR BkColor, U8 Intens) {
 /*********************************************************************
 *
 *       _DMA_MixColorsBulk
+*
+* Purpose:
+*   Queues the operation only, the caller waits with _DMA_Wait().
 */
 static void _DMA_MixColorsBulk(LCD_COLOR * pColorFG, LCD_COLOR * pColorBG, LCD_COLOR * pColorDst, U8 Intens, U32 NumItems) {
+  DMA2D_OP Op = { 0 };
+
   //
   // Set up mode
   //
-  DMA2D->CR      = 0x00020000UL | (1 << 9);         // Control Register (Memory to memory with blending of FG and BG and TCIE)
+  Op.CR      = 0x00020000UL | (1 << 9);         // Control Register (Memory to memory with blending of FG and BG and TCIE)
   //
   // Set up pointers
   //
-  DMA2D->FGMAR   = (U32)pColorFG;                   // Foreground Memory Address Register
-  DMA2D->BGMAR   = (U32)pColorBG;                   // Background Memory Address Register
-  DMA2D->OMAR    = (U32)pColorDst;                  // Output Memory Address Register (Destination address)
+  Op.FGMAR   = (U32)pColorFG;                   // Foreground Memory Address Register
+  Op.BGMAR   = (U32)pColorBG;                   // Background Memory Address Register
+  Op.OMAR    = (U32)pColorDst;                  // Output Memory Address Register (Destination address)
   //
   // Set up pixel format
   //
-  DMA2D->FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
-                 | (1UL << 16)
-                 | ((U32)Intens << 24);
-  DMA2D->BGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
-                 | (0UL << 16)
-                 | ((U32)(255 - Intens) << 24);
-  DMA2D->OPFCCR  = LTDC_PIXEL_FORMAT_ARGB8888;
+  Op.FGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
+             | (1UL << 16)
+             | ((U32)Intens << 24);
+  Op.BGPFCCR = LTDC_PIXEL_FORMAT_ARGB8888
+             | (0UL << 16)
+             | ((U32)(255 - Intens) << 24);
+  Op.OPFCCR  = LTDC_PIXEL_FORMAT_ARGB8888;
   //
   // Set up size
   //
-  DMA2D->NLR     = (U32)(NumItems << 16) | 1;              // Number of Line Register (Size configuration of area to be transfered)
+  Op.NLR     = (U32)(NumItems << 16) | 1;              // Number of Line Register (Size configuration of area to be transfered)
   //
-  // Execute operation
+  // Queue operation
   //
-  _DMA_ExecOperation();
+  _DMA_Submit(&Op);
 }
 
 /*********************************************************************
@@ -873,33 +1089,35 @@ static void _DMA_MixColorsBulk(LCD_COLOR * pColorFG, LCD_COLOR * pColorBG, LCD_C
 *       _DMA_ConvertColor
 */
 static void _DMA_ConvertColor(void * pSrc, void * pDst,  U32 PixelFormatSrc, U32 PixelFormatDst, U32 NumItems) {
+  DMA2D_OP Op = { 0 };
+
   //
   // Set up mode
   //
-  DMA2D->CR      = 0x00010000UL | (1 << 9);         // Control Register (Memory to memory with pixel format conversion and TCIE)
+  Op.CR      = 0x00010000UL | (1 << 9);         // Control Register (Memory to memory with pixel format conversion and TCIE)
   //
   // Set up pointers
   //
-  DMA2D->FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
-  DMA2D->OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
+  Op.FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
+  Op.OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
   //
   // Set up offsets
   //
-  DMA2D->FGOR    = 0;                               // Foreground Offset Register (Source line offset)
-  DMA2D->OOR     = 0;                               // Output Offset Register (Destination line offset)
+  Op.FGOR    = 0;                               // Foreground Offset Register (Source line offset)
+  Op.OOR     = 0;                               // Output Offset Register (Destination line offset)
   //
   // Set up pixel format
   //
-  DMA2D->FGPFCCR = PixelFormatSrc;                  // Foreground PFC Control Register (Defines the input pixel format)
-  DMA2D->OPFCCR  = PixelFormatDst;                  // Output PFC Control Register (Defines the output pixel format)
+  Op.FGPFCCR = PixelFormatSrc;                  // Foreground PFC Control Register (Defines the input pixel format)
+  Op.OPFCCR  = PixelFormatDst;                  // Output PFC Control Register (Defines the output pixel format)
   //
   // Set up size
   //
-  DMA2D->NLR     = (U32)(NumItems << 16) | 1;       // Number of Line Register (Size configuration of area to be transfered)
+  Op.NLR     = (U32)(NumItems << 16) | 1;       // Number of Line Register (Size configuration of area to be transfered)
   //
   // Execute operation
   //
-  _DMA_ExecOperation();
+  _DMA_ExecOperation(&Op);
 }
 
 /*********************************************************************
@@ -907,33 +1125,35 @@ static void _DMA_ConvertColor(void * pSrc, void * pDst,  U32 PixelFormatSrc, U32
 *       _DMA_DrawBitmapL8
 */
 static void _DMA_DrawBitmapL8(void * pSrc, void * pDst,  U32 OffSrc, U32 OffDst, U32 PixelFormatDst, U32 xSize, U32 ySize) {
+  DMA2D_OP Op = { 0 };
+
   //
   // Set up mode
   //
-  DMA2D->CR      = 0x00010000UL | (1 << 9);         // Control Register (Memory to memory with pixel format conversion and TCIE)
+  Op.CR      = 0x00010000UL | (1 << 9);         // Control Register (Memory to memory with pixel format conversion and TCIE)
   //
   // Set up pointers
   //
-  DMA2D->FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
-  DMA2D->OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
+  Op.FGMAR   = (U32)pSrc;                       // Foreground Memory Address Register (Source address)
+  Op.OMAR    = (U32)pDst;                       // Output Memory Address Register (Destination address)
   //
   // Set up offsets
   //
-  DMA2D->FGOR    = OffSrc;                          // Foreground Offset Register (Source line offset)
-  DMA2D->OOR     = OffDst;                          // Output Offset Register (Destination line offset)
+  Op.FGOR    = OffSrc;                          // Foreground Offset Register (Source line offset)
+  Op.OOR     = OffDst;                          // Output Offset Register (Destination line offset)
   //
   // Set up pixel format
   //
-  DMA2D->FGPFCCR = LTDC_PIXEL_FORMAT_L8;            // Foreground PFC Control Register (Defines the input pixel format)
-  DMA2D->OPFCCR  = PixelFormatDst;                  // Output PFC Control Register (Defines the output pixel format)
+  Op.FGPFCCR = LTDC_PIXEL_FORMAT_L8;            // Foreground PFC Control Register (Defines the input pixel format)
+  Op.OPFCCR  = PixelFormatDst;                  // Output PFC Control Register (Defines the output pixel format)
   //
   // Set up size
   //
-  DMA2D->NLR     = (U32)(xSize << 16) | ySize;      // Number of Line Register (Size configuration of area to be transfered)
+  Op.NLR     = (U32)(xSize << 16) | ySize;      // Number of Line Register (Size configuration of area to be transfered)
   //
   // Execute operation
   //
-  _DMA_ExecOperation();
+  _DMA_ExecOperation(&Op);
 }
 
 /*********************************************************************
@@ -941,6 +1161,7 @@ static void _DMA_DrawBitmapL8(void * pSrc, void * pDst,  U32 OffSrc, U32 OffDst,
 *       _DMA_DrawBitmapA4
 */
 static int _DMA_DrawBitmapA4(void * pSrc, void * pDst,  U32 OffSrc, U32 OffDst, U32 PixelFormatDst, U32 xSize, U32 ySize) {
+  DMA2D_OP Op = { 0 };
   U8 * pRD;
   U8 * pWR;
   U32 NumBytes, Color, Index;
@@ -968,31 +1189,31 @@ static int _DMA_DrawBitmapA4(void * pSrc, void * pDst,  U32 OffSrc, U32 OffDst,
   //
   // Set up operation mode
   //
-  DMA2D->CR = 0x00020000UL | (1 << 9);
+  Op.CR = 0x00020000UL | (1 << 9);
   //
   // Set up source
   //
 #if (GUI_USE_ARGB == 0)
-  DMA2D->FGCOLR  = ((Color & 0xFF) << 16)  // Red
-                 |  (Color & 0xFF00)       // Green
-                 | ((Color >> 16) & 0xFF); // Blue
+  Op.FGCOLR  = ((Color & 0xFF) << 16)  // Red
+             |  (Color & 0xFF00)       // Green
+             | ((Color >> 16) & 0xFF); // Blue
 #else
-  DMA2D->FGCOLR  = Color;
+  Op.FGCOLR  = Color;
 #endif
-  DMA2D->FGMAR   = (U32)_aBuffer;
-  DMA2D->FGOR    = 0;
-  DMA2D->FGPFCCR = 0xA;                    // A4 bitmap
-  DMA2D->NLR     = (U32)((xSize + OffSrc) << 16) | ySize;
-  DMA2D->BGMAR   = (U32)pDst;
-  DMA2D->BGOR    = OffDst - OffSrc;
-  DMA2D->BGPFCCR = PixelFormatDst;
-  DMA2D->OMAR    = DMA2D->BGMAR;
-  DMA2D->OOR     = DMA2D->BGOR;
-  DMA2D->OPFCCR  = DMA2D->BGPFCCR;
+  Op.FGMAR   = (U32)_aBuffer;
+  Op.FGOR    = 0;
+  Op.FGPFCCR = 0xA;                    // A4 bitmap
+  Op.NLR     = (U32)((xSize + OffSrc) << 16) | ySize;
+  Op.BGMAR   = (U32)pDst;
+  Op.BGOR    = OffDst - OffSrc;
+  Op.BGPFCCR = PixelFormatDst;
+  Op.OMAR    = Op.BGMAR;
+  Op.OOR     = Op.BGOR;
+  Op.OPFCCR  = Op.BGPFCCR;
   //
   // Execute operation
   //
-  _DMA_ExecOperation();
+  _DMA_ExecOperation(&Op);
   return 0;
 }
 
@@ -1001,6 +1222,16 @@ static int _DMA_DrawBitmapA4(void * pSrc, void * pDst,  U32 OffSrc, U32 OffDst,
 *       _DMA_LoadLUT
 */
 static void _DMA_LoadLUT(LCD_COLOR * pColor, U32 NumItems) {
+  U32 Start, Size;
+
+  //
+  // The CLUT can not be loaded while a transfer uses it
+  //
+  _DMA_Wait();
+  Size = _DMA_GetArea((U32)pColor, LTDC_PIXEL_FORMAT_ARGB8888, (NumItems << 16) | 1, 0, &Start);
+  if (Size) {
+    SCB_CleanDCache_by_Addr((uint32_t *)Start, (int32_t)Size);
+  }
   DMA2D->FGCMAR  = (U32)pColor;                     // Foreground CLUT Memory Address Register
   //
   // Foreground PFC Control Register
@@ -1234,23 +1465,31 @@ static void _DMA_AlphaBlending(LCD_COLOR * pColorFG, LCD_COLOR * pColorBG, LCD_C
 *   transparent the color array needs to be converted after DMA2D has been used.
 */
 static void _DMA_Index2ColorBulk(void * pIndex, LCD_COLOR * pColor, U32 NumItems, U8 SizeOfIndex, U32 PixelFormat) {
-  GUI_USE_PARA(SizeOfIndex);
+  U32 NumBytes, Num;
 
+  GUI_USE_PARA(SizeOfIndex);
+  NumBytes = _aBitsPerPixel[PixelFormat] >> 3;     // Bytes per index value
+  while (NumItems) {
+    Num = (NumItems > DMA2D_BUFFER_ITEMS) ? DMA2D_BUFFER_ITEMS : NumItems;
 #if (GUI_USE_ARGB)
-  //
-  // Use DMA2D for the conversion
-  //
-  _DMA_ConvertColor(pIndex, pColor, PixelFormat, LTDC_PIXEL_FORMAT_ARGB8888, NumItems);
+    //
+    // Use DMA2D for the conversion
+    //
+    _DMA_ConvertColor(pIndex, pColor, PixelFormat, LTDC_PIXEL_FORMAT_ARGB8888, Num);
 #else
-  //
-  // Use DMA2D for the conversion
-  //
-  _DMA_ConvertColor(pIndex, pColor, PixelFormat, LTDC_PIXEL_FORMAT_ARGB8888, NumItems);
-  //
-  // Convert colors from ARGB to ABGR and invert alpha values
-  //
-  _InvertAlpha_SwapRB_MOD(pColor, NumItems);
+    //
+    // Use DMA2D for the conversion
+    //
+    _DMA_ConvertColor(pIndex, pColor, PixelFormat, LTDC_PIXEL_FORMAT_ARGB8888, Num);
+    //
+    // Convert colors from ARGB to ABGR and invert alpha values
+    //
+    _InvertAlpha_SwapRB_MOD(pColor, Num);
 #endif
+    pIndex    = (U8 *)pIndex + Num * NumBytes;
+    pColor   += Num;
+    NumItems -= Num;
+  }
 }
 
 /*********************************************************************
@@ -1264,23 +1503,34 @@ static void _DMA_Index2ColorBulk(void * pIndex, LCD_COLOR * pColor, U32 NumItems
 *   transparent the given color array needs to be converted before DMA2D can be used.
 */
 static void _DMA_Color2IndexBulk(LCD_COLOR * pColor, void * pIndex, U32 NumItems, U8 SizeOfIndex, U32 PixelFormat) {
-  GUI_USE_PARA(SizeOfIndex);
+  U32 NumBytes, Num;
 
+  GUI_USE_PARA(SizeOfIndex);
+  NumBytes = _aBitsPerPixel[PixelFormat] >> 3;     // Bytes per index value
+  while (NumItems) {
+    //
+    // _pBuffer_DMA2D holds DMA2D_BUFFER_ITEMS colors
+    //
+    Num = (NumItems > DMA2D_BUFFER_ITEMS) ? DMA2D_BUFFER_ITEMS : NumItems;
 #if (GUI_USE_ARGB)
-  //
-  // Use DMA2D for the conversion
-  //
-  _DMA_ConvertColor(pColor, pIndex, LTDC_PIXEL_FORMAT_ARGB8888, PixelFormat, NumItems);
+    //
+    // Use DMA2D for the conversion
+    //
+    _DMA_ConvertColor(pColor, pIndex, LTDC_PIXEL_FORMAT_ARGB8888, PixelFormat, Num);
 #else
-  //
-  // Convert colors from ABGR to ARGB and invert alpha values
-  //
-  _InvertAlpha_SwapRB_CPY(pColor, _pBuffer_DMA2D, NumItems);
-  //
-  // Use DMA2D for the conversion
-  //
-  _DMA_ConvertColor(_pBuffer_DMA2D, pIndex, LTDC_PIXEL_FORMAT_ARGB8888, PixelFormat, NumItems);
+    //
+    // Convert colors from ABGR to ARGB and invert alpha values
+    //
+    _InvertAlpha_SwapRB_CPY(pColor, _pBuffer_DMA2D, Num);
+    //
+    // Use DMA2D for the conversion
+    //
+    _DMA_ConvertColor(_pBuffer_DMA2D, pIndex, LTDC_PIXEL_FORMAT_ARGB8888, PixelFormat, Num);
 #endif
+    pColor   += Num;
+    pIndex    = (U8 *)pIndex + Num * NumBytes;
+    NumItems -= Num;
+  }
 }
 
 /*********************************************************************
@@ -1302,6 +1552,10 @@ static void _LCD_MixColorsBulk(U32 * pFG, U32 * pBG, U32 * pDst, unsigned OffFG,
     pBG  += xSize + OffBG;
     pDst += xSize + OffDest;
   }
+  //
+  // Lines are queued back to back, wait once for all of them
+  //
+  _DMA_Wait();
 #else
   unsigned int y;
 
@@ -1317,6 +1571,7 @@ static void _LCD_MixColorsBulk(U32 * pFG, U32 * pBG, U32 * pDst, unsigned OffFG,
     // Use DMA2D for mixing up
     //
     _DMA_MixColorsBulk(_pBuffer_FG, _pBuffer_BG, pDst, Intens, xSize);
+    _DMA_Wait();
     //
     // Invert alpha values
     //
@@ -1545,6 +1800,7 @@ static void _LCD_CopyRect(int LayerIndex, int x0, int y0, int x1, int y1, int xS
   AddrDst = _aAddr[LayerIndex] + BufferSize * _aBufferIndex[LayerIndex] + (y1 * _axSize[LayerIndex] + x1) * _aBytesPerPixels[LayerIndex];
   OffLine = _axSize[LayerIndex] - xSize;
   _DMA_Copy(LayerIndex, (void *)AddrSrc, (void *)AddrDst, xSize, ySize, OffLine, OffLine);
+  VNC_MARK(LayerIndex, x1, y1, x1 + xSize - 1, y1 + ySize - 1);
 }
 
 /*********************************************************************
@@ -1559,12 +1815,14 @@ static void _LCD_FillRect(int LayerIndex, int x0, int y0, int x1, int y1, U32 Pi
     LCD_SetDevFunc(LayerIndex, LCD_DEVFUNC_FILLRECT, NULL);
     LCD_FillRect(x0, y0, x1, y1);
     LCD_SetDevFunc(LayerIndex, LCD_DEVFUNC_FILLRECT, (void(*)(void))_LCD_FillRect);
+    VNC_MARK(LayerIndex, x0, y0, x1, y1);
   } else {
     xSize = x1 - x0 + 1;
     ySize = y1 - y0 + 1;
     BufferSize = _GetBufferSize(LayerIndex);
     AddrDst = _aAddr[LayerIndex] + BufferSize * (U32)_aBufferIndex[LayerIndex] + (U32)(y0 * _axSize[LayerIndex] + x0) * (U32)_aBytesPerPixels[LayerIndex];
     _DMA_Fill(LayerIndex, (void *)AddrDst, xSize, ySize, _axSize[LayerIndex] - xSize, PixelIndex);
+    VNC_MARK(LayerIndex, x0, y0, x1, y1);
   }
 }
 
@@ -1583,6 +1841,7 @@ static void _LCD_DrawBitmapM565(int LayerIndex, int x, int y, const void * p, in
   OffLineSrc = (BytesPerLine / 2) - xSize;
   OffLineDst = _axSize[LayerIndex] - xSize;
   _DMA_DrawBitmap((void *)AddrDst, p, xSize, ySize, OffLineSrc, OffLineDst, LTDC_PIXEL_FORMAT_RGB565, PixelFormatDst);
+  VNC_MARK(LayerIndex, x, y, x + xSize - 1, y + ySize - 1);
 }
 
 /*********************************************************************
@@ -1600,6 +1859,7 @@ static void _LCD_DrawBitmapAlpha(int LayerIndex, int x, int y, const void * p, i
   OffLineSrc = (BytesPerLine / 4) - xSize;
   OffLineDst = _axSize[LayerIndex] - xSize;
   _DMA_DrawAlphaBitmap((void *)AddrDst, p, xSize, ySize, OffLineSrc, OffLineDst, PixelFormat);
+  VNC_MARK(LayerIndex, x, y, x + xSize - 1, y + ySize - 1);
 }
 
 /*********************************************************************
@@ -1615,6 +1875,7 @@ static void _LCD_DrawBitmap32bpp(int LayerIndex, int x, int y, U16 const * p, in
   OffLineSrc = (BytesPerLine / 4) - xSize;
   OffLineDst = _axSize[LayerIndex] - xSize;
   _DMA_Copy(LayerIndex, (void *)p, (void *)AddrDst, xSize, ySize, OffLineSrc, OffLineDst);
+  VNC_MARK(LayerIndex, x, y, x + xSize - 1, y + ySize - 1);
 }
 
 /*********************************************************************
@@ -1630,6 +1891,7 @@ static void _LCD_DrawBitmap16bpp(int LayerIndex, int x, int y, U16 const * p, in
   OffLineSrc = (BytesPerLine / 2) - xSize;
   OffLineDst = _axSize[LayerIndex] - xSize;
   _DMA_Copy(LayerIndex, (void *)(U32)p, (void *)AddrDst, xSize, ySize, OffLineSrc, OffLineDst);
+  VNC_MARK(LayerIndex, x, y, x + xSize - 1, y + ySize - 1);
 }
 
 /*********************************************************************
@@ -1647,6 +1909,7 @@ static void _LCD_DrawBitmap8bpp(int LayerIndex, int x, int y, U8 const * p, int
   OffLineDst = _axSize[LayerIndex] - xSize;
   PixelFormat = _GetPixelformat(LayerIndex);
   _DMA_DrawBitmapL8((void *)(U32)p, (void *)AddrDst, (U32)OffLineSrc, (U32)OffLineDst, PixelFormat, (U32)xSize, (U32)ySize);
+  VNC_MARK(LayerIndex, x, y, x + xSize - 1, y + ySize - 1);
 }
 
 /*********************************************************************
@@ -1681,8 +1944,8 @@ static int _LCD_DrawBitmap4bpp(int LayerIndex, int x, int y, U8 const * p, int x
   AddrDst = _aAddr[LayerIndex] + BufferSize * _aBufferIndex[LayerIndex] + (y * _axSize[LayerIndex] + x) * _aBytesPerPixels[LayerIndex];
   OffLineSrc = (BytesPerLine * 2) - xSize;
   OffLineDst = _axSize[LayerIndex] - xSize;
-  
-  return _DMA_DrawBitmapA4((void *)p, (void *)AddrDst, OffLineSrc, OffLineDst, PixelFormat, xSize, ySize);;
+  VNC_MARK(LayerIndex, x, y, x + xSize - 1, y + ySize - 1);
+  return _DMA_DrawBitmapA4((void *)p, (void *)AddrDst, OffLineSrc, OffLineDst, PixelFormat, xSize, ySize);
 }
 
 /*********************************************************************
@@ -1921,12 +2184,28 @@ static void _LCD_SetChroma(int LayerIndex, LCD_COLOR ChromaMin, LCD_COLOR Chroma
 *       DMA2D_IRQHandler
 *
 * Purpose:
-*   Transfer-complete-interrupt of DMA2D
+*   Transfer-complete-interrupt of DMA2D. Finishes the current operation
+*   of the queue and starts the next one. A transfer error also ends the
+*   operation, so the queue does not stall.
 */
 extern 
 void DMA2D_IRQHandler(void);
 void DMA2D_IRQHandler(void) {
-  __HAL_DMA2D_CLEAR_FLAG(&DMA2D_Handle, DMA2D_FLAG_TC);
+  DMA2D_OP * pOp;
+
+  __HAL_DMA2D_CLEAR_FLAG(&DMA2D_Handle, DMA2D_FLAG_TC | DMA2D_FLAG_TE);
+  if (_QueueRd == _QueueWr) {
+    return;
+  }
+  pOp = &_aQueue[_QueueRd & (DMA2D_QUEUE_SIZE - 1)];
+  Prof_End(_DMA_ProfSite(pOp), _DmaStart);
+  AppEvr_Record(EVR_DMA2D_COMPLETE, (pOp->CR & DMA2D_CR_MODE) >> 16, _QueueRd);
+  if (pOp->InvSize) {
+    SCB_InvalidateDCache_by_Addr((uint32_t *)pOp->InvAddr, (int32_t)pOp->InvSize);
+  }
+  if (++_QueueRd != _QueueWr) {
+    _DMA_Start(&_aQueue[_QueueRd & (DMA2D_QUEUE_SIZE - 1)]);
+  }
 }
 
 /*********************************************************************
@@ -1934,12 +2213,15 @@ void DMA2D_IRQHandler(void) {
 *       HAL_LTDC_LineEvenCallback
 *
 * Purpose:
-*   Line Event callback for managing multiple buffering
+*   Line Event callback for managing multiple buffering.
+*   The line event is programmed to line 0 (vertical sync), so a
+*   pending buffer is switched in the blanking period without tearing.
 */
 void HAL_LTDC_LineEvenCallback(LTDC_HandleTypeDef *hltdc) {
   U32 Addr;
-  int i;
+  int i, Confirmed;
 
+  Confirmed = 0;
   for (i = 0; i < GUI_NUM_LAYERS; i++) {
     if (_aPendingBuffer[i] >= 0) {
       //
@@ -1958,12 +2240,30 @@ void HAL_LTDC_LineEvenCallback(LTDC_HandleTypeDef *hltdc) {
       // Tell emWin that buffer is used
       //
       GUI_MULTIBUF_ConfirmEx(i, _aPendingBuffer[i]);
+#if USE_VNC
+      //
+      // The areas drawn into the buffer are visible now
+      //
+      if (i == 0) {
+        VNC_Server_Frame(_aPendingBuffer[i], (const void *)Addr);
+      }
+#endif
+      if (i == 0) {
+        Prof_Mark(PROF_FRAME);
+      }
       //
       // Clear pending buffer flag of layer
       //
       _aPendingBuffer[i] = -1;
+      Confirmed = 1;
     }
   }
+  //
+  // Wake the GUI task in case it waits for a free buffer
+  //
+  if (Confirmed) {
+    GUI_SignalEvent();
+  }
 
   HAL_LTDC_ProgramLineEvent(hltdc, 0);
 }
@@ -2014,6 +2314,11 @@ int LCD_X_DisplayDriver(unsigned LayerIndex, unsigned Cmd, void * pData) {
       // Called during the initialization process in order to set up the display controller and put it into operation.
       //
       _LCD_InitController((int)LayerIndex);
+#if USE_VNC
+      if (LayerIndex == 0) {
+        VNC_Server_Frame(0, (const void *)_aAddr[0]);  // Buffer 0 is shown first
+      }
+#endif
       break;
     }
     case LCD_X_SETORG: {
@@ -2032,12 +2337,12 @@ int LCD_X_DisplayDriver(unsigned LayerIndex, unsigned Cmd, void * pData) {
       //
       LCD_X_SHOWBUFFER_INFO * p;
 
+      // Only mark the buffer as pending; the LTDC line event switches the
+      // frame buffer in the vertical blanking and confirms it to emWin.
+      // With 3 buffers drawing continues in the third buffer meanwhile.
+      //
       p = (LCD_X_SHOWBUFFER_INFO *)pData;
-#if (NUM_BUFFERS == 2)
-      _SwitchBuffersOnVSYNC(p->Index, LayerIndex);
-#else
       _aPendingBuffer[LayerIndex] = p->Index;
-#endif
       break;
     }
     case LCD_X_SETLUTENTRY: {
@@ -2234,7 +2539,7 @@ void LCD_X_Config(void) {
   // Set up custom color conversion using DMA2D, works only for direct color modes because of missing LUT for DMA2D destination
   //
   GUICC_M1555I_SetCustColorConv(_Color2IndexBulk_M1555I_DMA2D, _Index2ColorBulk_M1555I_DMA2D); // Set up custom bulk color conversion using DMA2D for ARGB1555
-//  GUICC_M565_SetCustColorConv  (_Color2IndexBulk_M565_DMA2D,   _Index2ColorBulk_M565_DMA2D);   // Set up custom bulk color conversion using DMA2D for RGB565 (does not speed up conversion, default method is slightly faster!)
+  GUICC_M565_SetCustColorConv  (_Color2IndexBulk_M565_DMA2D,   _Index2ColorBulk_M565_DMA2D);   // Set up custom bulk color conversion using DMA2D for RGB565 (format of layer 0)
   GUICC_M4444I_SetCustColorConv(_Color2IndexBulk_M4444I_DMA2D, _Index2ColorBulk_M4444I_DMA2D); // Set up custom bulk color conversion using DMA2D for ARGB4444
   GUICC_M888_SetCustColorConv  (_Color2IndexBulk_M888_DMA2D,   _Index2ColorBulk_M888_DMA2D);   // Set up custom bulk color conversion using DMA2D for RGB888
   GUICC_M8888I_SetCustColorConv(_Color2IndexBulk_M8888I_DMA2D, _Index2ColorBulk_M8888I_DMA2D); // Set up custom bulk color conversion using DMA2D for ARGB8888
@@ -31,6 +31,7 @@
 
 /* Keil.MDK-Plus::USB:Device:CDC:6.16.1 */
 #define RTE_USB_Device_CDC_0            /* USB Device CDC instance 0 */
+#define RTE_USB_Device_CDC_1            /* USB Device CDC instance 1 */
 
 /* Keil.MDK-Pro::Network:CORE:IPv4/IPv6 Debug:7.18.0 */
 #define RTE_Network_Core                /* Network Core */
@@ -39,6 +40,7 @@
           #define RTE_Network_Debug               /* Network Debug Version */
 /* Keil.MDK-Pro::Network:Interface:ETH:7.18.0 */
 #define RTE_Network_Interface_ETH_0     /* Network Interface ETH 0 */
+#define RTE_Network_Interface_ETH_1     /* Network Interface ETH 1 */
 
 /* Keil.MDK-Pro::Network:Socket:BSD:7.18.0 */
 #define RTE_Network_Socket_BSD          /* Network Socket BSD */
@@ -0,0 +1,91 @@
+/*------------------------------------------------------------------------------
+ * Name:    RingBuf.h
+ * Purpose: Lock-free single-producer/single-consumer byte ring buffer
+ *----------------------------------------------------------------------------*/
+/*
+ * One context writes (RingBuf_Write), one other context reads
+ * (RingBuf_Peek/RingBuf_Consume); no locking is needed between them.
+ * Head and tail are free running indices, the size must be a power of 2.
+ * The memory barrier orders the data copy against the index update so
+ * the other side never sees an index before the data it covers.
+ */
+
+#ifndef RINGBUF_H_
+#define RINGBUF_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef RINGBUF_DMB
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+#define RINGBUF_DMB()           __DMB()
+#endif
+
+typedef struct {
+  uint8_t          *buf;
+  uint32_t          size;       // Buffer size (power of 2)
+  volatile uint32_t head;       // Write index, only changed by producer
+  volatile uint32_t tail;       // Read index, only changed by consumer
+} RingBuf;
+
+static inline void RingBuf_Init (RingBuf *rb, uint8_t *buf, uint32_t size) {
+  rb->buf  = buf;
+  rb->size = size;
+  rb->head = 0U;
+  rb->tail = 0U;
+}
+
+// Number of bytes available for reading
+static inline uint32_t RingBuf_Count (const RingBuf *rb) {
+  return rb->head - rb->tail;
+}
+
+// Number of bytes available for writing
+static inline uint32_t RingBuf_Free (const RingBuf *rb) {
+  return rb->size - (rb->head - rb->tail);
+}
+
+// Producer: copy up to len bytes into the ring, returns bytes written.
+static inline uint32_t RingBuf_Write (RingBuf *rb, const void *data, uint32_t len) {
+  uint32_t head, idx, n, free;
+
+  head = rb->head;
+  free = rb->size - (head - rb->tail);
+  if (len > free) {
+    len = free;
+  }
+  idx = head & (rb->size - 1U);
+  n   = rb->size - idx;
+  if (n > len) {
+    n = len;
+  }
+  memcpy(&rb->buf[idx], data, n);
+  memcpy(&rb->buf[0], (const uint8_t *)data + n, len - n);
+  RINGBUF_DMB();
+  rb->head = head + len;
+  return len;
+}
+
+// Consumer: get the contiguous readable block, returns its length.
+static inline uint32_t RingBuf_Peek (const RingBuf *rb, uint8_t **data) {
+  uint32_t tail, idx, cnt;
+
+  tail = rb->tail;
+  cnt  = rb->head - tail;
+  RINGBUF_DMB();
+  idx  = tail & (rb->size - 1U);
+  if (cnt > (rb->size - idx)) {
+    cnt = rb->size - idx;
+  }
+  *data = &rb->buf[idx];
+  return cnt;
+}
+
+// Consumer: release len bytes obtained by RingBuf_Peek.
+static inline void RingBuf_Consume (RingBuf *rb, uint32_t len) {
+  RINGBUF_DMB();
+  rb->tail += len;
+}
+
+#endif /* RINGBUF_H_ */
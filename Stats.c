@@ -0,0 +1,245 @@
+/*------------------------------------------------------------------------------
+ * Name:    Stats.c
+ * Purpose: Runtime statistics: CPU load, stacks, queues and drop counters
+ *----------------------------------------------------------------------------*/
+/*
+ * The counters stay in the modules that own them (AT_Exec_GetStats,
+ * CDC0_ACM_GetUartStats, VNC_Server_GetStats, ...); Stats_GetCounters
+ * collects them into one record for AT+STATS, the binary protocol and the
+ * telemetry header. Only the CPU load and the emWin heap usage are
+ * measured here.
+ *
+ * CPU load: this module replaces the weak idle thread of RTX_Config.c.
+ * The idle loop reads the DWT cycle counter and adds the cycles since its
+ * last read when the gap is below STATS_IDLE_GAP; a longer gap means the
+ * idle thread was preempted by an interrupt or a thread, and is busy
+ * time. Every STATS_WINDOW_MS the idle share of the window gives the load.
+ * The loop costs a few cycles per sample and only runs when nothing else
+ * does, so the measurement stays enabled in Release.
+ *
+ * Boot milestones are kernel tick counts, recorded once by the boot
+ * stages in GUI_VNC.c, the GUI thread and the network callbacks.
+ *
+ * Stack usage needs OS_STACK_WATERMARK (RTX_Config.h): RTX fills each
+ * stack with a pattern at thread creation and osThreadGetStackSpace finds
+ * the lowest overwritten word. That search scans the stacks, so
+ * Stats_GetCounters keeps the result of the last walk for STATS_STACK_MS.
+ */
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+#include "cmsis_os2.h"
+
+#include "AT_Executor.h"
+#include "AT_TcpServer.h"
+#include "AdcAcq.h"
+#include "AdcStream.h"
+#include "Telem.h"
+#include "USBD_User_CDC_ACM_UART_0.h"
+#include "VNC_Server.h"
+#include "Stats.h"
+
+static volatile uint32_t stats_load;    // [0.1 %]
+static volatile uint32_t stats_peak;
+static volatile uint32_t stats_heap_used;
+static volatile uint32_t stats_heap_free;
+static volatile uint32_t stats_heap_peak;
+static volatile uint32_t stats_boot_mask;
+static uint32_t          stats_boot_ms[STATS_BOOT_NUM];
+static uint32_t          stats_stack_tick;      // Time of the last stack walk
+static uint32_t          stats_stack_free;      // Result of the last walk
+static uint32_t          stats_stack_threads;
+static uint32_t          stats_stack_valid;
+
+static const char * const stats_boot_name[STATS_BOOT_NUM] = {
+  "MAIN",
+  "FRAME",
+  "DIALOG",
+  "NET",
+  "USB",
+  "USB_CONFIG",
+  "LINK",
+  "DHCP",
+  "VNC"
+};
+
+int Stats_Initialize (void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR          = 0xC5ACCE55U;      // Unlock the DWT (Cortex-M7)
+  DWT->CYCCNT       = 0U;
+  DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+  return ((DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk) == 0U) ? 0 : -1;
+}
+
+// OS Idle Thread: measures the idle share of each window
+__NO_RETURN void osRtxIdleThread (void *argument) {
+  uint32_t start, last, now, gap, idle, window, load;
+
+  (void)argument;
+
+  idle  = 0U;
+  start = DWT->CYCCNT;
+  last  = start;
+  for (;;) {
+    now  = DWT->CYCCNT;
+    gap  = now - last;
+    last = now;
+    if (gap < STATS_IDLE_GAP) {
+      idle += gap;
+    }
+    window = now - start;
+    if (window >= ((SystemCoreClock / 1000U) * STATS_WINDOW_MS)) {
+      load = 1000U - (idle / (window / 1000U));
+      stats_load = load;
+      if (load > stats_peak) {
+        stats_peak = load;
+      }
+      start = now;
+      idle  = 0U;
+    }
+  }
+}
+
+void Stats_SetGuiHeap (uint32_t used, uint32_t free) {
+  stats_heap_used = used;
+  stats_heap_free = free;
+  if (used > stats_heap_peak) {
+    stats_heap_peak = used;
+  }
+}
+
+void Stats_BootMark (Stats_Boot milestone) {
+  uint32_t bit, primask;
+
+  if (milestone >= STATS_BOOT_NUM) {
+    return;
+  }
+  bit     = 1U << milestone;
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if ((stats_boot_mask & bit) == 0U) {
+    stats_boot_ms[milestone] = osKernelGetTickCount();
+    stats_boot_mask         |= bit;
+  }
+  __set_PRIMASK(primask);
+}
+
+uint32_t Stats_GetBoot (uint32_t *ms) {
+  uint32_t i;
+
+  for (i = 0U; i < STATS_BOOT_NUM; i++) {
+    ms[i] = stats_boot_ms[i];
+  }
+  return stats_boot_mask;
+}
+
+const char *Stats_BootName (Stats_Boot milestone) {
+  return (milestone < STATS_BOOT_NUM) ? stats_boot_name[milestone] : "?";
+}
+
+// Least unused stack of all threads, walked at most every STATS_STACK_MS.
+static uint32_t _StackFree (uint32_t *num) {
+  osThreadId_t ids[STATS_THREADS_MAX];
+  uint32_t     i, n, space, least, now, period;
+
+  now    = osKernelGetTickCount();
+  period = (STATS_STACK_MS * osKernelGetTickFreq()) / 1000U;
+  __disable_irq();
+  if ((stats_stack_valid != 0U) && ((now - stats_stack_tick) < period)) {
+    *num  = stats_stack_threads;
+    least = stats_stack_free;
+    __enable_irq();
+    return least;
+  }
+  __enable_irq();
+
+  n     = osThreadEnumerate(ids, STATS_THREADS_MAX);
+  least = UINT32_MAX;
+  for (i = 0U; i < n; i++) {
+    space = osThreadGetStackSpace(ids[i]);
+    if (space < least) {
+      least = space;
+    }
+  }
+  __disable_irq();
+  stats_stack_tick    = now;
+  stats_stack_free    = least;
+  stats_stack_threads = n;
+  stats_stack_valid   = 1U;
+  __enable_irq();
+  *num = n;
+  return least;
+}
+
+uint32_t Stats_GetThreads (Stats_Thread *threads, uint32_t max) {
+  osThreadId_t ids[STATS_THREADS_MAX];
+  const char  *name;
+  uint32_t     num, i;
+
+  if (max > STATS_THREADS_MAX) {
+    max = STATS_THREADS_MAX;
+  }
+  num = osThreadEnumerate(ids, max);
+  for (i = 0U; i < num; i++) {
+    name = osThreadGetName(ids[i]);
+    threads[i].name       = (name != NULL) ? name : "?";
+    threads[i].stack_size = osThreadGetStackSize(ids[i]);
+    threads[i].stack_used = threads[i].stack_size - osThreadGetStackSpace(ids[i]);
+    threads[i].priority   = (uint32_t)osThreadGetPriority(ids[i]);
+  }
+  return num;
+}
+
+void Stats_GetCounters (Stats_Counters *c) {
+  AT_Exec_Stats      exec;
+  AT_Tcp_Stats       tcp;
+  AdcAcq_Stats       acq;
+  AdcStream_Stats    stream;
+  CDC0_ACM_UartStats uart;
+  Telem_Status       telem;
+  VNC_Stats          vnc;
+  uint32_t           i;
+
+  c->uptime   = osKernelGetTickCount() / osKernelGetTickFreq();
+  c->cpu_load = stats_load;
+  c->cpu_peak = stats_peak;
+
+  c->stack_free = _StackFree(&c->threads);
+
+  c->heap_used = stats_heap_used;
+  c->heap_free = stats_heap_free;
+  c->heap_peak = stats_heap_peak;
+
+  AT_Exec_GetStats(&exec);
+  c->cmdq_depth   = exec.depth;
+  c->cmdq_max     = exec.depth_max;
+  c->cmdq_dropped = exec.dropped;
+
+  CDC0_ACM_GetUartStats(&uart);
+  c->usb_dropped   = uart.replies_dropped;
+  c->uart_dropped  = uart.dropped;
+  c->uart_overruns = uart.overruns;
+
+  AdcAcq_GetStats(&acq);
+  AdcStream_GetStats(&stream);
+  c->adc_errors     = acq.errors;
+  c->stream_dropped = stream.dropped;
+
+  AT_Tcp_GetStats(&tcp);
+  c->tcp_active  = tcp.active;
+  c->tcp_dropped = tcp.dropped;
+
+  c->vnc_viewers     = 0U;
+  c->vnc_fps         = 0U;
+  c->vnc_bytes_per_s = 0U;
+  c->vnc_stalls      = 0U;
+  for (i = 0U; VNC_Server_GetStats(i, &vnc) == 0; i++) {
+    c->vnc_viewers     += vnc.active;
+    c->vnc_fps         += vnc.fps;
+    c->vnc_bytes_per_s += vnc.bytes_per_s;
+    c->vnc_stalls      += vnc.stalls;
+  }
+
+  Telem_GetStatus(&telem);
+  c->telem_errors = telem.errors;
+}
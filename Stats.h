@@ -0,0 +1,95 @@
+/*------------------------------------------------------------------------------
+ * Name:    Stats.h
+ * Purpose: Runtime statistics: CPU load, stacks, queues and drop counters
+ *----------------------------------------------------------------------------*/
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdint.h>
+
+// Statistics Configuration ----------------------------------------------------
+
+#define STATS_WINDOW_MS         (1000U) // CPU load measurement window [ms]
+#define STATS_IDLE_GAP          (64U)   // Longer idle loop gaps are busy time [cycles]
+#define STATS_THREADS_MAX       (24U)   // Threads reported by Stats_GetThreads
+#define STATS_STACK_MS          (500U)  // Minimum period of stack walks [ms]
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+  uint32_t uptime;              // Time since start [s]
+  uint32_t cpu_load;            // CPU load in the last window [0.1 %]
+  uint32_t cpu_peak;            // Highest window load since start [0.1 %]
+  uint32_t threads;             // Threads alive
+  uint32_t stack_free;          // Least unused stack of any thread [bytes]
+  uint32_t heap_used;           // emWin heap in use (GUI_ALLOC) [bytes]
+  uint32_t heap_free;           // emWin heap free [bytes]
+  uint32_t heap_peak;           // emWin heap high-water mark [bytes]
+  uint32_t cmdq_depth;          // AT executor queue depth
+  uint32_t cmdq_max;            // AT executor queue high-water mark
+  uint32_t cmdq_dropped;        // AT lines dropped, queue full
+  uint32_t usb_dropped;         // USB CDC replies dropped, TX ring full
+  uint32_t uart_dropped;        // UART bytes dropped, receive ring overflow
+  uint32_t uart_overruns;       // UART overruns, byte lost before the DMA
+  uint32_t adc_errors;          // ADC acquisition restarts
+  uint32_t stream_dropped;      // AT+POTSTREAM blocks dropped
+  uint32_t tcp_active;          // AT TCP clients connected
+  uint32_t tcp_dropped;         // AT TCP replies dropped
+  uint32_t vnc_viewers;         // VNC viewers connected
+  uint32_t vnc_fps;             // VNC updates per second, all viewers
+  uint32_t vnc_bytes_per_s;     // VNC bytes per second, all viewers
+  uint32_t vnc_stalls;          // VNC updates held back, all viewers
+  uint32_t telem_errors;        // Telemetry socket errors
+} Stats_Counters;
+
+// Boot milestones, in the order of a typical boot (GUI_VNC.c)
+typedef enum {
+  STATS_BOOT_MAIN = 0,          // app_main started
+  STATS_BOOT_FRAME,             // Splash frame drawn
+  STATS_BOOT_DIALOG,            // Dialog drawn
+  STATS_BOOT_NET,               // Network stack initialized
+  STATS_BOOT_USB,               // USB device connected to the bus
+  STATS_BOOT_USB_CONFIG,        // USB device configured by the host
+  STATS_BOOT_LINK,              // First interface link up
+  STATS_BOOT_DHCP,              // ETH0 address assigned by DHCP
+  STATS_BOOT_VNC,               // VNC server listening
+  STATS_BOOT_NUM
+} Stats_Boot;
+
+typedef struct {
+  const char *name;             // Thread name ("?" if none)
+  uint32_t    stack_size;       // Stack size [bytes]
+  uint32_t    stack_used;       // Stack high-water mark [bytes]
+  uint32_t    priority;         // osPriority_t
+} Stats_Thread;
+
+// Start the cycle counter for the CPU load measurement. Call first in
+// app_main.
+extern int      Stats_Initialize  (void);
+
+// Collect all counters. The thread stacks are walked at most every
+// STATS_STACK_MS, in between threads and stack_free repeat the last walk,
+// so any thread may call this at any rate (e.g. every telemetry datagram).
+extern void     Stats_GetCounters (Stats_Counters *counters);
+
+// Stack usage of up to max threads.
+// \return      number of threads written
+extern uint32_t Stats_GetThreads  (Stats_Thread *threads, uint32_t max);
+
+// Record the time of a boot milestone [ms since kernel start]; only the
+// first call per milestone counts. May be called from any thread.
+extern void     Stats_BootMark    (Stats_Boot milestone);
+
+// Times of all milestones, ms[STATS_BOOT_NUM].
+// \return      mask of the milestones reached (bit n = milestone n)
+extern uint32_t Stats_GetBoot     (uint32_t *ms);
+
+// Name of a milestone ("MAIN", "FRAME", ...).
+extern const char *Stats_BootName (Stats_Boot milestone);
+
+// Record the emWin heap usage; the GUI thread calls this after GUI_Exec,
+// as GUI_ALLOC must not be called from other threads.
+extern void     Stats_SetGuiHeap  (uint32_t used, uint32_t free);
+
+#endif /* STATS_H_ */
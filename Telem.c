@@ -0,0 +1,182 @@
+/*------------------------------------------------------------------------------
+ * Name:    Telem.c
+ * Purpose: Batched UDP telemetry publisher (AT+TELEM)
+ *----------------------------------------------------------------------------*/
+/*
+ * A low priority thread samples the board state every TELEM_SAMPLE_MS
+ * into a 4 byte record (filtered pot value, button mask, LED mask) and
+ * sends interval / TELEM_SAMPLE_MS records as one UDP datagram through a
+ * BSD socket. The header carries the board ID, a sequence number, the
+ * tick of the first record, the latest temperature/VDDA scan and a
+ * summary of the runtime statistics (Stats.h), so a dashboard can tell
+ * boards apart, spot lost datagrams and watch the load. The interval
+ * is limited so a datagram always fits into one unfragmented frame.
+ *
+ * AT+TELEM stores the new destination and sets a thread flag; the thread
+ * picks it up before the next record and starts a new batch. The
+ * destination may be a unicast or multicast address.
+ */
+
+#include <string.h>
+
+#include "main.h"
+#include "cmsis_os2.h"
+#include "rl_net.h"
+#include "AdcAcq.h"
+#include "ButtonDriver.h"
+#include "LedDriver.h"
+#include "Stats.h"
+#include "Telem.h"
+
+#define TELEM_FLAG_CONFIG       (1U)    // Thread flag: new destination
+
+typedef struct {
+  TelemHdr    hdr;
+  TelemRecord rec[TELEM_RECORDS_MAX];
+} TelemDgram;
+
+typedef struct {
+  uint32_t addr;
+  uint16_t port;
+  uint16_t interval;
+} TelemCfg;
+
+static uint64_t          telem_stk[TELEM_STACK_SIZE / 8U];
+
+static const osThreadAttr_t telem_attr = {
+  .name       = "Telem",
+  .stack_mem  = &telem_stk[0],
+  .stack_size = sizeof(telem_stk),
+  .priority   = TELEM_PRIORITY
+};
+
+static osThreadId_t      telem_tid;
+static TelemDgram        telem_dgram;
+static TelemCfg          telem_cfg_next = { 0U, 0U, TELEM_INTERVAL_DEFAULT };
+
+static volatile uint32_t telem_sent;
+static volatile uint32_t telem_errors;
+
+// Board ID from the 96 bit device UID
+static uint32_t _BoardId (void) {
+  const uint32_t *uid = (const uint32_t *)UID_BASE;
+
+  return uid[0] ^ uid[1] ^ uid[2];
+}
+
+// Fill in the header and send num records.
+static void _Send (int32_t sock, const TelemCfg *cfg, uint32_t num) {
+  struct sockaddr_in dst;
+  AdcAcq_Sensors     s;
+  Stats_Counters     c;
+  uint32_t           len;
+
+  AdcAcq_GetSensors(&s);
+  Stats_GetCounters(&c);
+  telem_dgram.hdr.count           = (uint16_t)num;
+  telem_dgram.hdr.temp            = (int16_t)s.temp;
+  telem_dgram.hdr.vdda            = (uint16_t)s.vdda;
+  telem_dgram.hdr.cpu_load        = (uint16_t)c.cpu_load;
+  telem_dgram.hdr.stack_free      = (uint16_t)((c.stack_free > 0xFFFFU) ? 0xFFFFU : c.stack_free);
+  telem_dgram.hdr.heap_used       = c.heap_used;
+  telem_dgram.hdr.cmdq_max        = (uint16_t)c.cmdq_max;
+  telem_dgram.hdr.vnc_fps         = (uint16_t)c.vnc_fps;
+  telem_dgram.hdr.vnc_bytes_per_s = c.vnc_bytes_per_s;
+  telem_dgram.hdr.drops           = c.cmdq_dropped + c.usb_dropped + c.uart_dropped + c.uart_overruns +
+                                    c.adc_errors + c.stream_dropped + c.tcp_dropped + c.telem_errors;
+
+  memset(&dst, 0, sizeof(dst));
+  dst.sin_family      = AF_INET;
+  dst.sin_port        = htons(cfg->port);
+  dst.sin_addr.s_addr = cfg->addr;
+
+  len = sizeof(TelemHdr) + (num * sizeof(TelemRecord));
+  if (sendto(sock, (const char *)&telem_dgram, (int)len, 0, (struct sockaddr *)&dst, sizeof(dst)) == (int)len) {
+    telem_sent++;
+  } else {
+    telem_errors++;
+  }
+  telem_dgram.hdr.seq++;
+}
+
+// Thread: Samples board state and publishes batched datagrams
+__NO_RETURN static void Telem_Thread (void *arg) {
+  TelemCfg     cfg;
+  TelemRecord *rec;
+  int32_t      sock;
+  uint32_t     tick, flags, num, batch;
+
+  (void)arg;
+
+  while ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+    (void)osDelay(100U);
+  }
+  telem_dgram.hdr.magic   = TELEM_MAGIC;
+  telem_dgram.hdr.version = TELEM_VERSION;
+  telem_dgram.hdr.period  = TELEM_SAMPLE_MS;
+  telem_dgram.hdr.board   = _BoardId();
+
+  cfg.addr = 0U;
+  batch    = 1U;
+  num      = 0U;
+  tick     = osKernelGetTickCount();
+  for (;;) {
+    tick += TELEM_SAMPLE_MS;
+    (void)osDelayUntil(tick);
+
+    flags = osThreadFlagsClear(TELEM_FLAG_CONFIG);
+    if (((flags & 0x80000000U) == 0U) && ((flags & TELEM_FLAG_CONFIG) != 0U)) {
+      __disable_irq();
+      cfg = telem_cfg_next;
+      __enable_irq();
+      batch = cfg.interval / TELEM_SAMPLE_MS;
+      num   = 0U;                       // Start a new batch
+    }
+    if (cfg.addr == 0U) {
+      continue;
+    }
+
+    if (num == 0U) {
+      telem_dgram.hdr.time = tick;
+    }
+    rec          = &telem_dgram.rec[num++];
+    rec->pot     = (uint16_t)AdcAcq_GetValue();
+    rec->buttons = (uint8_t)BtnDrv_Read();
+    rec->leds    = (uint8_t)LedDrv_Read();
+    if (num >= batch) {
+      _Send(sock, &cfg, num);
+      num = 0U;
+    }
+  }
+}
+
+int Telem_Initialize (void) {
+  telem_tid = osThreadNew(Telem_Thread, NULL, &telem_attr);
+  return (telem_tid != NULL) ? 0 : -1;
+}
+
+int Telem_Configure (uint32_t addr, uint16_t port, uint32_t interval) {
+  if ((interval < TELEM_SAMPLE_MS) || (interval > TELEM_INTERVAL_MAX) ||
+      ((addr != 0U) && (port == 0U))) {
+    return -1;
+  }
+  __disable_irq();
+  telem_cfg_next.addr     = addr;
+  telem_cfg_next.port     = port;
+  telem_cfg_next.interval = (uint16_t)interval;
+  __enable_irq();
+  if (telem_tid != NULL) {
+    (void)osThreadFlagsSet(telem_tid, TELEM_FLAG_CONFIG);
+  }
+  return 0;
+}
+
+void Telem_GetStatus (Telem_Status *status) {
+  __disable_irq();
+  status->addr     = telem_cfg_next.addr;
+  status->port     = telem_cfg_next.port;
+  status->interval = telem_cfg_next.interval;
+  __enable_irq();
+  status->sent     = telem_sent;
+  status->errors   = telem_errors;
+}
@@ -0,0 +1,72 @@
+/*------------------------------------------------------------------------------
+ * Name:    Telem.h
+ * Purpose: Batched UDP telemetry publisher (AT+TELEM)
+ *----------------------------------------------------------------------------*/
+
+#ifndef TELEM_H_
+#define TELEM_H_
+
+#include <stdint.h>
+
+// Telemetry Configuration -----------------------------------------------------
+
+#define TELEM_MTU               (1500U) // ETH0_IP4_MTU
+#define TELEM_SAMPLE_MS         (10U)   // Record sample period [ms]
+#define TELEM_INTERVAL_DEFAULT  (1000U) // Datagram interval [ms]
+#define TELEM_STACK_SIZE        (1024)  // Publisher thread stack size
+#define TELEM_PRIORITY          osPriorityBelowNormal
+
+//------------------------------------------------------------------------------
+
+#define TELEM_MAGIC             (0x4C54U)       // "TL"
+#define TELEM_VERSION           (2U)    // 2: runtime statistics in the header
+
+// Datagram header, followed by count TelemRecord, little endian
+typedef struct {
+  uint16_t magic;               // TELEM_MAGIC
+  uint8_t  version;             // TELEM_VERSION
+  uint8_t  reserved;
+  uint16_t count;               // Records in this datagram
+  uint16_t period;              // Record period [ms]
+  uint32_t board;               // Board ID (from the device UID)
+  uint32_t seq;                 // Datagram sequence number
+  uint32_t time;                // Kernel tick [ms] of the first record
+  int16_t  temp;                // Die temperature [0.1 degC]
+  uint16_t vdda;                // VDDA [mV]
+  uint16_t cpu_load;            // CPU load [0.1 %] (Stats.h)
+  uint16_t stack_free;          // Least unused thread stack [bytes]
+  uint32_t heap_used;           // emWin heap in use [bytes]
+  uint16_t cmdq_max;            // AT executor queue high-water mark
+  uint16_t vnc_fps;             // VNC updates per second, all viewers
+  uint32_t vnc_bytes_per_s;     // VNC bytes per second, all viewers
+  uint32_t drops;               // Sum of all drop and overrun counters
+} TelemHdr;
+
+typedef struct {
+  uint16_t pot;                 // Filtered potentiometer value
+  uint8_t  buttons;             // Pressed button mask
+  uint8_t  leds;                // LED mask
+} TelemRecord;
+
+// Records that fit into one unfragmented datagram (IP 20 + UDP 8 bytes)
+#define TELEM_RECORDS_MAX       ((TELEM_MTU - 28U - sizeof(TelemHdr)) / sizeof(TelemRecord))
+#define TELEM_INTERVAL_MAX      (TELEM_RECORDS_MAX * TELEM_SAMPLE_MS)
+
+typedef struct {
+  uint32_t addr;                // Destination IPv4 address, network order (0 = off)
+  uint16_t port;                // Destination UDP port
+  uint16_t interval;            // Datagram interval [ms]
+  uint32_t sent;                // Datagrams sent
+  uint32_t errors;              // Socket errors
+} Telem_Status;
+
+extern int  Telem_Initialize (void);
+
+// Set destination (unicast or multicast) and interval; addr 0 stops
+// publishing. Takes effect at the next record.
+// \return      0 on success, -1 if the interval is out of range
+extern int  Telem_Configure  (uint32_t addr, uint16_t port, uint32_t interval);
+
+extern void Telem_GetStatus  (Telem_Status *status);
+
+#endif /* TELEM_H_ */
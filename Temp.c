@@ -1,14 +1,25 @@
-#include "stm32f7xx_hal.h"
-#include "stm32f7xx_hal_adc.h"
 #include "Temp.h"
+#include "AdcAcq.h"
+#include "Prof.h"
 
-extern ADC_HandleTypeDef hadc3;
+// Latest ADC1 sensor scan (AdcAcq.c): returns the pot value of the scan,
+// temperature in whole degC (0 below zero) and VDDA in mV, never blocks
+uint16_t ReadSensors(uint32_t *temperature, float *Vreff){
+  AdcAcq_Sensors s;
 
+  AdcAcq_GetSensors(&s);
+  *temperature = (s.temp < 0) ? 0U : (uint32_t)((s.temp + 5) / 10);
+  *Vreff = (float)s.vdda;
+
+  return (uint16_t)s.pot;
+}
+
+// Latest filtered sample of the ADC3 acquisition (AdcAcq.c), never blocks
 uint16_t ReadPot(int32_t *potValue){
-	HAL_ADC_Start(&hadc3);
-	HAL_ADC_PollForConversion(&hadc3, 1000);
+  uint32_t start = Prof_Begin();
 
-  *potValue = HAL_ADC_GetValue(&hadc3);
+  *potValue = (int32_t)AdcAcq_GetValue();
+  Prof_End(PROF_READ_POT, start);
 	
 	return 0;
 }
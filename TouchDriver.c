@@ -0,0 +1,138 @@
+/*------------------------------------------------------------------------------
+ * Name:    TouchDriver.c
+ * Purpose: Interrupt driven touch screen input for emWin
+ *----------------------------------------------------------------------------*/
+/*
+ * The FT5336 touch controller pulls its INT line (PI13) low when a
+ * contact is detected. The falling edge wakes the touch thread, which
+ * masks the EXTI line and samples the controller over I2C every
+ * TOUCH_ACTIVE_MS while the screen is touched. Changed positions are
+ * stored with GUI_TOUCH_StoreState (emWin applies the calibration set in
+ * LCDConf.c) and wake the GUI thread with GUI_EVT_TOUCH. On release the
+ * thread stores the released state, unmasks the EXTI line and blocks
+ * until the next contact, so an untouched screen costs no I2C traffic.
+ *
+ * EXTI lines 10..15 share one vector with SW1; ButtonDriver.c owns the
+ * handler and calls TouchDrv_IRQHandler.
+ */
+
+#include "main.h"
+#include "cmsis_os2.h"
+#include "GUI.h"
+#include "Board_Touch.h"
+#include "ButtonDriver.h"
+#include "GUI_Thread.h"
+#include "TouchDriver.h"
+
+#define TOUCH_INT_Pin           GPIO_PIN_13     // FT5336 INT, active low
+#define TOUCH_INT_GPIO_Port     GPIOI
+
+#define TOUCH_FLAG_INT          (1U)    // Thread flag: contact detected
+
+static void          TouchThread (void *argument);
+
+static uint64_t      touch_stk[TOUCH_STACK_SIZE / 8U];
+
+static const osThreadAttr_t touch_attr = {
+  .name       = "Touch",
+  .stack_mem  = &touch_stk[0],
+  .stack_size = sizeof(touch_stk),
+  .priority   = TOUCH_PRIORITY
+};
+
+static osThreadId_t  touch_tid;
+
+// Mask or unmask the INT line. EXTI->IMR is also changed by the button
+// interrupts, so the read-modify-write must not be interrupted.
+static void _IntMask (uint32_t masked) {
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (masked != 0U) {
+    EXTI->IMR &= ~TOUCH_INT_Pin;
+  } else {
+    EXTI->PR   = TOUCH_INT_Pin;
+    EXTI->IMR |= TOUCH_INT_Pin;
+  }
+  __set_PRIMASK(primask);
+}
+
+// INT line configured as falling edge EXTI input, masked until the
+// thread waits for a contact.
+static void _IntInit (void) {
+  GPIO_InitTypeDef init;
+
+  __HAL_RCC_GPIOI_CLK_ENABLE();
+  init.Pin       = TOUCH_INT_Pin;
+  init.Mode      = GPIO_MODE_IT_FALLING;
+  init.Pull      = GPIO_PULLUP;
+  init.Speed     = GPIO_SPEED_FREQ_LOW;
+  init.Alternate = 0U;
+  HAL_GPIO_Init(TOUCH_INT_GPIO_Port, &init);
+  _IntMask(1U);
+
+  NVIC_SetPriority(EXTI15_10_IRQn, BTN_IRQ_PRIO);      // Shared with SW1
+  NVIC_EnableIRQ(EXTI15_10_IRQn);
+}
+
+// Unmask the INT line; a contact that started before is caught by the
+// level check, as its edge may have been missed.
+static void _IntArm (void) {
+  _IntMask(0U);
+  if ((TOUCH_INT_GPIO_Port->IDR & TOUCH_INT_Pin) == 0U) {
+    (void)osThreadFlagsSet(touch_tid, TOUCH_FLAG_INT);
+  }
+}
+
+__NO_RETURN static void TouchThread (void *argument) {
+  TOUCH_STATE ts;
+  int         x, y, last_x, last_y;
+
+  (void)argument;
+
+  (void)Touch_Initialize();
+  _IntInit();
+  last_x = -1;
+  last_y = -1;
+
+  while (1) {
+    _IntArm();
+    (void)osThreadFlagsWait(TOUCH_FLAG_INT, osFlagsWaitAny, osWaitForever);
+    _IntMask(1U);
+
+    // Sample until released
+    do {
+      if ((Touch_GetState(&ts) == 0) && (ts.pressed != 0U)) {
+        x = ts.x;
+        y = ts.y;
+      } else {
+        x = -1;
+        y = -1;
+      }
+      if ((x != last_x) || (y != last_y)) {
+        GUI_TOUCH_StoreState(x, y);
+        GUI_Signal(GUI_EVT_TOUCH);
+        last_x = x;
+        last_y = y;
+      }
+      osDelay(TOUCH_ACTIVE_MS);       // Also limits the rate of spurious wakes
+    } while (x >= 0);
+  }
+}
+
+int TouchDrv_Initialize (void) {
+  touch_tid = osThreadNew(TouchThread, NULL, &touch_attr);
+  if (touch_tid == NULL) {
+    return -1;
+  }
+  return 0;
+}
+
+// EXTI line 13: first edge of a contact
+void TouchDrv_IRQHandler (void) {
+  if ((EXTI->PR & EXTI->IMR & TOUCH_INT_Pin) != 0U) {
+    EXTI->PR   = TOUCH_INT_Pin;
+    EXTI->IMR &= ~TOUCH_INT_Pin;
+    (void)osThreadFlagsSet(touch_tid, TOUCH_FLAG_INT);
+  }
+}
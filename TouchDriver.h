@@ -0,0 +1,27 @@
+/*------------------------------------------------------------------------------
+ * Name:    TouchDriver.h
+ * Purpose: Interrupt driven touch screen input for emWin
+ *----------------------------------------------------------------------------*/
+
+#ifndef TOUCH_DRIVER_H_
+#define TOUCH_DRIVER_H_
+
+#include <stdint.h>
+
+// Touch Input Configuration ---------------------------------------------------
+
+#define TOUCH_ACTIVE_MS         (10U)   // Sample period while touched [ms]
+#define TOUCH_STACK_SIZE        (1024)  // Touch thread stack size
+#define TOUCH_PRIORITY          osPriorityAboveNormal
+
+//------------------------------------------------------------------------------
+
+// Start the touch thread. Call from the GUI thread after GUI_Init.
+// \return      0 on success, -1 on error
+extern int  TouchDrv_Initialize (void);
+
+// Touch controller interrupt (EXTI line 13), called by the shared
+// EXTI15_10_IRQHandler (ButtonDriver.c).
+extern void TouchDrv_IRQHandler (void);
+
+#endif /* TOUCH_DRIVER_H_ */
@@ -11,31 +11,63 @@
  * \addtogroup usbd_cdcFunctions
  *
  * USBD_User_CDC_ACM_UART_0.c implements the application specific
- * functionality of the CDC ACM class and is used to demonstrate a USB <-> UART
- * bridge. All data received on USB is transmitted on UART and all data
- * received on UART is transmitted on USB.
+ * functionality of the CDC ACM class. Data received on USB is executed as
+ * AT commands and the replies are sent back on USB; all data received on
+ * UART is transmitted on USB.
  *
  * Details of operation:
  *   UART -> USB:
- *     Initial reception on UART is started after the USB Host sets line coding
- *     with SetLineCoding command. Having received a full UART buffer, any
- *     new reception is restarted on the same buffer. Any data received on
- *     the UART is sent over USB using the CDC0_ACM_UART_to_USB_Thread thread.
- *   USB -> UART:
- *     While the UART transmit is not busy, data transmission on the UART is
- *     started in the USBD_CDC0_ACM_DataReceived callback as soon as data is
- *     received on the USB. Further data received on USB is transmitted on
- *     UART in the UART callback routine until there is no more data available.
- *     In this case, the next UART transmit is restarted from the
- *     USBD_CDC0_ACM_DataReceived callback as soon as new data is received
- *     on the USB.
+ *     Reception on UART is started after the USB Host sets line coding
+ *     with SetLineCoding command. A circular DMA transfer writes all data
+ *     received on UART into the UART_BUFFER_SIZE ring (non-cacheable SRAM2,
+ *     section .bss.nocache). The DMA half and full transfer interrupts and
+ *     the UART idle line interrupt advance the write index and wake the
+ *     CDC0_ACM_UART_to_USB_Thread thread, which sends the new data over
+ *     USB, so a short burst is forwarded as soon as the line goes idle.
+ *     If USB does not keep up and the DMA overwrites data not sent yet,
+ *     the ring contents are dropped and counted (CDC0_ACM_GetUartStats).
+ *     With UART_FLOW_CONTROL set the DMA requests are paused instead while
+ *     the ring is half full: RTS goes inactive once the UART data register
+ *     is full, and the sender waits until the thread has drained the ring.
+ *   USB -> Commands:
+ *     Data received on USB is split into '\r' terminated AT command lines
+ *     in the USBD_CDC0_ACM_DataReceived callback (AT_PortReceive, shared
+ *     with the TCP clients and the host replay harness). Complete lines are
+ *     queued to the AT command executor thread (AT_Executor.c), so the
+ *     callback never runs a command itself.
+ *     After AT+MODE=BIN the data is decoded as COBS framed binary protocol
+ *     frames (AT_Binary.c) instead, which are queued the same way. A bus
+ *     reset or the host dropping DTR returns the channel to AT mode.
+ *   Commands -> USB:
+ *     The executor thread writes command replies into a single producer /
+ *     single consumer TX ring (RingBuf.h). The CDC0_ACM_UART_to_USB_Thread
+ *     thread is the only writer of the Bulk IN endpoint: it is woken when
+ *     the executor queue is drained or a full packet is buffered, and sends
+ *     the ring contents in blocks of up to CDC_TX_CHUNK_SIZE bytes, so a
+ *     burst of short replies is coalesced into few USB transfers.
+ *   Samples -> USB:
+ *     While AT+POTSTREAM runs (AdcStream.c) the same thread writes each
+ *     ready sample block (header, then the samples in place) once the
+ *     reply ring is empty, so a block never splits a reply. The stream is
+ *     stopped on bus reset and when the host drops DTR.
+ *     With CDC_TX_UART_MIRROR set replies are also copied to the UART when
+ *     it is idle (for a debug terminal); a busy UART skips the copy.
+ *   Benchmark fill -> USB (BENCH defined):
+ *     CDC0_ACM_Fill makes the thread send a number of "+BENCH: FILL" lines
+ *     the same way as sample blocks, to measure the Bulk IN throughput.
  *
  * The following constants in this module affect the module functionality:
  *
  *  - UART_PORT:        specifies UART Port
  *      default value:  0 (=UART0)
- *  - UART_BUFFER_SIZE: specifies UART data Buffer Size
- *      default value:  512
+ *  - UART_BUFFER_SIZE: specifies UART DMA receive ring size (power of 2)
+ *      default value:  2048
+ *  - UART_FLOW_CONTROL: enables RTS/CTS flow control
+ *      default value:  0
+ *  - CDC_TX_RING_SIZE: specifies command reply TX ring size (power of 2)
+ *      default value:  2048
+ *  - CDC_TX_CHUNK_SIZE: specifies maximum size of one Bulk IN write
+ *      default value:  512 (High-speed Bulk IN maximum packet size)
  *
  * Notes:
  *   If the USB is slower than the UART, data can get lost. This may happen
@@ -49,7 +81,12 @@
  *   with other tasks it can also loose UART data. This problem can only be
  *   solved by using UART flow control.
  *
- *   This file has to be adapted in case of UART flow control usage.
+ *   UART flow control needs the USART1 RTS (PA12) and CTS (PA11) pins
+ *   enabled in STM32CubeMX, otherwise SetLineCoding fails. The receive DMA
+ *   (DMA2 Stream2 channel 4 for USART1_RX) and its interrupt handler are
+ *   set up here rather than in STM32CubeMX, because the CMSIS USART driver
+ *   only supports single, non-circular transfers. The idle line interrupt
+ *   is handled ahead of the driver's USART1_IRQHandler ($Sub$$ patch).
  */
  
  
@@ -61,10 +98,12 @@
 #include "rl_usb.h"
 #include "Board_LED.h"
 #include "Driver_USART.h"
-#include <stdlib.h>
-#include "GUI.h"
-#include "Temp.h"
-#include "stm32f7xx_hal_adc.h"
+#include "AT_Executor.h"
+#include "AT_Port.h"
+#include "AdcStream.h"
+#include "RingBuf.h"
+#include "Prof.h"
+#include "USBD_User_CDC_ACM_UART_0.h"
 
 #define USB_RECEIVE_BUFFER_SIZE (512)
 uint8_t usb_receive_buffer[USB_RECEIVE_BUFFER_SIZE];
@@ -72,7 +111,22 @@ uint8_t usb_receive_buffer[USB_RECEIVE_BUFFER_SIZE];
 // UART Configuration ----------------------------------------------------------
  
 #define  UART_PORT              1       // UART Port number
-#define  UART_BUFFER_SIZE      (512)    // UART Buffer Size
+#define  UART_BUFFER_SIZE      (2048)   // UART DMA receive ring size (power of 2)
+#define  UART_FLOW_CONTROL      0       // 1 = RTS/CTS flow control
+#define  UART_IRQ_PRIO         (5U)     // Receive DMA interrupt priority
+
+// UART_PORT peripheral and its receive DMA request (RM0385 DMA2 request map)
+#define  UART_REG               USART1
+#define  UART_RX_DMA_STREAM     DMA2_Stream2
+#define  UART_RX_DMA_CHANNEL    DMA_CHANNEL_4
+#define  UART_RX_DMA_IRQn       DMA2_Stream2_IRQn
+ 
+// Command Reply Configuration -------------------------------------------------
+ 
+#define  CDC_TX_RING_SIZE      (2048)   // Reply TX ring size (power of 2)
+#define  CDC_TX_CHUNK_SIZE     (512)    // Maximum bytes per Bulk IN write
+#define  CDC_TX_TIMEOUT        (100U)   // Wait for ring space [ms]
+#define  CDC_TX_UART_MIRROR     0       // 1 = also copy replies to UART
  
 //------------------------------------------------------------------------------
  
@@ -80,6 +134,12 @@ uint8_t usb_receive_buffer[USB_RECEIVE_BUFFER_SIZE];
 #define  UART_Driver_(n)       _UART_Driver_(n)
 extern   ARM_DRIVER_USART       UART_Driver_(UART_PORT);
 #define  ptrUART              (&UART_Driver_(UART_PORT))
+
+#if (UART_FLOW_CONTROL != 0)
+#define  UART_FLOW_MODE         ARM_USART_FLOW_CONTROL_RTS_CTS
+#else
+#define  UART_FLOW_MODE         ARM_USART_FLOW_CONTROL_NONE
+#endif
  
 // External functions
 #ifdef   USB_CMSIS_RTOS
@@ -87,72 +147,359 @@ extern   void                   CDC0_ACM_UART_to_USB_Thread (void const *arg);
 #endif
  
 // Local Variables
-static            uint8_t       uart_rx_buf[UART_BUFFER_SIZE];
-static            uint8_t       uart_tx_buf[UART_BUFFER_SIZE];
+static            uint8_t       uart_rx_buf[UART_BUFFER_SIZE] __attribute__((section(".bss.nocache"), aligned(32)));
+#if (CDC_TX_UART_MIRROR != 0)
+static            uint8_t       uart_tx_buf[CDC_TX_CHUNK_SIZE];
+#endif
+ 
+static            DMA_HandleTypeDef hdma_uart_rx;
+static   volatile uint32_t      uart_rx_active      =   0U;
+static   volatile uint32_t      uart_rx_head        =   0U;   // Written by DMA, free running
+static   volatile uint32_t      uart_rx_tail        =   0U;   // Sent to USB, free running
+static   volatile uint32_t      uart_rx_paused      =   0U;   // DMA requests off (flow control)
+static            CDC0_ACM_UartStats uart_stats;
+ 
+static            uint8_t       cdc_tx_mem[CDC_TX_RING_SIZE] __attribute__((section(".bss.dtcm")));
+static            RingBuf       cdc_tx_ring;
+static   volatile uint32_t      cdc_tx_dropped      =   0U;
+#ifdef BENCH
+static            uint8_t       cdc_fill_buf[CDC_TX_CHUNK_SIZE];
+static   volatile uint32_t      cdc_fill_len        =   0U;   // Fill bytes left to send
+static   volatile int32_t       cdc_fill_status     =   0;
+#endif
  
-static   volatile int32_t       uart_rx_cnt         =   0;
-static   volatile int32_t       usb_tx_cnt          =   0;
+#define  CDC_TX_FLAG           (1U)     // Bridge thread flag: replies pending
+#define  CDC_STREAM_FLAG       (2U)     // Bridge thread flag: sample block ready
+#define  CDC_UART_FLAG         (4U)     // Bridge thread flag: UART data received
  
 static   void                  *cdc_acm_bridge_tid  =   0U;
 static   CDC_LINE_CODING        cdc_acm_line_coding = { 0U, 0U, 0U, 0U };
  
  
-// Called when UART has transmitted or received requested number of bytes.
+// Called when UART has transmitted the requested number of bytes.
+// Reception does not use the driver (see UART_RxStart).
 // \param[in]   event         UART event
-//               - ARM_USART_EVENT_SEND_COMPLETE:    all requested data was sent
-//               - ARM_USART_EVENT_RECEIVE_COMPLETE: all requested data was received
 static void UART_Callback (uint32_t event) {
-  int32_t cnt;
- 
-  if (event & ARM_USART_EVENT_SEND_COMPLETE) {
-    // USB -> UART
-    cnt = USBD_CDC_ACM_ReadData(0U, uart_tx_buf, UART_BUFFER_SIZE);
-    if (cnt > 0) {
-      (void)ptrUART->Send(uart_tx_buf, (uint32_t)(cnt));
+  (void)event;
+}
+
+// Advance the receive write index to the DMA position (interrupt context
+// or interrupts disabled). At most half the ring is written between two
+// calls, as the half and full transfer interrupts call it as well.
+static void UART_RxUpdate (void) {
+  uint32_t pos;
+
+  pos = UART_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(&hdma_uart_rx);
+  uart_rx_head += (pos - uart_rx_head) & (UART_BUFFER_SIZE - 1U);
+#if (UART_FLOW_CONTROL != 0)
+  if (((uart_rx_head - uart_rx_tail) >= (UART_BUFFER_SIZE / 2U)) && (uart_rx_paused == 0U)) {
+    // The next half could overwrite unsent data: stop reading the UART,
+    // RTS goes inactive when the data register is full
+    CLEAR_BIT(UART_REG->CR3, USART_CR3_DMAR);
+    uart_rx_paused = 1U;
+    uart_stats.pauses++;
+  }
+#endif
+}
+
+// Wake the bridge thread for new UART data (interrupt context).
+static void UART_RxSignal (void) {
+  UART_RxUpdate();
+  if (cdc_acm_bridge_tid != NULL) {
+    (void)osThreadFlagsSet(cdc_acm_bridge_tid, CDC_UART_FLAG);
+  }
+}
+
+// DMA half or full transfer.
+static void UART_RxDmaEvent (DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  UART_RxSignal();
+}
+
+// DMA transfer error: the HAL stopped the stream, start it again.
+static void UART_RxDmaError (DMA_HandleTypeDef *hdma) {
+  uart_stats.errors++;
+  uart_stats.received += uart_rx_head;
+  uart_rx_head = 0U;
+  uart_rx_tail = 0U;
+  (void)HAL_DMA_Start_IT(hdma, (uint32_t)&UART_REG->RDR, (uint32_t)uart_rx_buf, UART_BUFFER_SIZE);
+}
+
+// Start circular DMA reception into uart_rx_buf. Call after the driver has
+// configured and enabled the receiver.
+static void UART_RxStart (void) {
+  uart_rx_head   = 0U;
+  uart_rx_tail   = 0U;
+  uart_rx_paused = 0U;
+  if (HAL_DMA_Start_IT(&hdma_uart_rx, (uint32_t)&UART_REG->RDR, (uint32_t)uart_rx_buf, UART_BUFFER_SIZE) != HAL_OK) {
+    return;
+  }
+  UART_REG->ICR = USART_ICR_IDLECF | USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
+  CLEAR_BIT(UART_REG->CR1, USART_CR1_RXNEIE);           // The DMA reads all data
+  SET_BIT  (UART_REG->CR3, USART_CR3_DMAR | USART_CR3_EIE);
+  SET_BIT  (UART_REG->CR1, USART_CR1_IDLEIE);
+  uart_rx_active = 1U;
+}
+
+// Stop DMA reception.
+static void UART_RxStop (void) {
+  if (uart_rx_active == 0U) {
+    return;
+  }
+  uart_rx_active = 0U;
+  CLEAR_BIT(UART_REG->CR1, USART_CR1_IDLEIE);
+  CLEAR_BIT(UART_REG->CR3, USART_CR3_DMAR | USART_CR3_EIE);
+  (void)HAL_DMA_Abort(&hdma_uart_rx);
+  uart_stats.received += uart_rx_head;
+}
+
+// Set up the receive DMA stream (once).
+static void UART_RxInit (void) {
+  __HAL_RCC_DMA2_CLK_ENABLE();
+  hdma_uart_rx.Instance                 = UART_RX_DMA_STREAM;
+  hdma_uart_rx.Init.Channel             = UART_RX_DMA_CHANNEL;
+  hdma_uart_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  hdma_uart_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_uart_rx.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_uart_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_uart_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  hdma_uart_rx.Init.Mode                = DMA_CIRCULAR;
+  hdma_uart_rx.Init.Priority            = DMA_PRIORITY_MEDIUM;
+  hdma_uart_rx.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+  (void)HAL_DMA_Init(&hdma_uart_rx);
+  hdma_uart_rx.XferHalfCpltCallback = UART_RxDmaEvent;
+  hdma_uart_rx.XferCpltCallback     = UART_RxDmaEvent;
+  hdma_uart_rx.XferErrorCallback    = UART_RxDmaError;
+
+  NVIC_SetPriority(UART_RX_DMA_IRQn, UART_IRQ_PRIO);
+  NVIC_EnableIRQ(UART_RX_DMA_IRQn);
+}
+
+void DMA2_Stream2_IRQHandler (void);
+void DMA2_Stream2_IRQHandler (void) {
+  HAL_DMA_IRQHandler(&hdma_uart_rx);
+}
+
+// Receive events of the UART, handled before the CMSIS driver's interrupt
+// handler (armlink $Sub$$/$Super$$ patch), which only sees send events.
+extern void $Super$$USART1_IRQHandler (void);
+void        $Sub$$USART1_IRQHandler   (void);
+void        $Sub$$USART1_IRQHandler   (void) {
+  uint32_t isr;
+
+  isr = UART_REG->ISR;
+  if (uart_rx_active != 0U) {
+    if ((isr & USART_ISR_ORE) != 0U) {
+      UART_REG->ICR = USART_ICR_ORECF;  // Byte lost before the DMA read it
+      uart_stats.overruns++;
+    }
+    if ((isr & (USART_ISR_FE | USART_ISR_NE)) != 0U) {
+      UART_REG->ICR = USART_ICR_FECF | USART_ICR_NCF;
+      uart_stats.errors++;
+    }
+    if ((isr & USART_ISR_IDLE) != 0U) {
+      UART_REG->ICR = USART_ICR_IDLECF; // End of a burst
+      UART_RxSignal();
+    }
+  }
+  $Super$$USART1_IRQHandler();
+}
+
+// Send data received on UART to USB.
+// \return      true if received data is still waiting for USB
+static bool CDC0_ACM_SendUart (void) {
+  uint32_t pending, idx, len;
+  int32_t  cnt;
+
+  if (uart_rx_active == 0U) {
+    return false;
+  }
+  __disable_irq();
+  UART_RxUpdate();                      // Also pick up data of a running burst
+  __enable_irq();
+
+  pending = uart_rx_head - uart_rx_tail;
+  if (pending > UART_BUFFER_SIZE) {
+    // USB did not keep up and the DMA overwrote unsent data: drop it
+    uart_stats.overflows++;
+    uart_stats.dropped += pending;
+    uart_rx_tail = uart_rx_head;
+    pending = 0U;
+  }
+  while (pending != 0U) {
+    idx = uart_rx_tail & (UART_BUFFER_SIZE - 1U);
+    len = UART_BUFFER_SIZE - idx;
+    if (len > pending) {
+      len = pending;
     }
+    cnt = USBD_CDC_ACM_WriteData(0U, &uart_rx_buf[idx], (int32_t)len);
+    if (cnt <= 0) {
+      break;                            // Not configured or endpoint busy
+    }
+    uart_rx_tail     += (uint32_t)cnt;
+    uart_stats.sent  += (uint32_t)cnt;
+    pending          -= (uint32_t)cnt;
+  }
+#if (UART_FLOW_CONTROL != 0)
+  if ((uart_rx_paused != 0U) && ((uart_rx_head - uart_rx_tail) < (UART_BUFFER_SIZE / 2U))) {
+    __disable_irq();
+    uart_rx_paused = 0U;
+    SET_BIT(UART_REG->CR3, USART_CR3_DMAR);             // Receive again, RTS active
+    __enable_irq();
   }
+#endif
+  return (pending != 0U);
+}
+
+void CDC0_ACM_GetUartStats (CDC0_ACM_UartStats *stats) {
+  __disable_irq();
+  if (uart_rx_active != 0U) {
+    UART_RxUpdate();
+  }
+  *stats          = uart_stats;
+  stats->received = uart_stats.received + uart_rx_head;
+  __enable_irq();
+  stats->replies_dropped = cdc_tx_dropped;
+}
+ 
+// Send buffered command replies to USB, at most CDC_TX_CHUNK_SIZE per write.
+static void CDC0_ACM_SendReplies (void) {
+  uint8_t *data;
+  uint32_t len;
+  int32_t  cnt;
  
-  if (event & ARM_USART_EVENT_RECEIVE_COMPLETE) {
-    // UART data received, restart new reception
-    uart_rx_cnt += UART_BUFFER_SIZE;
-    (void)ptrUART->Receive(uart_rx_buf, UART_BUFFER_SIZE);
+  for (;;) {
+    len = RingBuf_Peek(&cdc_tx_ring, &data);
+    if (len == 0U) {
+      break;
+    }
+    if (len > CDC_TX_CHUNK_SIZE) {
+      len = CDC_TX_CHUNK_SIZE;
+    }
+    cnt = USBD_CDC_ACM_WriteData(0U, data, (int32_t)len);
+    if (cnt <= 0) {
+      break;                            // Not configured or endpoint busy
+    }
+    RingBuf_Consume(&cdc_tx_ring, (uint32_t)cnt);
   }
 }
  
-// Thread: Sends data received on UART to USB
+// Write all len bytes to USB, waiting a bounded time for endpoint space.
+static int32_t CDC0_ACM_WriteAll (const uint8_t *data, uint32_t len) {
+  uint32_t wait = 0U;
+  int32_t  cnt;
+
+  while (len != 0U) {
+    cnt = USBD_CDC_ACM_WriteData(0U, data, (int32_t)len);
+    if (cnt < 0) {
+      return -1;                        // Not configured
+    }
+    if (cnt == 0) {
+      if (++wait > CDC_TX_TIMEOUT) {
+        return -1;
+      }
+      (void)osDelay(1U);
+      continue;
+    }
+    data += cnt;
+    len  -= (uint32_t)cnt;
+  }
+  return 0;
+}
+
+// Send ready sample blocks of the AT+POTSTREAM stream.
+static void CDC0_ACM_SendStream (void) {
+  AdcStream_Block blk;
+  int32_t         rc;
+
+  while (AdcStream_Take(&blk) == 0) {
+    rc = CDC0_ACM_WriteAll((const uint8_t *)&blk.hdr, sizeof(blk.hdr));
+    if (rc == 0) {
+      rc = CDC0_ACM_WriteAll((const uint8_t *)blk.data, blk.hdr.count * 2U);
+    }
+    AdcStream_Release();
+    if (rc != 0) {
+      AdcStream_Stop();                 // Host gone or not reading
+      break;
+    }
+  }
+}
+
+#ifdef BENCH
+// Queue len bytes (rounded down to whole 64 byte lines) of fill lines.
+int CDC0_ACM_Fill (uint32_t len) {
+  uint32_t i;
+
+  if ((cdc_fill_status == 1) || (cdc_acm_bridge_tid == NULL)) {
+    return -1;
+  }
+  for (i = 0U; i < CDC_TX_CHUNK_SIZE; i += 64U) {
+    memcpy(&cdc_fill_buf[i], "+BENCH: FILL,", 13U);
+    memset(&cdc_fill_buf[i + 13U], 'x', 64U - 15U);
+    memcpy(&cdc_fill_buf[i + 62U], "\r\n", 2U);
+  }
+  cdc_fill_len    = len & ~63U;
+  cdc_fill_status = 1;
+  (void)osThreadFlagsSet(cdc_acm_bridge_tid, CDC_STREAM_FLAG);
+  return 0;
+}
+
+int32_t CDC0_ACM_FillStatus (void) {
+  return cdc_fill_status;
+}
+
+// Send the queued fill lines.
+static void CDC0_ACM_SendFill (void) {
+  uint32_t len;
+
+  while (cdc_fill_len != 0U) {
+    len = (cdc_fill_len < CDC_TX_CHUNK_SIZE) ? cdc_fill_len : CDC_TX_CHUNK_SIZE;
+    if (CDC0_ACM_WriteAll(cdc_fill_buf, len) != 0) {
+      cdc_fill_len    = 0U;
+      cdc_fill_status = -1;             // Host gone or not reading
+      return;
+    }
+    cdc_fill_len -= len;
+  }
+  if (cdc_fill_status == 1) {
+    cdc_fill_status = 0;
+  }
+}
+#endif
+
+// Thread: Sends command replies and data received on UART to USB
 // \param[in]     arg           not used.
 #ifdef USB_CMSIS_RTOS2
 __NO_RETURN static void CDC0_ACM_UART_to_USB_Thread (void *arg) {
 #else
 __NO_RETURN        void CDC0_ACM_UART_to_USB_Thread (void const *arg) {
 #endif
-  int32_t cnt, cnt_to_wrap;
+  bool     uart_pending;
+  uint32_t start;
  
   (void)(arg);
  
   for (;;) {
-    // UART - > USB
-    if (ptrUART->GetStatus().rx_busy != 0U) {
-      cnt  = uart_rx_cnt;
-      cnt += (int32_t)ptrUART->GetRxCount();
-      cnt -= usb_tx_cnt;
-      if (cnt >= UART_BUFFER_SIZE) {
-        // Dump data received on UART if USB is not consuming fast enough
-        usb_tx_cnt += cnt;
-        cnt = 0U;
-      }
-      if (cnt > 0) {
-        cnt_to_wrap = (int32_t)(UART_BUFFER_SIZE - ((uint32_t)usb_tx_cnt & (UART_BUFFER_SIZE - 1)));
-        if (cnt > cnt_to_wrap) {
-          cnt = cnt_to_wrap;
-        }
-        cnt = USBD_CDC_ACM_WriteData(0U, (uart_rx_buf + ((uint32_t)usb_tx_cnt & (UART_BUFFER_SIZE - 1))), cnt);
-        if (cnt > 0) {
-          usb_tx_cnt += cnt;
-        }
-      }
+    start = Prof_Begin();
+
+    // Commands -> USB
+    CDC0_ACM_SendReplies();
+
+    // Samples -> USB, only between whole replies
+    if (RingBuf_Count(&cdc_tx_ring) == 0U) {
+      CDC0_ACM_SendStream();
+#ifdef BENCH
+      CDC0_ACM_SendFill();
+#endif
     }
-    (void)osDelay(10U);
+ 
+    // UART - > USB
+    uart_pending = CDC0_ACM_SendUart();
+    Prof_End(PROF_CDC_LOOP, start);
+
+    // Wake on new replies or UART data; poll while USB has no room
+    (void)osThreadFlagsWait(CDC_TX_FLAG | CDC_STREAM_FLAG | CDC_UART_FLAG, osFlagsWaitAny,
+                            ((RingBuf_Count(&cdc_tx_ring) != 0U) || uart_pending) ? 1U : osWaitForever);
   }
 }
 #ifdef USB_CMSIS_RTOS2
@@ -182,168 +529,51 @@ extern const osThreadDef_t os_thread_def_CDC0_ACM_UART_to_USB_Thread;
 osThreadDef (CDC0_ACM_UART_to_USB_Thread, osPriorityNormal, 1U, 0U);
 #endif
  
-#define CMD_BUFFER_SIZE (64)
-uint8_t cmd_buffer[CMD_BUFFER_SIZE];
-int cmd_buffer_cnt=0;
-char storedLCDString[50] = "";
-void intToBinaryString(int num, char* binaryString, int size) {
-    for (int i = size - 1; i >= 0; i--) {
-        binaryString[i] = (num & 1) + '0';
-        num >>= 1;
-    }
-    binaryString[size] = '\0';  // Null-terminate the string
-}
-void storeLCDString(const char* lcdString) {
-    strncpy(storedLCDString, lcdString, sizeof(storedLCDString) - 1);
-    storedLCDString[sizeof(storedLCDString) - 1] = '\0'; // Null-terminate the string
-}
-
-void process_AT_command(uint8_t* cmd_buffer) {
-    if (strncmp((char*)cmd_buffer, "AT+LED", 6) == 0) {
-        int led_value = atoi((char*)&cmd_buffer[6]);
-        if (led_value >= 1 && led_value <= 8) {
-            char binaryString[5];
-            intToBinaryString(led_value, binaryString, sizeof(binaryString) - 1);
-
-            // Assuming LED1, LED2, ..., LED8 are defined as consecutive pins
-            for (int i = 0; i < 8; i++) {
-                if (binaryString[i] == '1') {
-                    // Set the corresponding LED
-                    switch (i + 1) {
-                        case 1:
-                            HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_SET);
-                            break;
-                        case 2:
-                            HAL_GPIO_WritePin(LED2_GPIO_Port, LED2_Pin, GPIO_PIN_SET);
-                            break;
-                        case 3:
-                            HAL_GPIO_WritePin(LED3_GPIO_Port, LED3_Pin, GPIO_PIN_SET);
-                            break;
-                        case 4:
-                            HAL_GPIO_WritePin(LED4_GPIO_Port, LED4_Pin, GPIO_PIN_SET);
-                            break;
-                        case 5:
-                            HAL_GPIO_WritePin(LED5_GPIO_Port, LED5_Pin, GPIO_PIN_SET);
-                            break;
-                        case 6:
-                            HAL_GPIO_WritePin(LED6_GPIO_Port, LED6_Pin, GPIO_PIN_SET);
-                            break;
-                        case 7:
-                            HAL_GPIO_WritePin(LED7_GPIO_Port, LED7_Pin, GPIO_PIN_SET);
-                            break;
-                        case 8:
-                            HAL_GPIO_WritePin(LED8_GPIO_Port, LED8_Pin, GPIO_PIN_SET);
-                            break;
-                        default:
-                            // Handle unexpected case
-                            break;
-                    }
-                } else {
-                    // Reset the corresponding LED
-                    switch (i + 1) {
-                        case 1:
-                            HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_RESET);
-                            break;
-                        case 2:
-                            HAL_GPIO_WritePin(LED2_GPIO_Port, LED2_Pin, GPIO_PIN_RESET);
-                            break;
-                        case 3:
-                            HAL_GPIO_WritePin(LED3_GPIO_Port, LED3_Pin, GPIO_PIN_RESET);
-                            break;
-                        case 4:
-                            HAL_GPIO_WritePin(LED4_GPIO_Port, LED4_Pin, GPIO_PIN_RESET);
-                            break;
-                        case 5:
-                            HAL_GPIO_WritePin(LED5_GPIO_Port, LED5_Pin, GPIO_PIN_RESET);
-                            break;
-                        case 6:
-                            HAL_GPIO_WritePin(LED6_GPIO_Port, LED6_Pin, GPIO_PIN_RESET);
-                            break;
-                        case 7:
-                            HAL_GPIO_WritePin(LED7_GPIO_Port, LED7_Pin, GPIO_PIN_RESET);
-                            break;
-                        case 8:
-                            HAL_GPIO_WritePin(LED8_GPIO_Port, LED8_Pin, GPIO_PIN_RESET);
-                            break;
-                        default:
-                            // Handle unexpected case
-                            break;
-                    }
-                }
-            }
-        }
-          snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "LED value set to: %d\r\n", led_value);
-    }
-else if (strncmp((char*)cmd_buffer, "AT+LCD=", 6) == 0) {
-        // Extract the string after "AT+LCD="
-        const char* lcdString = (char*)(cmd_buffer + 6);
-
-        // Store the extracted string
-        storeLCDString(lcdString);
-        //send string to terminal
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "LCD string set to: %s\r\n", lcdString);
-    }
-else if (strncmp((char*)cmd_buffer, "AT+BUTTON", 9) == 0) {
-    // Check the state of each button
-
-    if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET) {
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "All buttons are pressed\r\n");
-    }
-
-    else if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 1, Button 2 and Button 3 are pressed\r\n");
-    }
-    else if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 1, Button 2 and Button 4 are pressed\r\n");
-    }
-    else if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 1, Button 3 and Button 4 are pressed\r\n");
-    }
-    else if (HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 2, Button 3 and Button 4 are pressed\r\n");
-    }
+static            AT_PortDecoder cmd_decoder;
 
+// Queue a framed command line for the executor thread.
+static void CDC0_ACM_CommandLine (const char *line, uint32_t len, uint32_t overflow, void *ctx) {
+  (void)ctx;
+  (void)AT_Exec_Post(AT_CHANNEL_USB, line, len, overflow);
+}
 
-    else if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET) {
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 1 and Button 2 are pressed\r\n");
-    } else if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 1 and Button 3 are pressed\r\n");
-    }
-    else if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 1 and Button 4 are pressed\r\n");
-    }
+// Queue a decoded binary frame for the executor thread.
+static void CDC0_ACM_CommandFrame (const uint8_t *frame, uint32_t len, uint32_t error, void *ctx) {
+  (void)ctx;
+  (void)AT_Exec_PostFrame(AT_CHANNEL_USB, frame, (error != 0U) ? 0U : len);
+}
 
+// Called in the executor thread with a command reply; buffers it for USB.
+// len == 0 means the command queue is drained: send what is buffered.
+static void CDC0_ACM_CommandOutput (uint32_t channel, const char *buf, uint32_t len) {
+  uint32_t wait;
+ 
+  (void)channel;
 
-    else if (HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 2 and Button 3 are pressed\r\n");
-    }
-    else if (HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 2 and Button 4 are pressed\r\n");
+  if (len != 0U) {
+    // Keep replies whole; wait a bounded time for the host to drain the ring
+    for (wait = 0U; RingBuf_Free(&cdc_tx_ring) < len; wait++) {
+      if (wait >= CDC_TX_TIMEOUT) {
+        cdc_tx_dropped++;
+        return;
+      }
+      (void)osDelay(1U);
     }
-
-
-    else if (HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET && HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET){
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 3 and Button 4 are pressed\r\n");
+    (void)RingBuf_Write(&cdc_tx_ring, buf, len);
+ 
+#if (CDC_TX_UART_MIRROR != 0)
+    if ((ptrUART->GetStatus().tx_busy == 0U) && (len <= CDC_TX_CHUNK_SIZE)) {
+      memcpy(uart_tx_buf, buf, len);
+      (void)ptrUART->Send(uart_tx_buf, len);
     }
-
-    else if (HAL_GPIO_ReadPin(SW1_GPIO_Port, SW1_Pin) == GPIO_PIN_RESET) {
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 1 is pressed\r\n");
-    } else if (HAL_GPIO_ReadPin(SW2_GPIO_Port, SW2_Pin) == GPIO_PIN_RESET) {
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 2 is pressed\r\n");
-    } else if (HAL_GPIO_ReadPin(SW3_GPIO_Port, SW3_Pin) == GPIO_PIN_RESET) {
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 3 is pressed\r\n");
-    } else if (HAL_GPIO_ReadPin(SW4_GPIO_Port, SW4_Pin) == GPIO_PIN_RESET) {
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Button 4 is pressed\r\n");
-    }else {
-        snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "No button is pressed\r\n");
+#endif
+ 
+    if (RingBuf_Count(&cdc_tx_ring) < CDC_TX_CHUNK_SIZE) {
+      return;                           // Wait for more replies or queue drain
     }
-    ptrUART->Send(uart_tx_buf, strlen((char*)uart_tx_buf));
-	}
-  else if (strncmp((char*)cmd_buffer, "AT+POT", 6) == 0) {
-    int32_t potValue;
-    ReadPot(&potValue);
-    snprintf((char*)uart_tx_buf, UART_BUFFER_SIZE, "Potentiometer value: %d\r\n", potValue);
-    ptrUART->Send(uart_tx_buf, strlen((char*)uart_tx_buf));
+  }
+  if (cdc_acm_bridge_tid != NULL) {
+    (void)osThreadFlagsSet(cdc_acm_bridge_tid, CDC_TX_FLAG);
   }
 }
 
@@ -353,53 +583,46 @@ else if (strncmp((char*)cmd_buffer, "AT+BUTTON", 9) == 0) {
 // Called when new data was received from the USB Host.
 // \param[in]   len           number of bytes available to read.
 void USBD_CDC0_ACM_DataReceived (uint32_t len) {
-  int32_t cnt;
+  int32_t  cnt;
  
   (void)(len);
  
-  //if (ptrUART->GetStatus().tx_busy == 0U) {
-    //Start USB -> UART
-    cnt = USBD_CDC_ACM_ReadData(0U, usb_receive_buffer, USB_RECEIVE_BUFFER_SIZE);
-    if (cnt > 0) {
-      //(void)ptrUART->Send(uart_tx_buf, (uint32_t)(cnt));
-			for(int i=0; i<cnt; i++)
-			{
-				//check if character is '\r'
-				if(usb_receive_buffer[i]=='\r')
-				{
-					cmd_buffer[cmd_buffer_cnt++]='\0';
-					process_AT_command(cmd_buffer);
-					cmd_buffer_cnt=0;
-				}
-				else
-				{
-					cmd_buffer[cmd_buffer_cnt++]=usb_receive_buffer[i];
-				}
-			}			
-    }
-  //}
+  cnt = USBD_CDC_ACM_ReadData(0U, usb_receive_buffer, USB_RECEIVE_BUFFER_SIZE);
+  if (cnt > 0) {
+    AT_PortReceive(&cmd_decoder, usb_receive_buffer, (uint32_t)cnt,
+                   CDC0_ACM_CommandLine, CDC0_ACM_CommandFrame, NULL);
+  }
 }
  
 // Called during USBD_Initialize to initialize the USB CDC class instance (ACM).
 void USBD_CDC0_ACM_Initialize (void) {
   (void)ptrUART->Initialize   (UART_Callback);
   (void)ptrUART->PowerControl (ARM_POWER_FULL);
+  UART_RxInit();
+
+  AT_PortDecoderReset(&cmd_decoder, AT_CHANNEL_USB);
+  RingBuf_Init(&cdc_tx_ring, cdc_tx_mem, CDC_TX_RING_SIZE);
+  AT_Exec_SetOutput(AT_CHANNEL_USB, CDC0_ACM_CommandOutput);
  
 #ifdef USB_CMSIS_RTOS2
   cdc_acm_bridge_tid = osThreadNew (CDC0_ACM_UART_to_USB_Thread, NULL, &cdc0_acm_uart_to_usb_thread_attr);
 #else
   cdc_acm_bridge_tid = osThreadCreate (osThread (CDC0_ACM_UART_to_USB_Thread), NULL);
 #endif
+  AdcStream_SetSignal(cdc_acm_bridge_tid, CDC_STREAM_FLAG);
 }
  
  
 // Called during USBD_Uninitialize to de-initialize the USB CDC class instance (ACM).
 void USBD_CDC0_ACM_Uninitialize (void) {
  
+  AdcStream_Stop();
+  AdcStream_SetSignal(NULL, 0U);
   if (osThreadTerminate (cdc_acm_bridge_tid) == osOK) {
     cdc_acm_bridge_tid = NULL;
   }
  
+  UART_RxStop();
   (void)ptrUART->Control      (ARM_USART_ABORT_RECEIVE, 0U);
   (void)ptrUART->PowerControl (ARM_POWER_OFF);
   (void)ptrUART->Uninitialize ();
@@ -408,6 +631,9 @@ void USBD_CDC0_ACM_Uninitialize (void) {
  
 // Called upon USB Bus Reset Event.
 void USBD_CDC0_ACM_Reset (void) {
+  AT_Exec_SetMode(AT_CHANNEL_USB, AT_MODE_TEXT);
+  AdcStream_Stop();
+  UART_RxStop();
   (void)ptrUART->Control      (ARM_USART_ABORT_SEND,    0U);
   (void)ptrUART->Control      (ARM_USART_ABORT_RECEIVE, 0U);
 }
@@ -421,6 +647,7 @@ bool USBD_CDC0_ACM_SetLineCoding (const CDC_LINE_CODING *line_coding) {
   uint32_t data_bits = 0U, parity = 0U, stop_bits = 0U;
   int32_t  status;
  
+  UART_RxStop();
   (void)ptrUART->Control (ARM_USART_ABORT_SEND,    0U);
   (void)ptrUART->Control (ARM_USART_ABORT_RECEIVE, 0U);
   (void)ptrUART->Control (ARM_USART_CONTROL_TX,    0U);
@@ -474,7 +701,8 @@ bool USBD_CDC0_ACM_SetLineCoding (const CDC_LINE_CODING *line_coding) {
   status = ptrUART->Control(ARM_USART_MODE_ASYNCHRONOUS  |
                             data_bits                    |
                             parity                       |
-                            stop_bits                    ,
+                            stop_bits                    |
+                            UART_FLOW_MODE               ,
                             line_coding->dwDTERate       );
 
   if (status != ARM_DRIVER_OK) {
@@ -484,13 +712,10 @@ bool USBD_CDC0_ACM_SetLineCoding (const CDC_LINE_CODING *line_coding) {
   // Store requested settings to local variable
   cdc_acm_line_coding = *line_coding;
  
-  uart_rx_cnt = 0;
-  usb_tx_cnt  = 0;
- 
   (void)ptrUART->Control (ARM_USART_CONTROL_TX, 1U);
   (void)ptrUART->Control (ARM_USART_CONTROL_RX, 1U);
  
-  (void)ptrUART->Receive (uart_rx_buf, UART_BUFFER_SIZE);
+  UART_RxStart();
  
   return true;
 }
@@ -516,9 +741,11 @@ bool USBD_CDC0_ACM_GetLineCoding (CDC_LINE_CODING *line_coding) {
 // \return      true          set control line state request processed.
 // \return      false         set control line state request not supported or not processed.
 bool USBD_CDC0_ACM_SetControlLineState (uint16_t state) {
-  // Add code for set control line state
- 
-  (void)(state);
+  // Host closed the port: fall back to AT mode for the next session
+  if ((state & 1U) == 0U) {
+    AT_Exec_SetMode(AT_CHANNEL_USB, AT_MODE_TEXT);
+    AdcStream_Stop();
+  }
  
   return true;
 }
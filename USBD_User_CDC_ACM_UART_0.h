@@ -0,0 +1,34 @@
+/*------------------------------------------------------------------------------
+ * Name:    USBD_User_CDC_ACM_UART_0.h
+ * Purpose: USB CDC ACM (USB <-> UART bridge) statistics and benchmark fill
+ *----------------------------------------------------------------------------*/
+
+#ifndef USBD_USER_CDC_ACM_UART_0_H_
+#define USBD_USER_CDC_ACM_UART_0_H_
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t received;            // Bytes received on UART
+  uint32_t sent;                // Bytes forwarded to USB
+  uint32_t overflows;           // Receive ring overruns, USB too slow
+  uint32_t dropped;             // Bytes dropped by receive ring overruns
+  uint32_t overruns;            // UART overruns, byte lost before the DMA
+  uint32_t errors;              // Framing, noise and DMA errors
+  uint32_t pauses;              // Receive paused by flow control (RTS)
+  uint32_t replies_dropped;     // Command replies dropped, USB TX ring full
+} CDC0_ACM_UartStats;
+
+// Statistics of the UART -> USB direction and the reply ring since power on.
+extern void CDC0_ACM_GetUartStats (CDC0_ACM_UartStats *stats);
+
+#ifdef BENCH
+// Send len bytes of "+BENCH: FILL" lines on Bulk IN (Bench.c).
+// \return      0 on success, -1 if a fill is running or the class is down
+extern int     CDC0_ACM_Fill       (uint32_t len);
+
+// \return      1 while the fill is sent, 0 when done, -1 if it failed
+extern int32_t CDC0_ACM_FillStatus (void);
+#endif
+
+#endif /* USBD_USER_CDC_ACM_UART_0_H_ */
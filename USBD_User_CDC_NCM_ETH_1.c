@@ -0,0 +1,664 @@
+/*------------------------------------------------------------------------------
+ * MDK Middleware - Component ::USB:Device:CDC
+ * Copyright (c) 2004-2020 Arm Limited (or its affiliates). All rights reserved.
+ *------------------------------------------------------------------------------
+ * Name:    USBD_User_CDC_NCM_ETH_1.c
+ * Purpose: USB Device Communication Device Class (CDC)
+ *          Network Control Model (NCM) Network Interface User module
+ * Rev.:    V1.0.0
+ *----------------------------------------------------------------------------*/
+/**
+ * \addtogroup usbd_cdcFunctions
+ *
+ * USBD_User_CDC_NCM_ETH_1.c implements the application specific
+ * functionality of CDC instance 1 in the NCM model: the USB link is a
+ * second network interface (ETH1, Net_Config_ETH_1.h) of the network
+ * stack, next to the Ethernet port. The AT command server and the VNC
+ * server listen on all interfaces, so they are reachable over USB at
+ * ETH1_IP4_ADDR (the host configures an address in the same subnet).
+ *
+ * The network stack drives interfaces through CMSIS Ethernet MAC and PHY
+ * drivers; this module provides Driver_ETH_MAC1 and Driver_ETH_PHY1
+ * (ETH1_DRIVER) on top of the NCM data interface instead of hardware.
+ *
+ * Details of operation:
+ *   Link:
+ *     The link is up while the host has the NCM data interface selected
+ *     (USBD_CDC1_NCM_Start .. Stop). The network stack polls the link
+ *     state through the PHY driver; the same poll sends the
+ *     ConnectionSpeedChange and NetworkConnection notifications to the
+ *     host, retried until the interrupt endpoint accepts them.
+ *   USB -> Network:
+ *     A received OUT NTB raises ARM_ETH_MAC_EVENT_RX_FRAME. The network
+ *     thread then reads the datagrams of all NDPs of the NTB as frames
+ *     and releases the NTB, so the host can send the next one.
+ *   Network -> USB:
+ *     Each frame sent by the stack becomes one IN NTB. A frame waits up
+ *     to NCM_TX_TIMEOUT for the previous NTB to be sent; frames sent
+ *     while the link is down are dropped.
+ *
+ * The composite device (CDC 0 ACM and CDC 1 NCM) is optional: removing
+ * CDC instance 1 and ETH interface 1 in the Run-Time Environment leaves
+ * the ACM only device, and this module compiles to nothing.
+ */
+
+
+//! [code_USBD_User_CDC_NCM]
+
+#include <stddef.h>
+#include <string.h>
+
+#include "RTE_Components.h"
+
+#if defined(RTE_USB_Device_CDC_1) && defined(RTE_Network_Interface_ETH_1)
+
+#include "cmsis_os2.h"
+#include "rl_usb.h"
+#include "Driver_ETH_MAC.h"
+#include "Driver_ETH_PHY.h"
+
+#include "USBD_Config_CDC_1.h"
+
+// NCM Interface Configuration -------------------------------------------------
+
+#define  NCM_ETH_DRIVER         1       // Driver_ETH_MAC#/PHY# (ETH1_DRIVER)
+#define  NCM_TX_TIMEOUT        (10U)    // Wait for the previous IN NTB [ms]
+#define  NCM_LINK_SPEED        (480000000U)     // Reported bit rate [bit/s]
+
+//------------------------------------------------------------------------------
+
+#define  NCM_INSTANCE           1U      // CDC instance of this module
+
+#define _ETH_MAC_Driver_(n)     Driver_ETH_MAC##n
+#define  ETH_MAC_Driver_(n)    _ETH_MAC_Driver_(n)
+#define _ETH_PHY_Driver_(n)     Driver_ETH_PHY##n
+#define  ETH_PHY_Driver_(n)    _ETH_PHY_Driver_(n)
+
+// Ethernet statistics feature selectors (bmEthernetStatistics bits + 1)
+#define  NCM_STAT_XMIT_OK       (1U)
+#define  NCM_STAT_RCV_OK        (2U)
+
+// Host notifications still to be sent
+#define  NCM_NOTIFY_SPEED       (1U)
+#define  NCM_NOTIFY_CONNECT     (2U)
+
+// Local Variables
+static   ARM_ETH_MAC_SignalEvent_t ncm_cb_event   = NULL;
+static   osSemaphoreId_t        ncm_tx_sem        = NULL;
+static   volatile uint8_t       ncm_link          = 0U;  // Data interface active
+static   volatile uint8_t       ncm_notify        = 0U;  // NCM_NOTIFY_* pending
+static            uint8_t       ncm_rx_enable     = 0U;
+static            uint8_t       ncm_tx_enable     = 0U;
+static            uint8_t       ncm_ntb_out       = 0U;  // OUT NTB being read
+static   volatile uint32_t      ncm_tx_frames     = 0U;
+static   volatile uint32_t      ncm_rx_frames     = 0U;
+
+static            uint8_t       ncm_net_addr[6];         // Host side MAC address
+static            uint8_t       ncm_mac_addr[6];         // Device side MAC address
+static            uint16_t      ncm_ntb_format    = 0U;  // 16-bit NTB
+static            uint32_t      ncm_ntb_in_size   = USBD_CDC1_NCM_DW_NTB_IN_MAX_SIZE;
+static            uint16_t      ncm_max_datagram  = USBD_CDC1_NCM_W_MAX_SEGMENT_SIZE;
+static            uint8_t       ncm_rx_drop[USBD_CDC1_NCM_W_MAX_SEGMENT_SIZE];
+
+
+// ==== NCM data interface ====
+
+// Release the OUT NTB being read, so the host can send the next one.
+static void NCM_ReleaseNTB (void) {
+  if (ncm_ntb_out != 0U) {
+    ncm_ntb_out = 0U;
+    (void)USBD_CDC_NCM_NTB_OUT_Release (NCM_INSTANCE);
+  }
+}
+
+// Size of the next received datagram; steps through the NDPs of the
+// received NTBs and releases each NTB when it has been read.
+static uint32_t NCM_RxSize (void) {
+  int32_t size;
+
+  for (;;) {
+    if (ncm_ntb_out == 0U) {
+      if (USBD_CDC_NCM_NTB_OUT_IsReceived (NCM_INSTANCE) != 1) {
+        return 0U;
+      }
+      ncm_ntb_out = 1U;
+      if (USBD_CDC_NCM_NTB_OUT_ProcessNDP (NCM_INSTANCE) < 0) {
+        NCM_ReleaseNTB ();
+        continue;
+      }
+    }
+    size = USBD_CDC_NCM_NTB_OUT_GetDatagramSize (NCM_INSTANCE);
+    if (size > 0) {
+      return (uint32_t)size;
+    }
+    // NDP read: next NDP of the same NTB, or the next NTB
+    if (USBD_CDC_NCM_NTB_OUT_ProcessNDP (NCM_INSTANCE) < 0) {
+      NCM_ReleaseNTB ();
+    }
+  }
+}
+
+// Convert the NCM MAC address string (12 hex digits) into bytes.
+static void NCM_ParseMac (const wchar_t *str, uint8_t *addr) {
+  uint32_t i, d;
+  wchar_t  c;
+
+  memset(addr, 0, 6U);
+  for (i = 0U; i < 12U; i++) {
+    c = str[i];
+    if      ((c >= '0') && (c <= '9')) { d = (uint32_t)(c - '0');         }
+    else if ((c >= 'A') && (c <= 'F')) { d = (uint32_t)(c - 'A') + 10U; }
+    else if ((c >= 'a') && (c <= 'f')) { d = (uint32_t)(c - 'a') + 10U; }
+    else                               { return;                         }
+    addr[i / 2U] |= (uint8_t)(d << (((i & 1U) != 0U) ? 0U : 4U));
+  }
+}
+
+
+// ==== Driver_ETH_MAC1 ====
+
+static ARM_DRIVER_VERSION MAC_GetVersion (void) {
+  ARM_DRIVER_VERSION ver = { ARM_ETH_MAC_API_VERSION, ARM_DRIVER_VERSION_MAJOR_MINOR(1, 0) };
+  return ver;
+}
+
+// USB bulk transfers are CRC protected, so received checksums need no
+// check; sent frames still carry checksums computed by the stack.
+static ARM_ETH_MAC_CAPABILITIES MAC_GetCapabilities (void) {
+  ARM_ETH_MAC_CAPABILITIES cap = {
+    1U,                         // checksum_offload_rx_ip4
+    1U,                         // checksum_offload_rx_ip6
+    1U,                         // checksum_offload_rx_udp
+    1U,                         // checksum_offload_rx_tcp
+    1U,                         // checksum_offload_rx_icmp
+    0U,                         // checksum_offload_tx_ip4
+    0U,                         // checksum_offload_tx_ip6
+    0U,                         // checksum_offload_tx_udp
+    0U,                         // checksum_offload_tx_tcp
+    0U,                         // checksum_offload_tx_icmp
+    ARM_ETH_INTERFACE_MII,      // media_interface (none)
+    0U,                         // mac_address: ETH1_MAC_ADDR is used
+    1U,                         // event_rx_frame
+    0U,                         // event_tx_frame
+    0U,                         // event_wakeup
+    0U,                         // precision_timer
+    0U                          // reserved
+  };
+  return cap;
+}
+
+static int32_t MAC_Initialize (ARM_ETH_MAC_SignalEvent_t cb_event) {
+  ncm_cb_event = cb_event;
+  return ARM_DRIVER_OK;
+}
+
+static int32_t MAC_Uninitialize (void) {
+  ncm_cb_event = NULL;
+  return ARM_DRIVER_OK;
+}
+
+static int32_t MAC_PowerControl (ARM_POWER_STATE state) {
+  switch (state) {
+    case ARM_POWER_OFF:
+      ncm_rx_enable = 0U;
+      ncm_tx_enable = 0U;
+      return ARM_DRIVER_OK;
+    case ARM_POWER_FULL:
+      return ARM_DRIVER_OK;
+    default:
+      return ARM_DRIVER_ERROR_UNSUPPORTED;
+  }
+}
+
+static int32_t MAC_GetMacAddress (ARM_ETH_MAC_ADDR *ptr_addr) {
+  memcpy(ptr_addr->b, ncm_mac_addr, 6U);
+  return ARM_DRIVER_OK;
+}
+
+static int32_t MAC_SetMacAddress (const ARM_ETH_MAC_ADDR *ptr_addr) {
+  memcpy(ncm_mac_addr, ptr_addr->b, 6U);
+  return ARM_DRIVER_OK;
+}
+
+// The host delivers only what it addresses to the link; the stack
+// filters the rest.
+static int32_t MAC_SetAddressFilter (const ARM_ETH_MAC_ADDR *ptr_addr, uint32_t num_addr) {
+  (void)ptr_addr;
+  (void)num_addr;
+  return ARM_DRIVER_OK;
+}
+
+// Send one frame as an IN NTB (network core thread).
+static int32_t MAC_SendFrame (const uint8_t *frame, uint32_t len, uint32_t flags) {
+  (void)flags;
+
+  if ((ncm_link == 0U) || (ncm_tx_enable == 0U)) {
+    return ARM_DRIVER_ERROR;            // Link down: frame dropped
+  }
+  if ((len == 0U) || (len > ncm_max_datagram)) {
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+  if (osSemaphoreAcquire (ncm_tx_sem, NCM_TX_TIMEOUT) != osOK) {
+    return ARM_DRIVER_ERROR_TIMEOUT;    // Host does not read the IN pipe
+  }
+  if ((USBD_CDC_NCM_NTB_IN_Initialize    (NCM_INSTANCE)             < 0) ||
+      (USBD_CDC_NCM_NTB_IN_CreateNDP     (NCM_INSTANCE, 1U)         < 0) ||
+      (USBD_CDC_NCM_NTB_IN_WriteDatagram (NCM_INSTANCE, frame, len) < 0) ||
+      (USBD_CDC_NCM_NTB_IN_Send          (NCM_INSTANCE)             < 0)) {
+    (void)osSemaphoreRelease (ncm_tx_sem);
+    return ARM_DRIVER_ERROR;
+  }
+  ncm_tx_frames++;
+  return ARM_DRIVER_OK;
+}
+
+// Read the next datagram as a frame; frame == NULL discards it.
+static int32_t MAC_ReadFrame (uint8_t *frame, uint32_t len) {
+  int32_t n;
+
+  if (frame == NULL) {
+    frame = ncm_rx_drop;
+    len   = sizeof(ncm_rx_drop);
+  }
+  n = USBD_CDC_NCM_NTB_OUT_ReadDatagram (NCM_INSTANCE, frame, len);
+  if (n < 0) {
+    return ARM_DRIVER_ERROR;
+  }
+  if (frame != ncm_rx_drop) {
+    ncm_rx_frames++;
+  }
+  return n;
+}
+
+static uint32_t MAC_GetRxFrameSize (void) {
+  if (ncm_rx_enable == 0U) {
+    return 0U;
+  }
+  return NCM_RxSize ();
+}
+
+static int32_t MAC_GetRxFrameTime (ARM_ETH_MAC_TIME *time) {
+  (void)time;
+  return ARM_DRIVER_ERROR_UNSUPPORTED;
+}
+
+static int32_t MAC_GetTxFrameTime (ARM_ETH_MAC_TIME *time) {
+  (void)time;
+  return ARM_DRIVER_ERROR_UNSUPPORTED;
+}
+
+static int32_t MAC_ControlTimer (uint32_t control, ARM_ETH_MAC_TIME *time) {
+  (void)control;
+  (void)time;
+  return ARM_DRIVER_ERROR_UNSUPPORTED;
+}
+
+static int32_t MAC_Control (uint32_t control, uint32_t arg) {
+  switch (control) {
+    case ARM_ETH_MAC_CONFIGURE:
+    case ARM_ETH_MAC_VLAN_FILTER:
+      return ARM_DRIVER_OK;
+    case ARM_ETH_MAC_CONTROL_TX:
+      ncm_tx_enable = (arg != 0U) ? 1U : 0U;
+      return ARM_DRIVER_OK;
+    case ARM_ETH_MAC_CONTROL_RX:
+      ncm_rx_enable = (arg != 0U) ? 1U : 0U;
+      return ARM_DRIVER_OK;
+    case ARM_ETH_MAC_FLUSH:
+      if ((arg & ARM_ETH_MAC_FLUSH_RX) != 0U) {
+        NCM_ReleaseNTB ();
+      }
+      return ARM_DRIVER_OK;
+    default:
+      return ARM_DRIVER_ERROR_UNSUPPORTED;
+  }
+}
+
+static int32_t MAC_PHY_Read (uint8_t phy_addr, uint8_t reg_addr, uint16_t *data) {
+  (void)phy_addr;
+  (void)reg_addr;
+  (void)data;
+  return ARM_DRIVER_ERROR_UNSUPPORTED;
+}
+
+static int32_t MAC_PHY_Write (uint8_t phy_addr, uint8_t reg_addr, uint16_t data) {
+  (void)phy_addr;
+  (void)reg_addr;
+  (void)data;
+  return ARM_DRIVER_ERROR_UNSUPPORTED;
+}
+
+extern ARM_DRIVER_ETH_MAC ETH_MAC_Driver_(NCM_ETH_DRIVER);
+ARM_DRIVER_ETH_MAC ETH_MAC_Driver_(NCM_ETH_DRIVER) = {
+  MAC_GetVersion,
+  MAC_GetCapabilities,
+  MAC_Initialize,
+  MAC_Uninitialize,
+  MAC_PowerControl,
+  MAC_GetMacAddress,
+  MAC_SetMacAddress,
+  MAC_SetAddressFilter,
+  MAC_SendFrame,
+  MAC_ReadFrame,
+  MAC_GetRxFrameSize,
+  MAC_GetRxFrameTime,
+  MAC_GetTxFrameTime,
+  MAC_ControlTimer,
+  MAC_Control,
+  MAC_PHY_Read,
+  MAC_PHY_Write
+};
+
+
+// ==== Driver_ETH_PHY1 ====
+
+static ARM_DRIVER_VERSION PHY_GetVersion (void) {
+  ARM_DRIVER_VERSION ver = { ARM_ETH_PHY_API_VERSION, ARM_DRIVER_VERSION_MAJOR_MINOR(1, 0) };
+  return ver;
+}
+
+static int32_t PHY_Initialize (ARM_ETH_PHY_Read_t fn_read, ARM_ETH_PHY_Write_t fn_write) {
+  (void)fn_read;
+  (void)fn_write;
+  return ARM_DRIVER_OK;
+}
+
+static int32_t PHY_Uninitialize (void) {
+  return ARM_DRIVER_OK;
+}
+
+static int32_t PHY_PowerControl (ARM_POWER_STATE state) {
+  return (state == ARM_POWER_LOW) ? ARM_DRIVER_ERROR_UNSUPPORTED : ARM_DRIVER_OK;
+}
+
+static int32_t PHY_SetInterface (uint32_t interface) {
+  (void)interface;
+  return ARM_DRIVER_OK;
+}
+
+static int32_t PHY_SetMode (uint32_t mode) {
+  (void)mode;
+  return ARM_DRIVER_OK;
+}
+
+// Link state, polled by the network stack; also sends the pending host
+// notifications (the interrupt endpoint takes one at a time).
+static ARM_ETH_LINK_STATE PHY_GetLinkState (void) {
+  if (ncm_link == 0U) {
+    return ARM_ETH_LINK_DOWN;
+  }
+  if ((ncm_notify & NCM_NOTIFY_SPEED) != 0U) {
+    if (USBD_CDC_NCM_Notify_ConnectionSpeedChange (NCM_INSTANCE, NCM_LINK_SPEED, NCM_LINK_SPEED) == usbOK) {
+      ncm_notify &= (uint8_t)~NCM_NOTIFY_SPEED;
+    }
+  } else if ((ncm_notify & NCM_NOTIFY_CONNECT) != 0U) {
+    if (USBD_CDC_NCM_Notify_NetworkConnection (NCM_INSTANCE, 1U) == usbOK) {
+      ncm_notify &= (uint8_t)~NCM_NOTIFY_CONNECT;
+    }
+  }
+  return ARM_ETH_LINK_UP;
+}
+
+static ARM_ETH_LINK_INFO PHY_GetLinkInfo (void) {
+  ARM_ETH_LINK_INFO info;
+
+  info.speed    = ARM_ETH_SPEED_100M;
+  info.duplex   = ARM_ETH_DUPLEX_FULL;
+  info.reserved = 0U;
+  return info;
+}
+
+extern ARM_DRIVER_ETH_PHY ETH_PHY_Driver_(NCM_ETH_DRIVER);
+ARM_DRIVER_ETH_PHY ETH_PHY_Driver_(NCM_ETH_DRIVER) = {
+  PHY_GetVersion,
+  PHY_Initialize,
+  PHY_Uninitialize,
+  PHY_PowerControl,
+  PHY_SetInterface,
+  PHY_SetMode,
+  PHY_GetLinkState,
+  PHY_GetLinkInfo
+};
+
+
+// ==== USB CDC NCM callbacks ====
+
+// Called during USBD_Initialize to initialize the USB CDC class instance (NCM).
+void USBD_CDC1_NCM_Initialize (void) {
+  NCM_ParseMac (USBD_CDC1_NCM_MAC_ADDRESS, ncm_net_addr);
+  ncm_tx_sem = osSemaphoreNew (1U, 1U, NULL);
+}
+
+
+// Called during USBD_Uninitialize to de-initialize the USB CDC class instance (NCM).
+void USBD_CDC1_NCM_Uninitialize (void) {
+  ncm_link = 0U;
+  if (osSemaphoreDelete (ncm_tx_sem) == osOK) {
+    ncm_tx_sem = NULL;
+  }
+}
+
+
+// Called upon USB Bus Reset Event.
+void USBD_CDC1_NCM_Reset (void) {
+  ncm_link         = 0U;
+  ncm_notify       = 0U;
+  ncm_ntb_format   = 0U;
+  ncm_ntb_in_size  = USBD_CDC1_NCM_DW_NTB_IN_MAX_SIZE;
+  ncm_max_datagram = USBD_CDC1_NCM_W_MAX_SEGMENT_SIZE;
+  (void)osSemaphoreRelease (ncm_tx_sem);        // An aborted NTB is not reported
+}
+
+
+// Called when the USB Host activates the NCM data interface (alternate setting 1).
+void USBD_CDC1_NCM_Start (void) {
+  (void)osSemaphoreRelease (ncm_tx_sem);
+  ncm_notify = NCM_NOTIFY_SPEED | NCM_NOTIFY_CONNECT;
+  ncm_link   = 1U;
+}
+
+
+// Called when the USB Host deactivates the NCM data interface (alternate setting 0).
+void USBD_CDC1_NCM_Stop (void) {
+  ncm_link   = 0U;
+  ncm_notify = 0U;
+}
+
+
+// Called upon USB Host request to set the Ethernet device multicast filters.
+// \param[in]   addr_list       pointer to list of 48-bit multicast addresses.
+// \param[in]   num_of_filters  number of filters.
+// \return      true            set Ethernet multicast filter request processed.
+// \return      false           set Ethernet multicast filter request not supported or not processed.
+bool USBD_CDC1_NCM_SetEthernetMulticastFilters (const uint8_t *addr_list, uint16_t num_of_filters) {
+  (void)addr_list;
+  (void)num_of_filters;
+  return true;
+}
+
+
+// Called upon USB Host request to set up the specified Ethernet power management pattern filter.
+// \return      false           not supported (no power filters).
+bool USBD_CDC1_NCM_SetEthernetPowerManagementPatternFilter (uint16_t filter_number, const uint8_t *pattern_filter, uint16_t pattern_filter_size) {
+  (void)filter_number;
+  (void)pattern_filter;
+  (void)pattern_filter_size;
+  return false;
+}
+
+
+// Called upon USB Host request to retrieve the status of the specified Ethernet power management pattern filter.
+// \return      false           not supported (no power filters).
+bool USBD_CDC1_NCM_GetEthernetPowerManagementPatternFilter (uint16_t filter_number, uint16_t *pattern_active) {
+  (void)filter_number;
+  (void)pattern_active;
+  return false;
+}
+
+
+// Called upon USB Host request to configure device Ethernet packet filter settings.
+// \param[in]   packet_filter_bitmap  packet filter bitmap.
+// \return      true            set Ethernet packet filter request processed.
+bool USBD_CDC1_NCM_SetEthernetPacketFilter (uint16_t packet_filter_bitmap) {
+  (void)packet_filter_bitmap;
+  return true;
+}
+
+
+// Called upon USB Host request to retrieve a statistic based on the feature selector.
+// \param[in]   feature_selector  specifies which value is being retrieved.
+// \param[out]  data            pointer to statistics value.
+// \return      true            get Ethernet statistic request processed.
+// \return      false           get Ethernet statistic request not supported or not processed.
+bool USBD_CDC1_NCM_GetEthernetStatistic (uint16_t feature_selector, uint32_t *data) {
+  switch (feature_selector) {
+    case NCM_STAT_XMIT_OK:
+      *data = ncm_tx_frames;
+      return true;
+    case NCM_STAT_RCV_OK:
+      *data = ncm_rx_frames;
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+// Called upon USB Host request to retrieve the parameters that describe NTBs for each direction.
+// \param[out]  ntb_params      pointer to NTB parameter structure.
+// \return      true            get NTB parameters request processed.
+bool USBD_CDC1_NCM_GetNtbParameters (CDC_NCM_NTB_PARAM *ntb_params) {
+  ntb_params->wLength                 = sizeof(CDC_NCM_NTB_PARAM);
+  ntb_params->bmNtbFormatsSupported   = USBD_CDC1_NCM_BM_NTB_FORMATS_SUPPORTED;
+  ntb_params->dwNtbInMaxSize          = USBD_CDC1_NCM_DW_NTB_IN_MAX_SIZE;
+  ntb_params->wNdpInDivisor           = USBD_CDC1_NCM_W_NDP_IN_DIVISOR;
+  ntb_params->wNdpInPayloadRemainder  = USBD_CDC1_NCM_W_NDP_IN_PAYLOAD_REMINDER;
+  ntb_params->wNdpInAlignment         = USBD_CDC1_NCM_W_NDP_IN_ALIGNMENT;
+  ntb_params->Reserved                = 0U;
+  ntb_params->dwNtbOutMaxSize         = USBD_CDC1_NCM_DW_NTB_OUT_MAX_SIZE;
+  ntb_params->wNdpOutDivisor          = USBD_CDC1_NCM_W_NDP_OUT_DIVISOR;
+  ntb_params->wNdpOutPayloadRemainder = USBD_CDC1_NCM_W_NDP_OUT_PAYLOAD_REMINDER;
+  ntb_params->wNdpOutAlignment        = USBD_CDC1_NCM_W_NDP_OUT_ALIGNMENT;
+  ntb_params->wNtbOutMaxDatagrams     = 0U;     // No limit
+  return true;
+}
+
+
+// Called upon USB Host request to return the USB function's current EUI-48 station address.
+// \param[out]  net_addr        pointer to EUI-48 current address, in network byte order.
+// \return      true            get net address request processed.
+bool USBD_CDC1_NCM_GetNetAddress (uint8_t *net_addr) {
+  memcpy(net_addr, ncm_net_addr, 6U);
+  return true;
+}
+
+
+// Called upon USB Host request to set the USB function's current EUI-48 station address.
+// \param[in]   net_addr        pointer to EUI-48 address, in network byte order.
+// \return      true            set net address request processed.
+bool USBD_CDC1_NCM_SetNetAddress (const uint8_t *net_addr) {
+  memcpy(ncm_net_addr, net_addr, 6U);
+  return true;
+}
+
+
+// Called upon USB Host request to return the NTB data format currently being used.
+// \param[out]  ntb_format      pointer to NTB format code.
+// \return      true            get NTB format request processed.
+bool USBD_CDC1_NCM_GetNtbFormat (uint16_t *ntb_format) {
+  *ntb_format = ncm_ntb_format;
+  return true;
+}
+
+
+// Called upon USB Host request to select the format of NTB to be used for NTBs transmitted to the USB Host.
+// \param[in]   ntb_format      NTB format selection: 0 = NTB-16, 1 = NTB-32.
+// \return      true            set NTB format request processed.
+// \return      false           format not supported.
+bool USBD_CDC1_NCM_SetNtbFormat (uint16_t ntb_format) {
+  if ((ntb_format > 1U) || (((USBD_CDC1_NCM_BM_NTB_FORMATS_SUPPORTED >> ntb_format) & 1U) == 0U)) {
+    return false;
+  }
+  ncm_ntb_format = ntb_format;
+  return true;
+}
+
+
+// Called upon USB Host request to return NTB input size currently being used.
+// \param[out]  ntb_input_size  pointer to NTB input size.
+// \return      true            get NTB input size request processed.
+bool USBD_CDC1_NCM_GetNtbInputSize (uint32_t *ntb_input_size) {
+  *ntb_input_size = ncm_ntb_in_size;
+  return true;
+}
+
+
+// Called upon USB Host request to select the maximum size of NTB that is permitted to be sent to the USB Host.
+// \param[in]   ntb_input_size  maximum NTB size.
+// \return      true            set NTB input size request processed.
+// \return      false           size not supported.
+bool USBD_CDC1_NCM_SetNtbInputSize (uint32_t ntb_input_size) {
+  if ((ntb_input_size < 2048U) || (ntb_input_size > USBD_CDC1_NCM_DW_NTB_IN_MAX_SIZE)) {
+    return false;
+  }
+  ncm_ntb_in_size = ntb_input_size;
+  return true;
+}
+
+
+// Called upon USB Host request to return the currently effective maximum datagram size.
+// \param[out]  max_datagram_size  pointer to current maximum datagram size.
+// \return      true            get maximum datagram size request processed.
+bool USBD_CDC1_NCM_GetMaxDatagramSize (uint16_t *max_datagram_size) {
+  *max_datagram_size = ncm_max_datagram;
+  return true;
+}
+
+
+// Called upon USB Host request to select the maximum datagram size that can be sent in an NTB.
+// \param[in]   max_datagram_size  maximum datagram size.
+// \return      true            set maximum datagram size request processed.
+// \return      false           size not supported.
+bool USBD_CDC1_NCM_SetMaxDatagramSize (uint16_t max_datagram_size) {
+  if ((max_datagram_size < 64U) || (max_datagram_size > USBD_CDC1_NCM_W_MAX_SEGMENT_SIZE)) {
+    return false;
+  }
+  ncm_max_datagram = max_datagram_size;
+  return true;
+}
+
+
+// Called upon USB Host request to return the currently selected CRC mode.
+// \param[out]  crc_mode        pointer to current CRC mode.
+// \return      true            get CRC mode request processed.
+bool USBD_CDC1_NCM_GetCrcMode (uint16_t *crc_mode) {
+  *crc_mode = 0U;
+  return true;
+}
+
+
+// Called upon USB Host request to control CRC mode (only "CRC not appended" is supported).
+// \param[in]   crc_mode        CRC mode: 0 = CRCs shall not be appended, 1 = CRCs shall be appended.
+// \return      true            set CRC mode request processed.
+// \return      false           mode not supported.
+bool USBD_CDC1_NCM_SetCrcMode (uint16_t crc_mode) {
+  return (crc_mode == 0U);
+}
+
+
+// Called when NTB was successfully sent.
+void USBD_CDC1_NCM_NTB_IN_Sent (void) {
+  (void)osSemaphoreRelease (ncm_tx_sem);
+}
+
+
+// Called when NTB was successfully received.
+void USBD_CDC1_NCM_NTB_OUT_Received (void) {
+  if ((ncm_cb_event != NULL) && (ncm_rx_enable != 0U)) {
+    ncm_cb_event (ARM_ETH_MAC_EVENT_RX_FRAME);
+  }
+}
+
+#endif /* RTE_USB_Device_CDC_1 && RTE_Network_Interface_ETH_1 */
+
+//! [code_USBD_User_CDC_NCM]
@@ -0,0 +1,1108 @@
+/*------------------------------------------------------------------------------
+ * Name:    VNC_Server.c
+ * Purpose: RFB (VNC) server engine with tile damage tracking
+ *----------------------------------------------------------------------------*/
+/*
+ * Implements the server side of RFB 3.3, 3.7 and 3.8 (security type None)
+ * for one viewer per session; the transport (VNC_TcpServer.c)
+ * accepts connections and runs one session per client thread.
+ *
+ * Damage: the framebuffer is divided into VNC_TILE_SIZE tiles. The LCDConf
+ * draw hooks (fills, rectangle copies, bitmap draws) mark the tiles they
+ * touch in a bitmap per display buffer; when a buffer is flipped to the
+ * display its marks are merged into the pending set of every session.
+ * Before an update the pending tiles are hashed and only tiles whose hash
+ * differs from the hash last sent to that viewer are transmitted. Some
+ * primitives (lines, 1bpp text) are drawn by the CPU without a hook, so
+ * after a flip the whole frame is rehashed as well, at most every
+ * VNC_RESCAN_MS. Identical repaints cost no bandwidth.
+ *
+ * Encoding: a row of adjacent dirty tiles is sent as one rectangle, in
+ * Hextile if the viewer lists it before Raw in SetEncodings (solid tiles
+ * take one byte, two colour tiles are sent as runs, others as coloured
+ * runs or raw, whichever is smaller) and in Raw otherwise. Pixels are
+ * converted through per-session lookup tables to the viewer's pixel
+ * format, so a viewer may reduce the depth (e.g. 8 bit BGR233). A
+ * SetPixelFormat the tables cannot follow (colour map, colours outside
+ * the pixel) closes the session.
+ *
+ * Shared encoding: viewers with the same pixel format would encode the
+ * same tiles of a frame. A Hextile session therefore takes a reference to
+ * one of VNC_ENC_BUFS shared buffers for its format during an update.
+ * Each tile is encoded once into the buffer's SDRAM arena, tagged with
+ * the hash of the pixels it was encoded from, and every session whose
+ * tile hash matches copies it from there. Shared tiles do not depend on
+ * the previous tile (they always carry their background). The arena only
+ * grows while it is referenced, so copies need no lock; it is emptied
+ * when no session holds it and it is more than half full. A tile that
+ * does not fit, or a session without a free buffer, encodes privately.
+ *
+ * Pacing: an update is started only when the previous one has been
+ * acknowledged (the transport reports the bytes in flight), at most
+ * VNC_FPS_MAX times per second and VNC_INTERVAL_MIN after the
+ * acknowledge. Damage keeps accumulating meanwhile, so a slow link gets
+ * fewer, merged updates instead of a backlog in the network memory pool.
+ * An update that is due while data is still in flight counts as a stall.
+ * A transport flagged VNC_TR_UNPACED gets an update for every request, so
+ * a loopback measures the encoder instead of the rate limits.
+ *
+ * Frames are read from the displayed buffer while emWin draws into the
+ * back buffers. A tile that changes while it is read (a buffer is reused
+ * after a flip) is detected by rehashing and sent again.
+ */
+
+#include <string.h>
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+#include "cmsis_os2.h"
+
+#include "GUI.h"
+#include "VNC_Server.h"
+#include "Prof.h"
+#include "AppEvr.h"
+
+// Client to server messages
+#define RFB_SET_PIXEL_FORMAT    (0U)
+#define RFB_SET_ENCODINGS       (2U)
+#define RFB_UPDATE_REQUEST      (3U)
+#define RFB_KEY_EVENT           (4U)
+#define RFB_POINTER_EVENT       (5U)
+#define RFB_CLIENT_CUT_TEXT     (6U)
+
+// Encodings
+#define RFB_ENC_RAW             (0U)
+#define RFB_ENC_HEXTILE         (5U)
+
+// Hextile subencoding flags
+#define HT_RAW                  (1U << 0)
+#define HT_BACKGROUND           (1U << 1)
+#define HT_FOREGROUND           (1U << 2)
+#define HT_ANY_SUBRECTS         (1U << 3)
+#define HT_COLOURED             (1U << 4)
+
+typedef struct {
+  uint32_t bg;                  // Background colour of the previous tile
+  uint32_t bg_valid;
+} VNC_Hextile;
+
+// Hextile encoding of one tile, worked out before it is written
+typedef struct {
+  uint32_t flags;
+  uint32_t bg;
+  uint32_t fg;
+  uint32_t n;                   // Subrectangles
+  uint32_t size;                // Encoded bytes
+  uint32_t hash;                // _Hash of the pixels read
+} VNC_TileInfo;
+
+typedef struct {
+  uint32_t hash;                // Hash of the encoded pixels
+  uint32_t off;                 // Offset in the arena
+  uint32_t len;                 // Encoded bytes, 0 if not encoded
+} VNC_EncTile;
+
+// Shared Hextile encoding of one pixel format
+typedef struct {
+  VNC_PixelFormat pf;           // bpp 0: unused
+  uint32_t        refs;         // Sessions in an update with this format
+  uint32_t        used;         // Arena bytes used
+  VNC_EncTile     tile[VNC_TILES];
+  uint8_t         arena[VNC_ENC_ARENA_SIZE];
+} VNC_EncBuf;
+
+static int                       vnc_xsize;
+static int                       vnc_ysize;
+static int                       vnc_tiles_x;
+static int                       vnc_tiles_y;
+static const uint16_t * volatile vnc_frame;     // Displayed buffer
+static volatile uint32_t         vnc_frames;    // Flip counter
+static uint32_t                  vnc_marks[VNC_FB_BUFFERS][VNC_TILE_WORDS];
+static VNC_Session * volatile    vnc_session[VNC_SESSIONS_MAX];
+static osMutexId_t               vnc_input_mutex;
+static osMutexId_t               vnc_enc_mutex;
+static VNC_EncBuf                vnc_enc[VNC_ENC_BUFS] __attribute__((section(".bss.sdram"), aligned(32)));
+
+// Server pixel format: RGB565, little endian
+static const uint8_t vnc_native_pf[16] = {
+  16U, 16U, 0U, 1U, 0U, 31U, 0U, 63U, 0U, 31U, 11U, 5U, 0U, 0U, 0U, 0U
+};
+
+// X11 keysyms of the emWin control keys
+static const struct {
+  uint16_t sym;
+  uint16_t key;
+} vnc_keys[] = {
+  { 0xFF08U, GUI_KEY_BACKSPACE },
+  { 0xFF09U, GUI_KEY_TAB       },
+  { 0xFF0DU, GUI_KEY_ENTER     },
+  { 0xFF8DU, GUI_KEY_ENTER     },   // Keypad Enter
+  { 0xFF1BU, GUI_KEY_ESCAPE    },
+  { 0xFF50U, GUI_KEY_HOME      },
+  { 0xFF51U, GUI_KEY_LEFT      },
+  { 0xFF52U, GUI_KEY_UP        },
+  { 0xFF53U, GUI_KEY_RIGHT     },
+  { 0xFF54U, GUI_KEY_DOWN      },
+  { 0xFF55U, GUI_KEY_PGUP      },
+  { 0xFF56U, GUI_KEY_PGDOWN    },
+  { 0xFF57U, GUI_KEY_END       },
+  { 0xFF63U, GUI_KEY_INSERT    },
+  { 0xFFFFU, GUI_KEY_DELETE    },
+  { 0xFFE1U, GUI_KEY_SHIFT     },
+  { 0xFFE2U, GUI_KEY_SHIFT     },
+  { 0xFFE3U, GUI_KEY_CONTROL   },
+  { 0xFFE4U, GUI_KEY_CONTROL   }
+};
+
+static uint32_t _Get16 (const uint8_t *p) {
+  return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static uint32_t _Get32 (const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint8_t *_Put16 (uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+  return &p[2];
+}
+
+static uint8_t *_Put32 (uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+  return &p[4];
+}
+
+// ==== Output ====
+
+// Send the encoded data.
+static void _Flush (VNC_Session *s) {
+  if ((s->out != NULL) && (s->out_len != 0U)) {
+    if (s->tr->Send(s->conn, s->out, s->out_len) != 0) {
+      s->error = 1U;
+    }
+    s->stats.bytes += s->out_len;
+    s->win_bytes   += s->out_len;
+  }
+  s->out     = NULL;
+  s->out_len = 0U;
+}
+
+// Space for len bytes of output; the caller advances out_len.
+// \return      write position, NULL on transport error
+static uint8_t *_Space (VNC_Session *s, uint32_t len) {
+  if ((s->out == NULL) || ((s->out_len + len) > s->out_size)) {
+    _Flush(s);
+    if (s->error == 0U) {
+      s->out = s->tr->GetBuf(s->conn, &s->out_size);
+    }
+    if ((s->out == NULL) || (s->out_size < len)) {
+      s->out   = NULL;
+      s->error = 1U;
+      return NULL;
+    }
+  }
+  return &s->out[s->out_len];
+}
+
+static void _Write (VNC_Session *s, const void *buf, uint32_t len) {
+  uint8_t *p;
+
+  p = _Space(s, len);
+  if (p != NULL) {
+    memcpy(p, buf, len);
+    s->out_len += len;
+  }
+}
+
+// ==== Input ====
+
+// Receive exactly len bytes within VNC_HANDSHAKE_TIMEOUT.
+static int _Read (VNC_Session *s, uint8_t *buf, uint32_t len) {
+  uint32_t start;
+  int32_t  n;
+
+  start = osKernelGetTickCount();
+  while (len != 0U) {
+    n = s->tr->Recv(s->conn, buf, len);
+    if (n < 0) {
+      return -1;
+    }
+    if (n == 0) {
+      if ((osKernelGetTickCount() - start) >= VNC_HANDSHAKE_TIMEOUT) {
+        return -1;
+      }
+      (void)osThreadFlagsWait(VNC_FLAG_WAKE, osFlagsWaitAny, VNC_POLL_MS);
+      continue;
+    }
+    buf += n;
+    len -= (uint32_t)n;
+  }
+  return 0;
+}
+
+// ==== Pixel format ====
+
+// Set the client pixel format from its 16 byte wire representation.
+// \return      0 on success, -1 for a colour map format or if a colour
+//              does not fit into the pixel
+static int _SetPixelFormat (VNC_Session *s, const uint8_t *pf) {
+  VNC_PixelFormat *f = &s->pf;
+  uint32_t         c, v, bits, max;
+
+  if ((pf[0] != 8U) && (pf[0] != 16U) && (pf[0] != 32U)) {
+    return -1;
+  }
+  if (pf[3] == 0U) {
+    return -1;                          // Colour maps are not supported
+  }
+  // Shifts and maxima come from the viewer: every colour must fit
+  for (c = 0U; c < 3U; c++) {
+    if ((pf[10U + c] >= pf[0]) ||
+        ((((uint64_t)_Get16(&pf[4U + (2U * c)]) << pf[10U + c]) >> pf[0]) != 0U)) {
+      return -1;
+    }
+  }
+  f->bpp         = pf[0];
+  f->depth       = pf[1];
+  f->big_endian  = pf[2];
+  f->true_colour = pf[3];
+  for (c = 0U; c < 3U; c++) {
+    f->max[c]   = (uint16_t)_Get16(&pf[4U + (2U * c)]);
+    f->shift[c] = pf[10U + c];
+    bits = (c == 1U) ? 6U : 5U;
+    max  = (1U << bits) - 1U;
+    for (v = 0U; v <= max; v++) {
+      s->lut[c][v] = (((v * f->max[c]) + (max / 2U)) / max) << f->shift[c];
+    }
+  }
+  return 0;
+}
+
+static uint32_t _Pixel (const VNC_Session *s, uint32_t rgb565) {
+  return s->lut[0][rgb565 >> 11] | s->lut[1][(rgb565 >> 5) & 0x3FU] | s->lut[2][rgb565 & 0x1FU];
+}
+
+static uint8_t *_PutPixel (const VNC_Session *s, uint8_t *p, uint32_t v) {
+  switch (s->pf.bpp) {
+    case 8U:
+      *p++ = (uint8_t)v;
+      break;
+    case 16U:
+      if (s->pf.big_endian != 0U) {
+        p = _Put16(p, v);
+      } else {
+        *p++ = (uint8_t)v;
+        *p++ = (uint8_t)(v >> 8);
+      }
+      break;
+    default:
+      if (s->pf.big_endian != 0U) {
+        p = _Put32(p, v);
+      } else {
+        *p++ = (uint8_t)v;
+        *p++ = (uint8_t)(v >> 8);
+        *p++ = (uint8_t)(v >> 16);
+        *p++ = (uint8_t)(v >> 24);
+      }
+      break;
+  }
+  return p;
+}
+
+// ==== Damage ====
+
+static void _TileRect (int t, int *x, int *y, int *w, int *h) {
+  *x = (t % vnc_tiles_x) * VNC_TILE_SIZE;
+  *y = (t / vnc_tiles_x) * VNC_TILE_SIZE;
+  *w = ((vnc_xsize - *x) < VNC_TILE_SIZE) ? (vnc_xsize - *x) : VNC_TILE_SIZE;
+  *h = ((vnc_ysize - *y) < VNC_TILE_SIZE) ? (vnc_ysize - *y) : VNC_TILE_SIZE;
+}
+
+static uint32_t _Hash (const uint16_t *fb, int t) {
+  const uint16_t *p;
+  uint32_t        h;
+  int             x, y, w, h_, i, j;
+
+  _TileRect(t, &x, &y, &w, &h_);
+  h = 2166136261U;                      // FNV-1a
+  for (j = 0; j < h_; j++) {
+    p = &fb[((y + j) * vnc_xsize) + x];
+    for (i = 0; i < w; i++) {
+      h = (h ^ p[i]) * 16777619U;
+    }
+  }
+  return h;
+}
+
+static void _SetTiles (uint32_t *map, int x0, int y0, int x1, int y1) {
+  int tx, ty, t;
+
+  if (x0 < 0) { x0 = 0; }
+  if (y0 < 0) { y0 = 0; }
+  if (x1 >= vnc_xsize) { x1 = vnc_xsize - 1; }
+  if (y1 >= vnc_ysize) { y1 = vnc_ysize - 1; }
+  if ((x1 < x0) || (y1 < y0)) {
+    return;
+  }
+  for (ty = y0 / VNC_TILE_SIZE; ty <= (y1 / VNC_TILE_SIZE); ty++) {
+    for (tx = x0 / VNC_TILE_SIZE; tx <= (x1 / VNC_TILE_SIZE); tx++) {
+      t = (ty * vnc_tiles_x) + tx;
+      map[t >> 5] |= 1U << (t & 31);
+    }
+  }
+}
+
+static uint32_t _IsSet (const uint32_t *map, int t) {
+  return (map[t >> 5] >> (t & 31)) & 1U;
+}
+
+// ==== Encoders ====
+
+static void _EncodeRaw (VNC_Session *s, const uint16_t *fb, int x, int y, int w, int h) {
+  const uint16_t *src;
+  uint8_t        *p, *q;
+  uint32_t        bytes;
+  int             i, j, n, k;
+
+  bytes = s->pf.bpp / 8U;
+  for (j = 0; j < h; j++) {
+    src = &fb[((y + j) * vnc_xsize) + x];
+    for (i = 0; i < w; i += n) {
+      n = ((w - i) < VNC_TILE_SIZE) ? (w - i) : VNC_TILE_SIZE;
+      p = _Space(s, (uint32_t)n * bytes);
+      if (p == NULL) {
+        return;
+      }
+      q = p;
+      for (k = 0; k < n; k++) {
+        q = _PutPixel(s, q, _Pixel(s, src[i + k]));
+      }
+      s->out_len += (uint32_t)(q - p);
+    }
+  }
+}
+
+// Horizontal runs of pixels other than bg in a w x h tile; emitted as
+// Hextile subrects (with their colour if coloured is set) when p != NULL.
+// \return      number of runs
+static uint32_t _Runs (const VNC_Session *s, int w, int h, uint32_t bg, uint32_t coloured, uint8_t **p) {
+  const uint32_t *row;
+  uint32_t        n, c;
+  int             x, y, x0;
+
+  n = 0U;
+  for (y = 0; y < h; y++) {
+    row = &s->px[y * w];
+    for (x = 0; x < w; ) {
+      c = row[x];
+      if (c == bg) {
+        x++;
+        continue;
+      }
+      for (x0 = x; (x < w) && (row[x] == c); x++) {}
+      if (p != NULL) {
+        if (coloured != 0U) {
+          *p = _PutPixel(s, *p, c);
+        }
+        *(*p)++ = (uint8_t)((x0 << 4) | y);
+        *(*p)++ = (uint8_t)((x - x0 - 1) << 4);
+      }
+      n++;
+    }
+  }
+  return n;
+}
+
+// Convert a tile into s->px and choose its Hextile subencoding.
+static void _ScanTile (VNC_Session *s, const VNC_Hextile *ht, const uint16_t *fb, int x, int y, int w, int h, VNC_TileInfo *ti) {
+  const uint16_t *src;
+  uint32_t        bytes, bg, fg, colours, nbg, nfg, n, flags, raw, size, hash;
+  int             i, j, k;
+
+  // Convert the tile and count up to 3 colours
+  bg      = _Pixel(s, fb[(y * vnc_xsize) + x]);
+  fg      = bg;
+  colours = 1U;
+  nbg     = 0U;
+  nfg     = 0U;
+  hash    = 2166136261U;                // As _Hash
+  for (j = 0, k = 0; j < h; j++) {
+    src = &fb[((y + j) * vnc_xsize) + x];
+    for (i = 0; i < w; i++, k++) {
+      hash     = (hash ^ src[i]) * 16777619U;
+      s->px[k] = _Pixel(s, src[i]);
+      if (s->px[k] == bg) {
+        nbg++;
+      } else if (colours == 1U) {
+        fg = s->px[k];
+        colours = 2U;
+        nfg++;
+      } else if (s->px[k] == fg) {
+        nfg++;
+      } else {
+        colours = 3U;
+      }
+    }
+  }
+
+  bytes = s->pf.bpp / 8U;
+  raw   = 1U + ((uint32_t)(w * h) * bytes);
+  if (colours == 2U) {
+    if (nfg > nbg) {                    // Runs of the minority colour
+      n = bg; bg = fg; fg = n;
+    }
+  }
+  flags = ((ht->bg_valid != 0U) && (ht->bg == bg)) ? 0U : HT_BACKGROUND;
+  size  = 1U + (((flags & HT_BACKGROUND) != 0U) ? bytes : 0U);
+
+  if (colours == 1U) {
+    n = 0U;
+  } else {
+    n = _Runs(s, w, h, bg, 0U, NULL);
+    flags |= HT_ANY_SUBRECTS;
+    if (colours == 2U) {
+      flags |= HT_FOREGROUND;
+      size  += bytes + 1U + (2U * n);
+    } else {
+      flags |= HT_COLOURED;
+      size  += 1U + ((bytes + 2U) * n);
+    }
+    if ((n > 255U) || (size >= raw)) {
+      flags = HT_RAW;
+      size  = raw;
+    }
+  }
+  ti->flags = flags;
+  ti->bg    = bg;
+  ti->fg    = fg;
+  ti->n     = n;
+  ti->size  = size;
+  ti->hash  = hash;
+}
+
+// Write a tile chosen by _ScanTile (ti->size bytes at q).
+// \return      end of the tile
+static uint8_t *_PutTile (VNC_Session *s, VNC_Hextile *ht, const VNC_TileInfo *ti, int w, int h, uint8_t *q) {
+  int k;
+
+  *q++ = (uint8_t)ti->flags;
+  if (ti->flags == HT_RAW) {
+    for (k = 0; k < (w * h); k++) {
+      q = _PutPixel(s, q, s->px[k]);
+    }
+    ht->bg_valid = 0U;
+  } else {
+    if ((ti->flags & HT_BACKGROUND) != 0U) {
+      q = _PutPixel(s, q, ti->bg);
+    }
+    if ((ti->flags & HT_FOREGROUND) != 0U) {
+      q = _PutPixel(s, q, ti->fg);
+    }
+    if ((ti->flags & HT_ANY_SUBRECTS) != 0U) {
+      *q++ = (uint8_t)ti->n;
+      (void)_Runs(s, w, h, ti->bg, ti->flags & HT_COLOURED, &q);
+    }
+    ht->bg       = ti->bg;
+    ht->bg_valid = 1U;
+  }
+  return q;
+}
+
+static void _EncodeTile (VNC_Session *s, VNC_Hextile *ht, const uint16_t *fb, int x, int y, int w, int h) {
+  VNC_TileInfo ti;
+  uint8_t     *p, *q;
+
+  _ScanTile(s, ht, fb, x, y, w, h, &ti);
+  p = _Space(s, ti.size);
+  if (p == NULL) {
+    return;
+  }
+  q = _PutTile(s, ht, &ti, w, h, p);
+  s->out_len += (uint32_t)(q - p);
+}
+
+// ==== Shared encoding ====
+
+static uint32_t _SameFormat (const VNC_PixelFormat *a, const VNC_PixelFormat *b) {
+  uint32_t c;
+
+  if ((a->bpp != b->bpp) || (a->big_endian != b->big_endian)) {
+    return 0U;
+  }
+  for (c = 0U; c < 3U; c++) {
+    if ((a->max[c] != b->max[c]) || (a->shift[c] != b->shift[c])) {
+      return 0U;
+    }
+  }
+  return 1U;
+}
+
+static void _EncReset (VNC_EncBuf *b) {
+  b->used = 0U;
+  memset(b->tile, 0, sizeof(b->tile));
+}
+
+// Take a reference to the shared encoding of the session's pixel format.
+// \return      shared buffer, NULL if none is free
+static VNC_EncBuf *_EncAcquire (const VNC_Session *s) {
+  VNC_EncBuf *b, *free_buf;
+  int         i;
+
+  free_buf = NULL;
+  (void)osMutexAcquire(vnc_enc_mutex, osWaitForever);
+  for (i = 0; i < VNC_ENC_BUFS; i++) {
+    b = &vnc_enc[i];
+    if ((b->pf.bpp != 0U) && (_SameFormat(&b->pf, &s->pf) != 0U)) {
+      if ((b->refs == 0U) && (b->used > (VNC_ENC_ARENA_SIZE / 2U))) {
+        _EncReset(b);
+      }
+      b->refs++;
+      (void)osMutexRelease(vnc_enc_mutex);
+      return b;
+    }
+    if ((b->refs == 0U) && ((free_buf == NULL) || (b->pf.bpp == 0U))) {
+      free_buf = b;
+    }
+  }
+  if (free_buf != NULL) {
+    free_buf->pf   = s->pf;
+    free_buf->refs = 1U;
+    _EncReset(free_buf);
+  }
+  (void)osMutexRelease(vnc_enc_mutex);
+  return free_buf;
+}
+
+static void _EncRelease (VNC_EncBuf *b) {
+  (void)osMutexAcquire(vnc_enc_mutex, osWaitForever);
+  b->refs--;
+  (void)osMutexRelease(vnc_enc_mutex);
+}
+
+// Send tile t (hash s->hash[t]) from the shared encoding, encoding it
+// into the arena first if no session has done so for these pixels.
+// \return      0 if sent, -1 if it must be encoded privately
+static int _EncShared (VNC_Session *s, VNC_EncBuf *b, const uint16_t *fb, int t, int x, int y, int w, int h) {
+  VNC_EncTile *e;
+  VNC_TileInfo ti;
+  VNC_Hextile  ht;
+  uint32_t     off, len, hash;
+  uint8_t     *p, *q;
+
+  (void)osMutexAcquire(vnc_enc_mutex, osWaitForever);
+  e = &b->tile[t];
+  if ((e->len == 0U) || (e->hash != s->hash[t])) {
+    ht.bg_valid = 0U;                   // Independent of the previous tile
+    _ScanTile(s, &ht, fb, x, y, w, h, &ti);
+    if ((b->used + ti.size) > VNC_ENC_ARENA_SIZE) {
+      (void)osMutexRelease(vnc_enc_mutex);
+      return -1;
+    }
+    q = _PutTile(s, &ht, &ti, w, h, &b->arena[b->used]);
+    e->hash  = ti.hash;
+    e->off   = b->used;
+    e->len   = (uint32_t)(q - &b->arena[b->used]);
+    b->used += e->len;
+  }
+  off  = e->off;
+  len  = e->len;
+  hash = e->hash;
+  (void)osMutexRelease(vnc_enc_mutex);
+
+  // The tile changed since it was hashed: send it again next time
+  if (hash != s->hash[t]) {
+    s->forced[t >> 5] |= 1U << (t & 31);
+  }
+  p = _Space(s, len);
+  if (p != NULL) {
+    memcpy(p, &b->arena[off], len);
+    s->out_len += len;
+    s->stats.shared++;
+  }
+  return 0;
+}
+
+// ==== Updates ====
+
+// Send the tiles that changed since the last update.
+static void _Update (VNC_Session *s) {
+  const uint16_t *fb;
+  VNC_Hextile     ht;
+  VNC_EncBuf     *enc;
+  uint32_t        hint[VNC_TILE_WORDS], dirty[VNC_TILE_WORDS];
+  uint32_t        frames, full, tick, h, rects;
+  uint8_t        *p;
+  int             t, t0, tx, ty, x, y, w, h_, i, n;
+
+  fb = vnc_frame;
+  if (fb == NULL) {
+    return;
+  }
+  tick = osKernelGetTickCount();
+  full = 0U;
+  __disable_irq();
+  frames = vnc_frames;
+  for (i = 0; i < VNC_TILE_WORDS; i++) {
+    hint[i]       = s->pending[i];
+    s->pending[i] = 0U;
+  }
+  if ((s->rescan != 0U) && ((tick - s->rescan_tick) >= VNC_RESCAN_MS)) {
+    s->rescan = 0U;
+    full      = 1U;
+  }
+  __enable_irq();
+  if (full != 0U) {
+    s->rescan_tick = tick;
+  }
+
+  // Dirty: forced tiles and tiles whose content changed
+  memset(dirty, 0, sizeof(dirty));
+  rects = 0U;
+  for (ty = 0; ty < vnc_tiles_y; ty++) {
+    for (tx = 0, t0 = -1; tx < vnc_tiles_x; tx++) {
+      t = (ty * vnc_tiles_x) + tx;
+      if ((full != 0U) || (_IsSet(hint, t) != 0U) || (_IsSet(s->forced, t) != 0U)) {
+        h = _Hash(fb, t);
+        if ((h != s->hash[t]) || (_IsSet(s->forced, t) != 0U)) {
+          s->hash[t] = h;
+          dirty[t >> 5] |= 1U << (t & 31);
+          if (t0 < 0) {
+            t0 = tx;
+            rects++;
+          }
+          continue;
+        }
+      }
+      t0 = -1;
+    }
+  }
+  memset(s->forced, 0, sizeof(s->forced));
+  if (rects == 0U) {
+    return;                             // Keep the request until a change
+  }
+
+  // FramebufferUpdate: one rectangle per run of dirty tiles in a tile row
+  p = _Space(s, 4U);
+  if (p == NULL) {
+    return;
+  }
+  p[0] = 0U;
+  p[1] = 0U;
+  (void)_Put16(&p[2], rects);
+  s->out_len += 4U;
+  enc = NULL;
+  if ((s->encoding == RFB_ENC_HEXTILE) && (s->private_enc == 0U)) {
+    enc = _EncAcquire(s);
+  }
+  for (ty = 0; (ty < vnc_tiles_y) && (s->error == 0U); ty++) {
+    for (tx = 0; (tx < vnc_tiles_x) && (s->error == 0U); ) {
+      t = (ty * vnc_tiles_x) + tx;
+      if (_IsSet(dirty, t) == 0U) {
+        tx++;
+        continue;
+      }
+      for (t0 = tx; (tx < vnc_tiles_x) && (_IsSet(dirty, t + (tx - t0)) != 0U); tx++) {}
+      _TileRect(t, &x, &y, &w, &h_);
+      w = (((tx * VNC_TILE_SIZE) < vnc_xsize) ? (tx * VNC_TILE_SIZE) : vnc_xsize) - x;
+      p = _Space(s, 12U);
+      if (p == NULL) {
+        break;
+      }
+      p = _Put16(p, (uint32_t)x);
+      p = _Put16(p, (uint32_t)y);
+      p = _Put16(p, (uint32_t)w);
+      p = _Put16(p, (uint32_t)h_);
+      (void)_Put32(p, s->encoding);
+      s->out_len += 12U;
+      if (s->encoding == RFB_ENC_HEXTILE) {
+        ht.bg_valid = 0U;
+        for (i = 0; i < w; i += VNC_TILE_SIZE) {
+          n = ((w - i) < VNC_TILE_SIZE) ? (w - i) : VNC_TILE_SIZE;
+          if ((enc != NULL) && (_EncShared(s, enc, fb, t + (i / VNC_TILE_SIZE), x + i, y, n, h_) == 0)) {
+            ht.bg_valid = 0U;           // Background of the shared tile unknown here
+          } else {
+            _EncodeTile(s, &ht, fb, x + i, y, n, h_);
+          }
+        }
+      } else {
+        _EncodeRaw(s, fb, x, y, w, h_);
+      }
+    }
+  }
+  if (enc != NULL) {
+    _EncRelease(enc);
+  }
+  _Flush(s);
+  s->update_req = 0U;
+  s->busy       = 1U;
+  s->stalled    = 0U;
+  s->start_tick = tick;
+  s->stats.updates++;
+  s->win_updates++;
+
+  // The buffer may have been reused while it was read: resend torn tiles
+  if (vnc_frames != frames) {
+    for (t = 0; t < (vnc_tiles_x * vnc_tiles_y); t++) {
+      if ((_IsSet(dirty, t) != 0U) && (_Hash(fb, t) != s->hash[t])) {
+        s->forced[t >> 5] |= 1U << (t & 31);
+      }
+    }
+  }
+}
+
+// Track the acknowledge of the last update and the rates over the last second.
+static void _Track (VNC_Session *s, uint32_t tick) {
+  uint32_t dt;
+
+  s->stats.inflight = s->tr->InFlight(s->conn);
+  if ((s->busy != 0U) && (s->stats.inflight == 0U)) {
+    s->busy       = 0U;
+    s->drain_tick = tick;
+  }
+  dt = tick - s->win_tick;
+  if (dt >= 1000U) {
+    s->stats.fps         = ((s->win_updates * 1000U) + (dt / 2U)) / dt;
+    s->stats.bytes_per_s = (uint32_t)(((uint64_t)s->win_bytes * 1000U) / dt);
+    s->win_tick    = tick;
+    s->win_updates = 0U;
+    s->win_bytes   = 0U;
+  }
+}
+
+// An update may be started: previous one acknowledged, rate limits met.
+static uint32_t _Due (VNC_Session *s, uint32_t tick) {
+  if (s->unpaced != 0U) {
+    return 1U;
+  }
+  if ((tick - s->start_tick) < (1000U / VNC_FPS_MAX)) {
+    return 0U;
+  }
+  if (s->busy != 0U) {
+    if (s->stalled == 0U) {
+      s->stalled = 1U;
+      s->stats.stalls++;
+    }
+    return 0U;
+  }
+  return ((tick - s->drain_tick) >= VNC_INTERVAL_MIN) ? 1U : 0U;
+}
+
+// ==== Client messages ====
+
+static void _SetEncodings (VNC_Session *s, const uint8_t *list, uint32_t num) {
+  uint32_t i, enc;
+
+  s->encoding = RFB_ENC_RAW;
+  for (i = 0U; i < num; i++) {
+    enc = _Get32(&list[4U * i]);
+    if ((enc == RFB_ENC_RAW) || (enc == RFB_ENC_HEXTILE)) {
+      s->encoding = enc;                // First supported in preference order
+      break;
+    }
+  }
+}
+
+static void _KeyEvent (uint32_t down, uint32_t sym) {
+  uint32_t i;
+  int      key;
+
+  key = 0;
+  if ((sym >= 0x20U) && (sym <= 0xFFU)) {
+    key = (int)sym;                     // Latin-1
+  } else {
+    for (i = 0U; i < (sizeof(vnc_keys) / sizeof(vnc_keys[0])); i++) {
+      if (vnc_keys[i].sym == sym) {
+        key = vnc_keys[i].key;
+        break;
+      }
+    }
+  }
+  if (key != 0) {
+    (void)osMutexAcquire(vnc_input_mutex, osWaitForever);
+    GUI_StoreKeyMsg(key, (down != 0U) ? 1 : 0);
+    (void)osMutexRelease(vnc_input_mutex);
+  }
+}
+
+static void _PointerEvent (uint32_t mask, int x, int y) {
+  GUI_PID_STATE state;
+
+  state.x       = (x < vnc_xsize) ? x : (vnc_xsize - 1);
+  state.y       = (y < vnc_ysize) ? y : (vnc_ysize - 1);
+  state.Pressed = (U8)(mask & 1U);
+  state.Layer   = 0U;
+  (void)osMutexAcquire(vnc_input_mutex, osWaitForever);
+  GUI_PID_StoreState(&state);
+  (void)osMutexRelease(vnc_input_mutex);
+}
+
+// Process the complete messages in the receive buffer.
+static int _Parse (VNC_Session *s) {
+  const uint8_t *m;
+  uint32_t       pos, avail, len, num, fit;
+
+  for (pos = 0U; pos < s->rx_len; pos += len) {
+    avail = s->rx_len - pos;
+    m     = &s->rx[pos];
+    if (s->rx_skip != 0U) {
+      len = (s->rx_skip < avail) ? s->rx_skip : avail;
+      s->rx_skip -= len;
+      continue;
+    }
+    switch (m[0]) {
+      case RFB_SET_PIXEL_FORMAT: len = 20U; break;
+      case RFB_SET_ENCODINGS:    len = 4U;  break;
+      case RFB_UPDATE_REQUEST:   len = 10U; break;
+      case RFB_KEY_EVENT:        len = 8U;  break;
+      case RFB_POINTER_EVENT:    len = 6U;  break;
+      case RFB_CLIENT_CUT_TEXT:  len = 8U;  break;
+      default:
+        return -1;
+    }
+    num = 0U;
+    if ((m[0] == RFB_SET_ENCODINGS) && (avail >= 4U)) {
+      // Encodings that do not fit into the buffer are discarded
+      num = _Get16(&m[2]);
+      fit = (VNC_RX_SIZE - 4U) / 4U;
+      if (num > fit) {
+        s->rx_skip = 4U * (num - fit);
+        num = fit;
+      }
+      len += 4U * num;
+    }
+    if (avail < len) {
+      if (m[0] == RFB_SET_ENCODINGS) {
+        s->rx_skip = 0U;
+      }
+      break;
+    }
+    switch (m[0]) {
+      case RFB_SET_PIXEL_FORMAT:
+        if (_SetPixelFormat(s, &m[4]) != 0) {
+          return -1;                    // Invalid format: close the session
+        }
+        break;
+      case RFB_SET_ENCODINGS:
+        _SetEncodings(s, &m[4], num);
+        break;
+      case RFB_UPDATE_REQUEST:
+        if (m[1] == 0U) {               // Not incremental: resend the area
+          _SetTiles(s->forced, (int)_Get16(&m[2]), (int)_Get16(&m[4]),
+                    (int)(_Get16(&m[2]) + _Get16(&m[6])) - 1,
+                    (int)(_Get16(&m[4]) + _Get16(&m[8])) - 1);
+        }
+        s->update_req = 1U;
+        break;
+      case RFB_KEY_EVENT:
+        _KeyEvent(m[1], _Get32(&m[4]));
+        break;
+      case RFB_POINTER_EVENT:
+        _PointerEvent(m[1], (int)_Get16(&m[2]), (int)_Get16(&m[4]));
+        break;
+      default:                          // Cut text is ignored
+        s->rx_skip = _Get32(&m[4]);
+        break;
+    }
+  }
+  memmove(s->rx, &s->rx[pos], s->rx_len - pos);
+  s->rx_len -= pos;
+  return 0;
+}
+
+// ==== Session ====
+
+// Protocol version, security and initialisation messages.
+static int _Handshake (VNC_Session *s) {
+  static const uint8_t name[] = VNC_DESKTOP_NAME;
+  uint8_t  buf[12];
+  uint8_t *p;
+  uint32_t minor;
+
+  _Write(s, "RFB 003.008\n", 12U);
+  _Flush(s);
+  if ((s->error != 0U) || (_Read(s, buf, 12U) != 0) || (memcmp(buf, "RFB 003.", 8U) != 0)) {
+    return -1;
+  }
+  minor = ((buf[8] - '0') * 100U) + ((buf[9] - '0') * 10U) + (buf[10] - '0');
+  if (minor >= 7U) {
+    _Write(s, "\x01\x01", 2U);          // One security type: None
+    _Flush(s);
+    if ((s->error != 0U) || (_Read(s, buf, 1U) != 0) || (buf[0] != 1U)) {
+      return -1;
+    }
+    if (minor >= 8U) {
+      _Write(s, "\0\0\0\0", 4U);        // SecurityResult OK
+    }
+  } else {
+    _Write(s, "\0\0\0\x01", 4U);        // RFB 3.3: security type None
+  }
+  _Flush(s);
+  if ((s->error != 0U) || (_Read(s, buf, 1U) != 0)) {     // ClientInit
+    return -1;
+  }
+
+  // ServerInit
+  p = _Space(s, 24U + sizeof(name) - 1U);
+  if (p == NULL) {
+    return -1;
+  }
+  p = _Put16(p, (uint32_t)vnc_xsize);
+  p = _Put16(p, (uint32_t)vnc_ysize);
+  memcpy(p, vnc_native_pf, 16U);
+  p = _Put32(&p[16], sizeof(name) - 1U);
+  memcpy(p, name, sizeof(name) - 1U);
+  s->out_len += 24U + sizeof(name) - 1U;
+  _Flush(s);
+  return (s->error != 0U) ? -1 : 0;
+}
+
+static int _Register (VNC_Session *s) {
+  int i;
+
+  for (i = 0; i < VNC_SESSIONS_MAX; i++) {
+    __disable_irq();
+    if (vnc_session[i] == NULL) {
+      vnc_session[i] = s;
+      __enable_irq();
+      return i;
+    }
+    __enable_irq();
+  }
+  return -1;
+}
+
+int VNC_Server_Initialize (int xSize, int ySize) {
+  int i;
+
+  if ((xSize <= 0) || (xSize > VNC_XSIZE_MAX) || (ySize <= 0) || (ySize > VNC_YSIZE_MAX)) {
+    return -1;
+  }
+  vnc_input_mutex = osMutexNew(NULL);
+  vnc_enc_mutex   = osMutexNew(NULL);
+  if ((vnc_input_mutex == NULL) || (vnc_enc_mutex == NULL)) {
+    return -1;
+  }
+  for (i = 0; i < VNC_ENC_BUFS; i++) {  // SDRAM is not initialized
+    vnc_enc[i].pf.bpp = 0U;
+    vnc_enc[i].refs   = 0U;
+  }
+  vnc_xsize   = xSize;
+  vnc_ysize   = ySize;
+  vnc_tiles_x = (xSize + VNC_TILE_SIZE - 1) / VNC_TILE_SIZE;
+  vnc_tiles_y = (ySize + VNC_TILE_SIZE - 1) / VNC_TILE_SIZE;
+  return 0;
+}
+
+int VNC_Server_Run (VNC_Session *s, const VNC_Transport *tr, void *conn) {
+  uint32_t tick, start, bytes;
+  int32_t  n;
+  int      slot, rc;
+
+  if (vnc_input_mutex == NULL) {
+    return -1;
+  }
+  memset(s, 0, sizeof(VNC_Session));
+  s->tr       = tr;
+  s->conn     = conn;
+  s->thread   = osThreadGetId();
+  s->encoding = RFB_ENC_RAW;
+  s->unpaced  = ((tr->Flags & VNC_TR_UNPACED) != 0U) ? 1U : 0U;
+  s->private_enc = ((tr->Flags & VNC_TR_PRIVATE) != 0U) ? 1U : 0U;
+  (void)_SetPixelFormat(s, vnc_native_pf);
+  if (_Handshake(s) != 0) {
+    return -1;
+  }
+
+  // The viewer's framebuffer is undefined: the first update sends all tiles
+  memset(s->forced, 0xFF, sizeof(s->forced));
+  tick            = osKernelGetTickCount();
+  s->rescan_tick  = tick;
+  s->start_tick   = tick - 1000U;
+  s->drain_tick   = tick - 1000U;
+  s->win_tick     = tick;
+  s->stats.active = 1U;
+  slot = _Register(s);
+  if (slot < 0) {
+    return -1;
+  }
+
+  rc = 0;
+  while (s->error == 0U) {
+    n = s->tr->Recv(s->conn, &s->rx[s->rx_len], VNC_RX_SIZE - s->rx_len);
+    if (n < 0) {
+      break;                            // Disconnected
+    }
+    s->rx_len += (uint32_t)n;
+    if (_Parse(s) != 0) {
+      rc = -1;
+      break;
+    }
+    tick = osKernelGetTickCount();
+    _Track(s, tick);
+    if ((s->update_req != 0U) && (_Due(s, tick) != 0U)) {
+      AppEvr_Record(EVR_VNC_UPDATE_BEGIN, (uint32_t)slot, s->stats.updates);
+      bytes = s->stats.bytes;
+      start = Prof_Begin();
+      _Update(s);
+      Prof_End(PROF_VNC_UPDATE, start);
+      AppEvr_Record(EVR_VNC_UPDATE_SENT, (uint32_t)slot, s->stats.bytes - bytes);
+    }
+    if (n == 0) {
+      (void)osThreadFlagsWait(VNC_FLAG_WAKE, osFlagsWaitAny, VNC_POLL_MS);
+    }
+  }
+  if (s->error != 0U) {
+    rc = -1;
+  }
+  vnc_session[slot] = NULL;
+  return rc;
+}
+
+void VNC_Server_Mark (int buffer, int x0, int y0, int x1, int y1) {
+  if ((buffer >= 0) && (buffer < VNC_FB_BUFFERS)) {
+    _SetTiles(vnc_marks[buffer], x0, y0, x1, y1);
+  }
+}
+
+void VNC_Server_Frame (int buffer, const void *frame) {
+  VNC_Session *s;
+  uint32_t    *marks;
+  int          i, w;
+
+  if ((buffer < 0) || (buffer >= VNC_FB_BUFFERS)) {
+    return;
+  }
+  marks = vnc_marks[buffer];
+  for (i = 0; i < VNC_SESSIONS_MAX; i++) {
+    s = vnc_session[i];
+    if (s != NULL) {
+      for (w = 0; w < VNC_TILE_WORDS; w++) {
+        s->pending[w] |= marks[w];
+      }
+      s->rescan = 1U;
+      (void)osThreadFlagsSet(s->thread, VNC_FLAG_WAKE);
+    }
+  }
+  memset(marks, 0, sizeof(vnc_marks[0]));
+  vnc_frame = (const uint16_t *)frame;
+  vnc_frames++;
+}
+
+int VNC_Server_GetStats (uint32_t index, VNC_Stats *stats) {
+  VNC_Session *s;
+
+  if (index >= VNC_SESSIONS_MAX) {
+    return -1;
+  }
+  s = vnc_session[index];
+  if (s != NULL) {
+    *stats = s->stats;
+  } else {
+    memset(stats, 0, sizeof(VNC_Stats));
+  }
+  return 0;
+}
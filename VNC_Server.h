@@ -0,0 +1,140 @@
+/*------------------------------------------------------------------------------
+ * Name:    VNC_Server.h
+ * Purpose: RFB (VNC) server engine with tile damage tracking
+ *----------------------------------------------------------------------------*/
+
+#ifndef VNC_SERVER_H_
+#define VNC_SERVER_H_
+
+#include <stdint.h>
+
+// VNC Server Configuration ----------------------------------------------------
+
+#define VNC_XSIZE_MAX           (480)   // Largest supported framebuffer
+#define VNC_YSIZE_MAX           (272)
+#define VNC_FB_BUFFERS          (3)     // Display buffers (LCDConf NUM_BUFFERS)
+#define VNC_VIEWERS_MAX         (2)     // Concurrent viewers (VNC_TCP_CLIENTS)
+#define VNC_RX_SIZE             (512)   // Client message buffer per session
+#define VNC_POLL_MS             (20U)   // Receive poll period [ms]
+#define VNC_RESCAN_MS           (250U)  // Minimum period of full frame rescans [ms]
+#define VNC_FPS_MAX             (20U)   // Maximum update rate per viewer [1/s]
+#define VNC_INTERVAL_MIN        (10U)   // Pause after an update was acknowledged [ms]
+#define VNC_HANDSHAKE_TIMEOUT   (10000U) // Protocol handshake timeout [ms]
+#define VNC_ENC_BUFS            (2)     // Shared Hextile encodings (pixel formats)
+#define VNC_ENC_ARENA_SIZE      (0x40000) // Encoded tile data per shared encoding
+#define VNC_DESKTOP_NAME        "STM32F746G-DISCO"
+
+//------------------------------------------------------------------------------
+
+#ifdef BENCH
+#define VNC_SESSIONS_MAX        (VNC_VIEWERS_MAX + 1)   // Viewers and the Bench loopback
+#else
+#define VNC_SESSIONS_MAX        (VNC_VIEWERS_MAX)
+#endif
+
+#define VNC_TILE_SIZE           (16)    // Damage and Hextile tile size
+#define VNC_TILES_X             ((VNC_XSIZE_MAX + VNC_TILE_SIZE - 1) / VNC_TILE_SIZE)
+#define VNC_TILES_Y             ((VNC_YSIZE_MAX + VNC_TILE_SIZE - 1) / VNC_TILE_SIZE)
+#define VNC_TILES               (VNC_TILES_X * VNC_TILES_Y)
+#define VNC_TILE_WORDS          ((VNC_TILES + 31) / 32)
+
+#define VNC_FLAG_WAKE           (1U << 8)       // Session thread flag: frame or data
+
+// Transport of one session. Recv does not block; the engine polls it
+// every VNC_POLL_MS or when the session thread gets VNC_FLAG_WAKE, which
+// the transport should also set when sent data is acknowledged.
+typedef struct {
+  // \return      bytes received, 0 if none, -1 if the connection is closed
+  int32_t   (*Recv)     (void *conn, uint8_t *buf, uint32_t len);
+  // Buffer to encode the next data into, e.g. a segment of the network
+  // stack. The engine fills it and passes it to Send before the next call.
+  // \return      buffer of *size bytes (at least VNC_BUF_MIN), NULL on error
+  uint8_t * (*GetBuf)   (void *conn, uint32_t *size);
+  // Send len (> 0) bytes of the buffer returned by GetBuf.
+  // \return      0 on success, -1 on error
+  int32_t   (*Send)     (void *conn, uint8_t *buf, uint32_t len);
+  // \return      bytes sent and not acknowledged by the viewer yet
+  uint32_t  (*InFlight) (void *conn);
+  uint32_t    Flags;                    // VNC_TR_xxx
+} VNC_Transport;
+
+#define VNC_TR_UNPACED          (1U << 0)       // No rate limits (loopback benchmark)
+#define VNC_TR_PRIVATE          (1U << 1)       // Do not use the shared encodings
+
+// Smallest transport buffer: one raw 32bpp tile and a rectangle header
+#define VNC_BUF_MIN             (16U + (VNC_TILE_SIZE * VNC_TILE_SIZE * 4U))
+
+typedef struct {
+  uint8_t  bpp;                 // Bits per pixel (8, 16 or 32)
+  uint8_t  depth;
+  uint8_t  big_endian;
+  uint8_t  true_colour;
+  uint16_t max[3];              // Red, green, blue maximum
+  uint8_t  shift[3];            // Red, green, blue shift
+} VNC_PixelFormat;
+
+typedef struct {
+  uint32_t active;              // Viewer connected
+  uint32_t fps;                 // Updates in the last second
+  uint32_t bytes_per_s;         // Bytes sent in the last second
+  uint32_t updates;             // Updates sent
+  uint32_t bytes;               // Bytes sent
+  uint32_t stalls;              // Updates held back by unacknowledged data
+  uint32_t shared;              // Tiles sent from a shared encoding
+  uint32_t inflight;            // Bytes not acknowledged yet
+} VNC_Stats;
+
+// Session state, one per connected viewer (about 4 KB)
+typedef struct {
+  const VNC_Transport *tr;
+  void                *conn;
+  void                *thread;
+  uint32_t             error;
+  uint32_t             encoding;        // Rectangle encoding in use
+  uint32_t             update_req;      // Framebuffer update requested
+  uint32_t             rescan;          // Frame flipped since the last full scan
+  uint32_t             rescan_tick;
+  uint32_t             busy;            // Update sent, not acknowledged yet
+  uint32_t             stalled;         // Update due while busy (counted)
+  uint32_t             unpaced;         // Transport flag VNC_TR_UNPACED
+  uint32_t             private_enc;     // Transport flag VNC_TR_PRIVATE
+  uint32_t             start_tick;      // Start of the last update
+  uint32_t             drain_tick;      // Acknowledge of the last update
+  uint32_t             win_tick;        // Start of the rate window
+  uint32_t             win_updates;
+  uint32_t             win_bytes;
+  VNC_Stats            stats;
+  VNC_PixelFormat      pf;
+  uint32_t             lut[3][64];      // RGB565 component to client pixel
+  uint32_t             pending[VNC_TILE_WORDS];  // Tiles drawn (draw hooks)
+  uint32_t             forced[VNC_TILE_WORDS];   // Tiles to send unconditionally
+  uint32_t             hash[VNC_TILES];          // Tile hashes as last sent
+  uint32_t             px[VNC_TILE_SIZE * VNC_TILE_SIZE];
+  uint8_t             *out;
+  uint32_t             out_len;
+  uint32_t             out_size;
+  uint32_t             rx_len;
+  uint32_t             rx_skip;         // Bytes of a long message to discard
+  uint8_t              rx[VNC_RX_SIZE];
+} VNC_Session;
+
+// Set the framebuffer size. Call once before the first session.
+// \return      0 on success, -1 if the size exceeds VNC_XSIZE/YSIZE_MAX
+extern int  VNC_Server_Initialize (int xSize, int ySize);
+
+// Serve one connected viewer on the calling thread until it disconnects.
+// \return      0 on disconnect, -1 on protocol or transport error
+extern int  VNC_Server_Run        (VNC_Session *s, const VNC_Transport *tr, void *conn);
+
+// Draw hook (LCDConf, GUI thread): area x0..x1, y0..y1 of a display
+// buffer has been drawn.
+extern void VNC_Server_Mark       (int buffer, int x0, int y0, int x1, int y1);
+
+// Flip hook (LCDConf, LTDC interrupt): buffer at frame is now shown.
+extern void VNC_Server_Frame      (int buffer, const void *frame);
+
+// Statistics of session slot index (0 .. VNC_SESSIONS_MAX-1).
+// \return      0 on success, -1 if index is out of range
+extern int  VNC_Server_GetStats   (uint32_t index, VNC_Stats *stats);
+
+#endif /* VNC_SERVER_H_ */
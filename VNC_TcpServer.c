@@ -0,0 +1,284 @@
+/*------------------------------------------------------------------------------
+ * Name:    VNC_TcpServer.c
+ * Purpose: VNC transport on native TCP sockets
+ *----------------------------------------------------------------------------*/
+/*
+ * VNC_TCP_CLIENTS native TCP sockets listen on the VNC port, one per
+ * client, and each client runs an RFB session (VNC_Server.c) on its own
+ * thread. Connections beyond VNC_TCP_CLIENTS find no listening socket and
+ * are refused by the stack. Both emWin glue files (GUI_VNC_X_*.c) start
+ * the server through this module.
+ *
+ * The socket callback runs in the network core thread: it queues received
+ * data in the client's SPSC ring (RingBuf.h), which the session polls,
+ * and counts acknowledges. Native sockets report acknowledges, so the
+ * transport knows the bytes in flight: a segment is sent only when the
+ * previous one has been acknowledged, and the session starts the next
+ * update only when the last one has been acknowledged. A slow viewer
+ * therefore holds one segment of network memory and gets fewer, merged
+ * updates. A viewer that acknowledges nothing for VNC_TCP_SEND_TIMEOUT is
+ * dropped.
+ *
+ * Zero copy: the session encodes directly into a TCP segment of the
+ * network memory pool (netTCP_GetBuffer), which is then passed to
+ * netTCP_Send as it is. Only if the viewer's maximum segment size is below
+ * VNC_BUF_MIN does the session encode into the client's arena in SDRAM
+ * (section .bss.sdram), and the data is copied into segments.
+ */
+
+#include <string.h>
+
+#include "RTE_Components.h"
+#include  CMSIS_device_header
+#include "cmsis_os2.h"
+#include "rl_net.h"
+
+#include "RingBuf.h"
+#include "VNC_Server.h"
+#include "VNC_TcpServer.h"
+
+#define VNC_TCP_FLAG_CONNECT    (1U)    // Session thread flag: connection accepted
+
+typedef struct {
+  VNC_Session          session;
+  RingBuf              rx;              // Received data, filled by the callback
+  volatile uint32_t    inflight;        // Bytes sent and not acknowledged
+  volatile uint8_t     closed;          // Connection closed or receive ring overflow
+  int32_t              sock;
+  uint32_t             addr;            // Peer IPv4 address, network byte order
+  osThreadId_t         tid;
+  uint8_t             *seg;             // Segment the session encodes into
+  uint8_t              rx_mem[VNC_TCP_RX_SIZE];
+} VNC_TcpClient;
+
+static VNC_TcpClient vnc_client[VNC_TCP_CLIENTS];
+static uint16_t      vnc_port;
+
+static uint64_t      vnc_stk[VNC_TCP_CLIENTS][VNC_TCP_STACK_SIZE / 8U];
+static uint8_t       vnc_arena[VNC_TCP_CLIENTS][VNC_TCP_ARENA_SIZE] __attribute__((section(".bss.sdram"), aligned(32)));
+
+// Find the client of a socket.
+static VNC_TcpClient *_Client (int32_t sock) {
+  uint32_t i;
+
+  for (i = 0U; i < VNC_TCP_CLIENTS; i++) {
+    if ((vnc_client[i].sock == sock) && (vnc_client[i].tid != NULL)) {
+      return &vnc_client[i];
+    }
+  }
+  return NULL;
+}
+
+// Socket callback (network core thread).
+static uint32_t _Listener (int32_t sock, netTCP_Event event, const NET_ADDR *addr, const uint8_t *buf, uint32_t len) {
+  VNC_TcpClient *c;
+
+  c = _Client(sock);
+  if (c == NULL) {
+    return 0U;
+  }
+  switch (event) {
+    case netTCP_EventConnect:
+      RingBuf_Init(&c->rx, c->rx_mem, VNC_TCP_RX_SIZE);
+      c->inflight = 0U;
+      c->closed   = 0U;
+      c->addr     = 0U;
+      if (addr->addr_type == NET_ADDR_IP4) {
+        memcpy(&c->addr, addr->addr, 4U);
+      }
+      (void)osThreadFlagsSet(c->tid, VNC_TCP_FLAG_CONNECT);
+      return 1U;
+
+    case netTCP_EventData:
+      if (RingBuf_Write(&c->rx, buf, len) != len) {
+        c->closed = 1U;                 // The session would lose sync
+      }
+      (void)osThreadFlagsSet(c->tid, VNC_FLAG_WAKE);
+      break;
+
+    case netTCP_EventACK:
+      c->inflight = 0U;                 // All sent data is acknowledged
+      (void)osThreadFlagsSet(c->tid, VNC_FLAG_WAKE);
+      break;
+
+    case netTCP_EventClosed:
+    case netTCP_EventAborted:
+      c->closed = 1U;
+      (void)osThreadFlagsSet(c->tid, VNC_FLAG_WAKE);
+      break;
+
+    default:
+      break;
+  }
+  return 0U;
+}
+
+// Wait until the previous segment is acknowledged and a segment of len
+// bytes is available.
+// \return      segment, NULL if closed or not acknowledged in time
+static uint8_t *_Segment (VNC_TcpClient *c, uint32_t len) {
+  uint8_t *seg;
+  uint32_t start;
+
+  start = osKernelGetTickCount();
+  while (c->closed == 0U) {
+    if (netTCP_SendReady(c->sock)) {
+      seg = netTCP_GetBuffer(len);
+      if (seg != NULL) {
+        return seg;
+      }
+    }
+    if ((osKernelGetTickCount() - start) >= VNC_TCP_SEND_TIMEOUT) {
+      break;                            // Viewer stopped reading
+    }
+    (void)osThreadFlagsWait(VNC_FLAG_WAKE, osFlagsWaitAny, VNC_POLL_MS);
+  }
+  return NULL;
+}
+
+// ==== Session transport ====
+
+static int32_t _Recv (void *conn, uint8_t *buf, uint32_t len) {
+  VNC_TcpClient *c = conn;
+  uint8_t       *data;
+  uint32_t       n, cnt;
+
+  for (cnt = 0U; cnt < len; cnt += n) {
+    n = RingBuf_Peek(&c->rx, &data);
+    if (n == 0U) {
+      break;
+    }
+    if (n > (len - cnt)) {
+      n = len - cnt;
+    }
+    memcpy(&buf[cnt], data, n);
+    RingBuf_Consume(&c->rx, n);
+  }
+  if ((cnt == 0U) && (c->closed != 0U)) {
+    return -1;
+  }
+  return (int32_t)cnt;
+}
+
+// A segment of the maximum segment size, or the arena if that is too small.
+static uint8_t *_GetBuf (void *conn, uint32_t *size) {
+  VNC_TcpClient *c = conn;
+  uint32_t       mss;
+
+  mss = netTCP_GetMaxSegmentSize(c->sock);
+  if (mss < VNC_BUF_MIN) {
+    *size = VNC_TCP_ARENA_SIZE;
+    return vnc_arena[c - vnc_client];
+  }
+  c->seg = _Segment(c, mss);
+  *size  = mss;
+  return c->seg;
+}
+
+// Send a segment as it is; copy arena data into segments.
+static int32_t _Send (void *conn, uint8_t *buf, uint32_t len) {
+  VNC_TcpClient *c = conn;
+  uint8_t       *seg;
+  uint32_t       mss, n;
+
+  if (buf == c->seg) {
+    c->seg       = NULL;
+    c->inflight += len;
+    return (netTCP_Send(c->sock, buf, len) == netOK) ? 0 : -1;
+  }
+  mss = netTCP_GetMaxSegmentSize(c->sock);
+  if (mss == 0U) {
+    return -1;
+  }
+  for (; len != 0U; len -= n) {
+    n   = (len < mss) ? len : mss;
+    seg = _Segment(c, n);
+    if (seg == NULL) {
+      return -1;
+    }
+    memcpy(seg, buf, n);
+    c->inflight += n;
+    if (netTCP_Send(c->sock, seg, n) != netOK) {
+      return -1;
+    }
+    buf = &buf[n];
+  }
+  return 0;
+}
+
+static uint32_t _InFlight (void *conn) {
+  return ((VNC_TcpClient *)conn)->inflight;
+}
+
+static const VNC_Transport vnc_transport = {
+  _Recv,
+  _GetBuf,
+  _Send,
+  _InFlight,
+  0U
+};
+
+// Close the connection of a client and listen again.
+static void _Close (VNC_TcpClient *c) {
+  uint32_t start;
+
+  if (netTCP_GetState(c->sock) != netTCP_StateCLOSED) {
+    (void)netTCP_Close(c->sock);
+    start = osKernelGetTickCount();
+    while (netTCP_GetState(c->sock) != netTCP_StateCLOSED) {
+      if ((osKernelGetTickCount() - start) >= VNC_TCP_CLOSE_TIMEOUT) {
+        (void)netTCP_Abort(c->sock);
+        break;
+      }
+      (void)osDelay(10U);
+    }
+  }
+  c->addr = 0U;
+  while (netTCP_Listen(c->sock, vnc_port) != netOK) {
+    (void)osDelay(100U);                // Try again
+  }
+}
+
+// Thread: Runs the session of one client
+__NO_RETURN static void VNC_Tcp_Thread (void *arg) {
+  VNC_TcpClient *c = arg;
+
+  for (;;) {
+    (void)osThreadFlagsWait(VNC_TCP_FLAG_CONNECT, osFlagsWaitAny, osWaitForever);
+    (void)VNC_Server_Run(&c->session, &vnc_transport, c);
+    _Close(c);
+  }
+}
+
+int VNC_Tcp_Initialize (uint16_t port) {
+  osThreadAttr_t attr;
+  uint32_t       i;
+
+  vnc_port = port;
+  for (i = 0U; i < VNC_TCP_CLIENTS; i++) {
+    vnc_client[i].sock = netTCP_GetSocket(_Listener);
+    if (vnc_client[i].sock < 0) {
+      return -1;
+    }
+    (void)netTCP_SetOption(vnc_client[i].sock, netTCP_OptionKeepAlive, 1U);
+    if (netTCP_Listen(vnc_client[i].sock, vnc_port) != netOK) {
+      return -1;
+    }
+    memset(&attr, 0, sizeof(attr));
+    attr.name       = "VNC_Client";
+    attr.stack_mem  = &vnc_stk[i][0];
+    attr.stack_size = sizeof(vnc_stk[i]);
+    vnc_client[i].tid = osThreadNew(VNC_Tcp_Thread, &vnc_client[i], &attr);
+    if (vnc_client[i].tid == NULL) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+uint32_t VNC_Tcp_GetPeer (uint32_t index) {
+  if (index >= VNC_TCP_CLIENTS) {
+    return 0U;
+  }
+  return vnc_client[index].addr;
+}
@@ -0,0 +1,35 @@
+/*------------------------------------------------------------------------------
+ * Name:    VNC_TcpServer.h
+ * Purpose: VNC transport on native TCP sockets
+ *----------------------------------------------------------------------------*/
+
+#ifndef VNC_TCP_SERVER_H_
+#define VNC_TCP_SERVER_H_
+
+#include <stdint.h>
+
+#include "VNC_Server.h"
+
+// VNC TCP Server Configuration ------------------------------------------------
+
+#define VNC_TCP_STACK_SIZE      (2048)  // Session thread stack size per client
+#define VNC_TCP_RX_SIZE         (1024)  // Receive ring size per client (power of 2)
+#define VNC_TCP_ARENA_SIZE      (8192)  // SDRAM encoding arena per client
+#define VNC_TCP_SEND_TIMEOUT    (2000U) // Drop a viewer that acknowledges nothing [ms]
+#define VNC_TCP_CLOSE_TIMEOUT   (1000U) // Graceful close before abort [ms]
+
+//------------------------------------------------------------------------------
+
+#define VNC_TCP_CLIENTS         (VNC_VIEWERS_MAX)       // One TCP socket and session each
+
+// Open the listening sockets on port and start the session threads.
+// Call after netInitialize and VNC_Server_Initialize; app_main calls it
+// once an interface has a link.
+// \return      0 on success, -1 on error
+extern int      VNC_Tcp_Initialize (uint16_t port);
+
+// \return      IPv4 address of the viewer of client index (network byte
+//              order), 0 if none is connected
+extern uint32_t VNC_Tcp_GetPeer    (uint32_t index);
+
+#endif /* VNC_TCP_SERVER_H_ */